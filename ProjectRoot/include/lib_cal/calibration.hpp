@@ -4,10 +4,13 @@
 #include "pch.hpp"
 #include "log_macros.hpp"
 #include "usrp_class.hpp"
-#include "config_parser.hpp"
+#include "config.hpp"
 #include "MQTTClient.hpp"
 #include "cyclestartdetector.hpp"
 #include "waveforms.hpp"
+#include "event_sync.hpp"
+#include "window_power.hpp"
+#include "thread_sched.hpp"
 
 /**Calibration protocol implementation between pair of leaf and cent nodes. */
 class Calibration
@@ -16,12 +19,12 @@ public:
     /** Class initialization
      *
      * @param USRP_class         object for USRP
-     * @param ConfigParser       object for parsing configurations
+     * @param config             shared configuration snapshot
      * @param device_id          USRP serial number
      * @param device_type        "cent" or "leaf"
      * @param signal_stop_called to manage clean exit of program via SIGINT
      */
-    Calibration(USRP_class &usrp_obj, ConfigParser &parser, const std::string &device_id, const std::string &counterpart_id, const std::string &device_type, bool &signal_stop_called);
+    Calibration(USRP_class &usrp_obj, std::shared_ptr<const Config> config, const std::string &device_id, const std::string &counterpart_id, const std::string &device_type, bool &signal_stop_called);
 
     ~Calibration();
 
@@ -32,11 +35,22 @@ public:
     void run_scaling_tests();
     void stop();
 
+    /** Leaf answers the REF in response slot `slot` (protocol #2), so that a cent calibrating
+     * several leafs at once (CalibrationScheduler) receives all answers to one REF without overlap.
+     */
+    void set_response_slot(const size_t &slot);
+    // samples per response slot, also the length of the cent's OTAC capture window of one leaf
+    static size_t response_slot_len(const Config &config) { return 5 * config.test_signal_len; }
+
+    // block until the routine ends or the timeout passes, returns true if it ended
+    bool wait_calibration_end(const std::chrono::milliseconds &timeout);
+    bool wait_scaling_test_end(const std::chrono::milliseconds &timeout);
+
     bool signal_stop_called, calibration_successful, calibration_ends, scaling_test_ends;
 
 private:
-    ConfigParser parser;
     std::shared_ptr<USRP_class> usrp_obj;
+    std::shared_ptr<const Config> config;
     std::unique_ptr<CycleStartDetector> csd_obj;
     std::unique_ptr<PeakDetectionClass> peak_det_obj;
     std::vector<std::complex<float>> ref_waveform, otac_waveform;
@@ -45,6 +59,8 @@ private:
     void initialize_csd_obj();
     void generate_waveform();
     void get_mqtt_topics();
+    // scheduling roles of the producer (rx) and consumer (dsp) threads, see ThreadScheduling
+    void apply_thread_roles();
 
     bool calibrate_gains(MQTTClient &mqttClient);
     void on_calib_success(MQTTClient &mqttClient);
@@ -62,6 +78,26 @@ private:
     bool check_ctol();
 
     std::atomic<bool> csd_success_flag;
+
+    // flags raised by the counterpart via `flag_topic_leaf`
+    enum PeerFlag : uint32_t
+    {
+        FLAG_RECV = 1 << 0,
+        FLAG_RETX = 1 << 1,
+        FLAG_END = 1 << 2
+    };
+    enum RoutineFlag : uint32_t
+    {
+        ROUTINE_CALIBRATION = 1 << 0,
+        ROUTINE_SCALING_TEST = 1 << 1
+    };
+    FlagSet peer_flags, routine_flags;
+    void end_routine(const uint32_t &routine);
+
+    // ltoc values received from cent via `ltoc_topic`
+    AwaitableValue<float> ltoc_updates;
+    std::vector<double> window_prefix; // prefix sums for OTAC window power
+
     boost::thread producer_thread, consumer_thread;
 
     /** Leaf calibration protocol #1.
@@ -86,13 +122,12 @@ private:
 
     std::string device_id, counterpart_id, leaf_id, cent_id, device_type, client_id;
     std::string CFO_topic, flag_topic_leaf, cal_scale_topic, full_scale_topic, ltoc_topic, ctol_topic, tx_gain_topic, rx_gain_topic, mctest_topic;
-    size_t max_total_round = 30, max_mctest_rounds = 100, reps_total = 20;
+    size_t max_total_round = 30, max_mctest_rounds = 100, reps_total = 20, response_slot = 0;
     float max_tx_gain = 86.0, max_rx_gain = 50.0;
 
     bool recv_success = false;
     size_t total_reps_cal = 2, current_reps_cal = 0;
     float ltoc, ctol, full_scale = 1.0, calib_sig_scale = 1.0, min_sigpow_mul = 100, init_proximity_tol = 0.02, proximity_tol = 0.0;
-    bool recv_flag = false, retx_flag = false, end_flag = false;
 
     float min_e2e_pow = 1.0, max_e2e_pow = 1.0;
 
@@ -0,0 +1,86 @@
+#ifndef CALIBRATION_SCHEDULER
+#define CALIBRATION_SCHEDULER
+
+#include "pch.hpp"
+#include "log_macros.hpp"
+#include "usrp_class.hpp"
+#include "config.hpp"
+#include "MQTTClient.hpp"
+#include "waveforms.hpp"
+#include "event_sync.hpp"
+#include "window_power.hpp"
+#include "calibration.hpp"
+
+/** Cent side of calibration protocol #2 for many leafs at once.
+ *
+ * A single REF per round serves every leaf: leaf i answers in response slot i
+ * (Calibration::set_response_slot), so the answers of all leafs follow each
+ * other in one capture window and every ltoc of the round is estimated from it.
+ * Flags of all leafs arrive through one wildcard subscription and are routed
+ * into the session table by leaf id.
+ */
+class CalibrationScheduler
+{
+public:
+    /** Class initialization
+     *
+     * @param usrp_obj           object for USRP
+     * @param config             shared configuration snapshot
+     * @param cent_id            USRP serial number of the cent
+     * @param leaf_ids           leafs to calibrate, the position is the response slot of the leaf
+     * @param signal_stop_called to manage clean exit of program via SIGINT
+     */
+    CalibrationScheduler(USRP_class &usrp_obj, std::shared_ptr<const Config> config, const std::string &cent_id, const std::vector<std::string> &leaf_ids, bool &signal_stop_called);
+
+    ~CalibrationScheduler();
+
+    bool initialize();
+
+    void run();
+    void stop();
+
+    // block until all sessions end or the timeout passes, returns true if they ended
+    bool wait_calibration_end(const std::chrono::milliseconds &timeout);
+
+    bool &signal_stop_called;
+    bool calibration_ends = false;
+
+private:
+    enum LeafFlag : uint32_t
+    {
+        FLAG_RECV = 1 << 0,
+        FLAG_RETX = 1 << 1,
+        FLAG_END = 1 << 2
+    };
+
+    // per-leaf state, indexed by response slot
+    struct LeafSession
+    {
+        std::string leaf_id, ltoc_topic;
+        std::atomic<uint32_t> flags{0}; // raised by the MQTT dispatcher, consumed by the round loop
+        float ltoc = -1.0;
+        uint32_t responses = 0, missed = 0;
+        bool done = false;
+    };
+
+    void on_leaf_flag(const std::string &topic, const std::string &payload);
+    void producer_cent_proto();
+    void wait_for_leafs(const Deadline &deadline);
+    void report_sessions(const double &elapsed);
+
+    std::shared_ptr<const Config> config;
+    USRP_class *usrp_obj;
+    std::string cent_id, flag_topic_filter, flag_topic_prefix;
+    std::vector<LeafSession> sessions;
+    std::unordered_map<std::string, size_t> slot_of_leaf;
+    std::vector<std::complex<float>> ref_waveform;
+    std::vector<double> window_prefix;
+
+    FlagSet leaf_events, routine_flags;
+    boost::thread producer_thread;
+
+    size_t max_total_round = 30;
+    float min_e2e_pow = 1.0;
+};
+
+#endif // CALIBRATION_SCHEDULER
@@ -0,0 +1,139 @@
+#ifndef CHANNEL_EMULATOR
+#define CHANNEL_EMULATOR
+
+#include "pch.hpp"
+#include "log_macros.hpp"
+
+/** Fast N(0, 1) generator for channel noise.
+ *
+ * xoshiro256** supplies 64 random bits per draw, split into four 12-bit indices of a table of
+ * normal quantiles; every output is the scaled sum of two quantiles. This is ~10x faster than
+ * std::normal_distribution, has exactly unit variance and tails up to ~4.9 sigma -- good for
+ * AWGN and phase noise, not for estimating error rates far out in the tails.
+ */
+class GaussianRng
+{
+public:
+    explicit GaussianRng(const uint64_t &seed = 1);
+
+    void seed(const uint64_t &seed);
+
+    // `num_vals` independent values with standard deviation `std_dev`
+    void fill(float *out, const size_t &num_vals, const float &std_dev = 1.0);
+
+    // adds circular complex noise of power `noise_power` to `num_samples` samples
+    void add_noise(sample_type *samples, const size_t &num_samples, const float &noise_power);
+
+    float next();
+
+private:
+    uint64_t next_bits();
+
+    static const std::vector<float> &quantile_table();
+
+    uint64_t state[4];
+    float spare = 0.0;
+    bool has_spare = false;
+};
+
+/** Streaming channel from one transmitter to the receiver.
+ *
+ * Multipath, path gain and fractional delays of all paths are combined into one FIR filter
+ * whose taps come from a polyphase bank of Lanczos interpolators (1/256 sample resolution).
+ * CFO and Wiener phase noise are applied after the filter. Filter history and phases carry
+ * over from one block to the next, so a waveform can be passed in blocks of any size.
+ */
+class ChannelLink
+{
+public:
+    struct Path
+    {
+        double delay = 0.0;                  // samples, >= 0
+        sample_type gain = sample_type(1.0); // amplitude and phase of the path (includes path loss)
+    };
+
+    ChannelLink();
+
+    // paths of the link, takes effect at the next block, keeps the input history
+    void set_paths(const std::vector<Path> &paths);
+
+    void set_cfo(const double &cfo_hz, const double &sample_rate);
+
+    // Wiener phase noise with 3 dB linewidth `linewidth_hz`, 0 disables it
+    void set_phase_noise(const double &linewidth_hz, const double &sample_rate, const uint64_t &seed);
+
+    // out[i] += channel(in)[i] for i < num_samples
+    void process(const sample_type *in, const size_t &num_samples, sample_type *out);
+
+    // clears filter history and phases and reseeds the phase noise, as if the link was just created
+    void reset();
+
+    // number of past input samples the link depends on
+    size_t max_delay() const { return history_len; }
+
+    static constexpr int interp_taps = 8, interp_phases = 256;
+
+private:
+    void rotate_accumulate(const sample_type *in, const sample_type &gain, const size_t &num_samples, sample_type *out);
+
+    static const std::vector<float> &interp_bank();
+
+    void resize_history(const size_t &new_len);
+
+    // out[i] = sum_j fir[j] * in[i - fir_start - j]
+    std::vector<sample_type> fir, history, extended, filtered;
+    size_t fir_start = 0, history_len = 0;
+
+    // CFO: exact phase per block, recursive within the block from `cfo_steps`
+    static constexpr size_t cfo_block = 256;
+    double cfo_omega = 0.0, cfo_phase = 0.0;
+    std::vector<sample_type> cfo_steps;
+
+    double pn_std = 0.0;
+    sample_type pn_rot = sample_type(1.0);
+    uint64_t pn_seed = 1;
+    GaussianRng pn_rng;
+    std::vector<float> pn_increments;
+    std::vector<sample_type> block_rot;
+};
+
+/** Channel emulator of a receiver listening to several transmitters.
+ *
+ * Every transmitter has its own link (ChannelLink); the receiver gets the superposition of
+ * all links plus AWGN. Inputs are passed block by block, one block of equal length per link.
+ */
+class ChannelEmulator
+{
+public:
+    ChannelEmulator(const double &sample_rate, const uint64_t &seed = 1);
+
+    // returns the index of the new link
+    size_t add_link();
+    ChannelLink &link(const size_t &index) { return links[index]; }
+    size_t num_links() const { return links.size(); }
+
+    void set_noise_power(const float &power) { noise_power = power; }
+    double sample_rate() const { return rate; }
+
+    /** Received block
+     *
+     * @param inputs      one block per link, `num_samples` each, nullptr for a silent transmitter
+     * @param num_samples block length
+     * @param out         received samples, overwritten
+     */
+    bool process(const std::vector<const sample_type *> &inputs, const size_t &num_samples, sample_type *out);
+
+    bool process(const std::vector<std::vector<sample_type>> &inputs, std::vector<sample_type> &out);
+
+    void reset();
+
+private:
+    double rate;
+    uint64_t base_seed;
+    std::deque<ChannelLink> links; // references from link() stay valid while links are added
+    float noise_power = 0.0;
+    GaussianRng noise_rng;
+    std::vector<sample_type> silence;
+};
+
+#endif // CHANNEL_EMULATOR
@@ -0,0 +1,56 @@
+#ifndef CONFIG_SNAPSHOT
+#define CONFIG_SNAPSHOT
+
+#include "pch.hpp"
+#include "log_macros.hpp"
+#include "config_parser.hpp"
+
+#define CONFIG_TYPE_str std::string
+#define CONFIG_TYPE_int size_t
+#define CONFIG_TYPE_float float
+#define CONFIG_TYPE_bool bool
+
+/** Typed, immutable view of the configuration.
+ *
+ * Fields are generated from `config_schema.def`. A snapshot is built once from a
+ * `ConfigParser` via `from_parser`, which validates all keys up front and exits
+ * with a list of every problem found. Library classes share it as
+ * `std::shared_ptr<const Config>` and read plain members instead of doing
+ * string-keyed lookups in their loops.
+ */
+struct Config
+{
+#define CONFIG_REQUIRED(field, key, type, desc) CONFIG_TYPE_##type field{};
+#define CONFIG_OPTIONAL(field, key, type, def, desc) CONFIG_TYPE_##type field = def;
+#include "config_schema.def"
+#undef CONFIG_REQUIRED
+#undef CONFIG_OPTIONAL
+
+    /**
+     * @brief Builds and validates a snapshot from parsed config values.
+     *
+     * Missing required keys, type mismatches and out-of-range values are all
+     * collected and reported before exiting through LOG_ERROR.
+     */
+    static std::shared_ptr<const Config> from_parser(const ConfigParser &parser);
+
+    /**
+     * @brief Returns a modified copy, e.g. to add values only known after USRP setup.
+     * @param modifier Function applied to the copy before it is frozen.
+     */
+    std::shared_ptr<const Config> with(const std::function<void(Config &)> &modifier) const;
+
+    // `rx-channels` as channel indices
+    std::vector<size_t> rx_channel_list() const;
+
+    // ZFC roots of the cycle start detector, `Ref-m-zfc` first, then `Ref-extra-m-zfc`
+    std::vector<size_t> ref_zfc_roots() const;
+
+    void print_values() const;
+    json to_json() const;
+
+private:
+    void validate(std::vector<std::string> &errors) const;
+};
+
+#endif // CONFIG_SNAPSHOT
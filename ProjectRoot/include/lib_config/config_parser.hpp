@@ -19,6 +19,13 @@ public:
     size_t getValue_int(const std::string &varName);
     float getValue_float(const std::string &varName);
 
+    // Non-fatal lookup, returns false if varName is not stored with the requested type
+    bool try_get(const std::string &varName, std::string &value) const;
+    bool try_get(const std::string &varName, size_t &value) const;
+    bool try_get(const std::string &varName, float &value) const;
+    // Declared type of varName ("str", "int", "float") or empty if missing
+    std::string type_of(const std::string &varName) const;
+
     // Method to add/modify a value
     void set_value(const std::string &varname, const std::string &varval, const std::string &vartype, const std::string &desc = "");
 
@@ -0,0 +1,64 @@
+#ifndef CFAR_DETECTOR
+#define CFAR_DETECTOR
+
+#include "pch.hpp"
+#include "log_macros.hpp"
+
+enum class CfarMode
+{
+    NONE, // fixed pnr-threshold against the configured noise level
+    CA,   // cell averaging
+    OS    // ordered statistic (3/4 quantile of the training cells)
+};
+
+CfarMode parse_cfar_mode(const std::string &name);
+
+/** CFAR threshold on correlation power |corr|^2.
+ *
+ * Every lag gets its own threshold from `train_cells` training cells on each side, skipping
+ * `guard_cells` cells next to it. The threshold scale comes from the false-alarm rate `pfa` for
+ * exponentially distributed noise power (complex Gaussian noise), so it holds at any noise
+ * level -- no noise estimate has to be kept up to date.
+ *
+ * Blocks are processed one after the other: the last lags of a block are training cells of the
+ * next one. The trailing lags of a block only have lagging training cells, with the scale for
+ * the smaller number of cells.
+ */
+class CfarDetector
+{
+public:
+    CfarDetector(const CfarMode &mode, const size_t &train_cells, const size_t &guard_cells, const double &pfa);
+
+    // thresholds of `num_lags` consecutive lags following the lags of the previous call
+    void process(const std::complex<float> *corr, const size_t &num_lags);
+
+    // lag `i` of the last block crosses its threshold
+    bool is_detection(const size_t &i) const { return cells[history_len + i] > lag_thresholds[i]; }
+
+    // mean |corr|^2 of the last block without the detections -- the correlation noise power
+    float noise_power() const { return block_noise_power; }
+
+    const std::vector<float> &thresholds() const { return lag_thresholds; }
+
+    // the next block does not continue the last one (detector reset, skipped block)
+    void reset() { cells.clear(); }
+
+    CfarMode mode() const { return cfar_mode; }
+
+private:
+    CfarMode cfar_mode;
+    size_t train, guard, reach;
+    std::vector<double> scales; // threshold scale by number of training cells
+
+    static double ca_scale(const size_t &num_cells, const double &pfa);
+    static double os_scale(const size_t &num_cells, const size_t &order, const double &pfa);
+    static size_t os_order(const size_t &num_cells) { return std::max<size_t>(1, (3 * num_cells + 3) / 4); }
+
+    // |corr|^2 of the kept lags of the previous block followed by the current block
+    std::vector<float> cells, lag_thresholds, window;
+    std::vector<double> prefix;
+    size_t history_len = 0;
+    float block_noise_power = 0.0;
+};
+
+#endif // CFAR_DETECTOR
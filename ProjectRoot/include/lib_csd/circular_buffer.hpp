@@ -3,6 +3,7 @@
 
 #include "pch.hpp"
 #include "log_macros.hpp"
+#include "huge_page_alloc.hpp"
 
 template <typename BUFF_DATA_TYPE>
 class CircularBuffer
@@ -18,9 +19,10 @@ public:
     void reset();
     void clear();
     bool is_empty() const;
+    size_t size() const; // number of stored items, exact for the consumer thread
 
 private:
-    std::vector<BUFF_DATA_TYPE> buffer_;
+    huge_page_vector<BUFF_DATA_TYPE> buffer_;
     size_t capacity_;
     std::atomic<size_t> head_;
     std::atomic<size_t> tail_;
@@ -40,6 +42,7 @@ public:
     void resize(const size_t &capacity);
     void reset();
     void clear();
+    size_t size() const;
 
 private:
     CircularBuffer<COMPLEX_DATA_TYPE> samples_buffer;
@@ -137,6 +140,12 @@ bool CircularBuffer<BUFF_DATA_TYPE>::is_empty() const
     return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
 }
 
+template <typename BUFF_DATA_TYPE>
+size_t CircularBuffer<BUFF_DATA_TYPE>::size() const
+{
+    return (head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed)) & (capacity_ - 1);
+}
+
 template <typename COMPLEX_DATA_TYPE, typename TIME_DATA_TYPE>
 SyncedBufferManager<COMPLEX_DATA_TYPE, TIME_DATA_TYPE>::SyncedBufferManager(size_t buffer_size)
     : samples_buffer(buffer_size), timer_buffer(buffer_size)
@@ -200,6 +209,13 @@ bool SyncedBufferManager<COMPLEX_DATA_TYPE, TIME_DATA_TYPE>::pop(COMPLEX_DATA_TY
 //     return true;
 // }
 
+template <typename COMPLEX_DATA_TYPE, typename TIME_DATA_TYPE>
+size_t SyncedBufferManager<COMPLEX_DATA_TYPE, TIME_DATA_TYPE>::size() const
+{
+    // the timer is pushed after the sample -- it is the one that may lag
+    return timer_buffer.size();
+}
+
 template <typename COMPLEX_DATA_TYPE, typename TIME_DATA_TYPE>
 void SyncedBufferManager<COMPLEX_DATA_TYPE, TIME_DATA_TYPE>::resize(const size_t &capacity)
 {
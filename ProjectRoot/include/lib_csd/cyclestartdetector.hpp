@@ -3,21 +3,28 @@
 
 #include "pch.hpp"
 #include "log_macros.hpp"
-#include "config_parser.hpp"
+#include "config.hpp"
 #include "circular_buffer.hpp"
+#include "history_ring.hpp"
 #include "peakdetector.hpp"
+#include "cfar_detector.hpp"
 #include "utility.hpp"
 #include "FFTWrapper.hpp"
 #include "waveforms.hpp"
+#include "latency_probes.hpp"
+#include "sc16_samples.hpp"
 
 class CycleStartDetector
 {
 public:
-    CycleStartDetector(ConfigParser &parser, size_t &capacity, const uhd::time_spec_t &rx_sample_duration, PeakDetectionClass &peak_det_obj);
+    // `plan_source` -- detector of another RX channel whose FFT plans are shared (must outlive this one)
+    // `master_clock_rate` -- rate the USRP actually set (not the requested one), the sample times are its ticks
+    CycleStartDetector(std::shared_ptr<const Config> config, size_t &capacity, const uhd::time_spec_t &rx_sample_duration, const double &master_clock_rate, PeakDetectionClass &peak_det_obj, const CycleStartDetector *plan_source = nullptr);
 
     PeakDetectionClass peak_det_obj_ref;
 
     void produce(const std::vector<std::complex<float>> &samples, const size_t &samples_size, const uhd::time_spec_t &time, bool &stop_signal_called);
+    void produce(const std::vector<sc16_type> &samples, const size_t &samples_size, const uhd::time_spec_t &time, bool &stop_signal_called);
 
     void consume(std::atomic<bool> &csd_success_signal, bool &stop_signal_called);
 
@@ -32,25 +39,48 @@ public:
     size_t cfo_counter, cfo_count_max = size_t(2 * M_PI) * std::numeric_limits<size_t>::max() / 10;
     size_t save_ref_len;
 
+    // REF detections of the further ZFC roots (`Ref-extra-m-zfc`), called from the consumer thread -- logged if not set
+    std::function<void(const size_t &zfc_root, const uhd::time_spec_t &ref_start_time)> extra_root_callback;
+
     // debug
     std::string saved_ref_filename = "";
 
     size_t num_samples_without_peak = 0;
 
+    // backlog of the ring (samples) and number of blocks correlated in one batch at the last consume
+    size_t last_backlog_samples = 0, last_batch_blocks = 1;
+
+    // blocks skipped by the energy gate (`csd-energy-gate-db`) and its noise floor estimate (gate power of noise blocks, see max_window_power)
+    size_t gated_blocks = 0;
+    float gate_floor_power = 0.0;
+
 private:
-    SyncedBufferManager<std::complex<float>, uhd::time_spec_t> synced_buffer; // contains both samples_buffer and timer_buffer
+    // ring of received samples, in sc16 with `cpu-format sc16` (half the memory traffic), float otherwise
+    bool ring_sc16;
+    std::unique_ptr<SyncedBufferManager<std::complex<float>, sample_tick>> synced_buffer; // contains both samples_buffer and timer_buffer
+    std::unique_ptr<SyncedBufferManager<sc16_type, sample_tick>> synced_buffer_sc16;
+    std::vector<std::complex<float>> produce_fc32;
+    std::vector<sc16_type> produce_sc16, batch_samples_sc16;
+
+    template <typename RING_SAMPLE>
+    void push_packet(SyncedBufferManager<RING_SAMPLE, sample_tick> &ring, const RING_SAMPLE *samples, const size_t &samples_size, const uhd::time_spec_t &packet_start_time, bool &stop_signal_called);
+    template <typename RING_SAMPLE>
+    void pop_samples(SyncedBufferManager<RING_SAMPLE, sample_tick> &ring, RING_SAMPLE *samples, const size_t &num_samples, bool &stop_signal_called);
     // SyncedBufferManager<std::complex<float>, uhd::time_spec_t> saved_ref;
 
-    std::deque<std::complex<float>> samples_buffer;
-    std::vector<uhd::time_spec_t> timer;
+    std::vector<std::complex<float>> block_overlap; // last N_zfc - 1 samples of the previous block
+    std::vector<sample_tick> timer;
 
-    std::deque<std::complex<float>> saved_ref;
-    std::deque<uhd::time_spec_t> saved_ref_timer;
+    // last save_ref_len received samples and their times, for the REF after detection
+    HistoryRing<std::complex<float>> saved_ref;
+    HistoryRing<sample_tick> saved_ref_timer;
+    std::vector<std::complex<float>> cfo_corrected_ref;
 
     uhd::time_spec_t prev_timer;
 
-    ConfigParser parser;
+    std::shared_ptr<const Config> config;
     uhd::time_spec_t rx_sample_duration;
+    SampleClock sample_clock; // sample times in the ring, detectors and saved REF are ticks of this clock
 
     void reset();
     float est_e2e_ref_sig_amp();
@@ -67,13 +97,46 @@ private:
     // FFT related
     size_t fft_L = 1, fft_LL = 1;
     FFTWrapper fftw_wrapper, fftw_wrapper_LL;
-    std::vector<std::complex<float>> zfc_seq_fft_conj, zfc_seq_fft_conj_LL;
-    std::vector<std::complex<float>> fft_cross_correlate(const std::deque<std::complex<float>> &samples);
-    std::vector<std::complex<float>> fft_post_crosscorr(const std::deque<std::complex<float>> &samples);
-    void peak_detector(const std::vector<std::complex<float>> &corr_results, const std::vector<uhd::time_spec_t> &timer);
+    std::vector<std::complex<float>> zfc_seq_fft_conj_LL;
+
+    // multi-root correlation -- one forward FFT per block, one batched inverse FFT over all roots
+    std::vector<size_t> zfc_roots;                     // Ref-m-zfc first
+    std::vector<std::complex<float>> roots_fft_conj;   // conjugate spectra of all roots, fft_L each, back to back
+    std::vector<std::unique_ptr<PeakDetectionClass>> extra_root_peak_dets;
+    std::vector<std::vector<std::complex<float>>> fft_cross_correlate(const std::vector<std::complex<float>> &padded_windows, const size_t &num_blocks);
+
+    // batched correlation of blocks waiting in the ring
+    size_t max_batch_blocks = 1;
+    std::vector<std::complex<float>> batch_samples, padded_windows;
+    std::vector<sample_tick> batch_timer;
+    // energy gate -- a batch of blocks near the noise floor is not correlated
+    float gate_factor = 0.0; // linear, 0: gate disabled
+    std::vector<float> block_powers, gate_cells;
+    float max_window_power(const size_t &blk);
+    bool gate_batch(const size_t &num_blocks);
+    void skip_block(const std::vector<sample_tick> &timer);
+    void update_gate_floor(const float &block_power);
+    void reset_cfar();
+
+    void extra_root_detector(const size_t &root_index, const std::vector<std::complex<float>> &corr_results, const std::vector<sample_tick> &timer);
+    std::vector<std::complex<float>> fft_post_crosscorr(const std::vector<std::complex<float>> &samples);
+    // returns the number of block samples that go into the REF history
+    size_t peak_detector(const std::vector<std::complex<float>> &corr_results, const std::vector<sample_tick> &timer);
 
     bool update_noise_level = false;
+
+    // CFAR thresholds of the REF root and the further roots, null with `cfar-mode none`
+    std::unique_ptr<CfarDetector> cfar;
+    std::vector<std::unique_ptr<CfarDetector>> extra_root_cfars;
     float max_pnr = 0.0;
+
+    // latency probes -- host arrival time of produced packets, keyed by cumulative sample count
+    // (produced_samples is only written by the producer, the rest only by the consumer)
+    CircularBuffer<std::pair<size_t, int64_t>> packet_arrivals;
+    std::pair<size_t, int64_t> pending_arrival = {0, 0};
+    std::atomic<size_t> produced_samples{0};
+    size_t consumed_samples = 0;
+    int64_t peak_confirm_ns = 0;
 };
 
 #endif // CSD_CLASS
\ No newline at end of file
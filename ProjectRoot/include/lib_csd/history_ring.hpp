@@ -0,0 +1,89 @@
+#ifndef HISTORY_RING
+#define HISTORY_RING
+
+#include "pch.hpp"
+
+// contiguous run of ring items
+template <typename T>
+struct HistorySpan
+{
+    const T *data = nullptr;
+    size_t size = 0;
+};
+
+/** The last items of a HistoryRing, oldest first, as at most two spans (the second one after the
+ * ring wraps around). It points into the ring and stays valid until the next append.
+ */
+template <typename T>
+struct HistorySnapshot
+{
+    std::array<HistorySpan<T>, 2> spans;
+
+    size_t size() const { return spans[0].size + spans[1].size; }
+    const T &operator[](const size_t &n) const { return n < spans[0].size ? spans[0].data[n] : spans[1].data[n - spans[0].size]; }
+};
+
+/** Fixed-size history of a sample stream (single thread).
+ *
+ * Whole blocks are appended with at most two copies, and the last `len` items are read in place
+ * as a HistorySnapshot -- no per-item shifting as with pop_front / push_back on a deque.
+ * The history starts zero filled.
+ */
+template <typename T>
+class HistoryRing
+{
+public:
+    HistoryRing(const size_t &capacity = 0) { resize(capacity); }
+
+    void resize(const size_t &capacity)
+    {
+        buffer_.assign(capacity, T());
+        write_pos_ = 0;
+    }
+
+    void clear()
+    {
+        std::fill(buffer_.begin(), buffer_.end(), T());
+        write_pos_ = 0;
+    }
+
+    size_t capacity() const { return buffer_.size(); }
+
+    void append(const T *items, size_t num_items)
+    {
+        const size_t cap = buffer_.size();
+        if (cap == 0)
+            return;
+        // only the last `cap` items survive
+        if (num_items > cap)
+        {
+            items += num_items - cap;
+            num_items = cap;
+        }
+        const size_t first = std::min(num_items, cap - write_pos_);
+        std::copy(items, items + first, buffer_.begin() + write_pos_);
+        std::copy(items + first, items + num_items, buffer_.begin());
+        write_pos_ = (write_pos_ + num_items) % cap;
+    }
+
+    // the last `len` items (at most the capacity)
+    HistorySnapshot<T> last(size_t len) const
+    {
+        const size_t cap = buffer_.size();
+        len = std::min(len, cap);
+        HistorySnapshot<T> snapshot;
+        if (len == 0)
+            return snapshot;
+        const size_t start = (write_pos_ + cap - len) % cap;
+        const size_t first = std::min(len, cap - start);
+        snapshot.spans[0] = {buffer_.data() + start, first};
+        snapshot.spans[1] = {buffer_.data(), len - first};
+        return snapshot;
+    }
+
+private:
+    std::vector<T> buffer_;
+    size_t write_pos_ = 0; // index of the oldest item = next item written
+};
+
+#endif // HISTORY_RING
@@ -0,0 +1,71 @@
+#ifndef MULTICHANNEL_CSD
+#define MULTICHANNEL_CSD
+
+#include "pch.hpp"
+#include "log_macros.hpp"
+#include "config.hpp"
+#include "cyclestartdetector.hpp"
+#include "peakdetector.hpp"
+
+enum class RxCombining
+{
+    SELECTION,   // strongest channel only
+    SNR_WEIGHTED // mean of all channels, weighted with their SNRs
+};
+
+RxCombining parse_rx_combining(const std::string &name);
+
+/** Combined estimate of per-channel signal powers with per-channel noise powers.
+ * Selection picks the channel of highest SNR, snr_weighted weighs each channel with its SNR.
+ * This is not maximal-ratio combining: only powers are combined, without channel phases, so
+ * the SNRs of the channels do not add up.
+ *
+ * @param strongest index of the channel with the highest SNR
+ */
+float combine_channel_powers(const std::vector<float> &signal_powers, const std::vector<float> &noise_powers, const RxCombining &combining, size_t &strongest);
+
+/** Cycle start detection on all streamed RX channels.
+ *
+ * Every channel has its own CycleStartDetector (buffers, peak detector, CFO state), channel 0
+ * owns the FFT plans and the others share them. Each channel is consumed by its own thread;
+ * `detection_complete` combines the channels once all of them detected the REF, or once the
+ * first detection is `grace_samples` old.
+ */
+class MultiChannelCSD
+{
+public:
+    MultiChannelCSD(std::shared_ptr<const Config> config, size_t &capacity, const uhd::time_spec_t &rx_sample_duration, const double &master_clock_rate, const float &init_noise_ampl, const size_t &num_channels, const RxCombining &combining);
+
+    // one buffer per channel, `samples_size` samples each
+    void produce(const std::vector<std::vector<std::complex<float>>> &samples, const size_t &samples_size, const uhd::time_spec_t &time, bool &stop_signal_called);
+    void produce(const std::vector<std::vector<sc16_type>> &samples, const size_t &samples_size, const uhd::time_spec_t &time, bool &stop_signal_called);
+
+    void consume(const size_t &channel, bool &stop_signal_called);
+
+    // true once the REF is detected, sets `est_ref_sig_pow`, `csd_wait_timer` and `cfo`
+    bool detection_complete();
+
+    // clears the detections of all channels for the next round
+    void reset_detections();
+
+    void set_noise_ampl(const float &noise_ampl);
+
+    size_t num_channels() const { return csds.size(); }
+
+    float est_ref_sig_pow = 0.0;
+    uhd::time_spec_t csd_wait_timer;
+    double cfo = 0.0;
+
+private:
+    RxCombining combining;
+    std::vector<std::unique_ptr<PeakDetectionClass>> peak_dets;
+    std::vector<std::unique_ptr<CycleStartDetector>> csds;
+    std::unique_ptr<std::atomic<bool>[]> channel_success;
+
+    size_t grace_samples, samples_since_detection = 0;
+
+    template <typename SAMPLE>
+    void produce_channels(const std::vector<std::vector<SAMPLE>> &samples, const size_t &samples_size, const uhd::time_spec_t &time, bool &stop_signal_called);
+};
+
+#endif // MULTICHANNEL_CSD
@@ -3,18 +3,20 @@
 
 #include "pch.hpp"
 #include "log_macros.hpp"
-#include "config_parser.hpp"
+#include "config.hpp"
 #include "utility.hpp"
+#include "sample_clock.hpp"
+#include "history_ring.hpp"
 
 class PeakDetectionClass
 {
 private:
-    ConfigParser parser;
+    std::shared_ptr<const Config> config;
 
     size_t *peak_indices;
     std::complex<float> *corr_samples;
     float *peak_vals;
-    uhd::time_spec_t *peak_times;
+    sample_tick *peak_times;
 
     size_t total_num_peaks;
 
@@ -30,7 +32,7 @@ private:
 
     bool is_update_pnr_threshold;
 
-    void insertPeak(const std::complex<float> &corr_sample, float &peak_val, const uhd::time_spec_t &peak_time);
+    void insertPeak(const std::complex<float> &corr_sample, float &peak_val, const sample_tick &peak_time);
     void update_pnr_threshold();
     void updatePrevPeak();
     void removeLastPeak();
@@ -38,7 +40,7 @@ private:
     bool check_peaks();
 
 public:
-    PeakDetectionClass(ConfigParser &parser, const float &init_noise_ampl);
+    PeakDetectionClass(std::shared_ptr<const Config> config, const float &init_noise_ampl);
 
     size_t peaks_count;
     size_t prev_peak_index;
@@ -50,22 +52,30 @@ public:
     long int noise_counter;
 
     std::complex<float> *get_corr_samples_at_peaks();
-    uhd::time_spec_t *get_peak_times();
+    sample_tick *get_peak_times();
+
+    // converts the peak ticks to USRP time -- the CycleStartDetector sets it to its own clock
+    SampleClock sample_clock;
     void print_peaks_data();
 
     void reset_peaks_counter();
     void reset();
 
-    void process_corr(const std::complex<float> &abs_corr_val, const uhd::time_spec_t &samp_time);
+    void process_corr(const std::complex<float> &abs_corr_val, const sample_tick &samp_time);
     void increase_samples_counter();
 
     void updateNoiseLevel(const float &corr_val, const size_t &num_samps);
+    // noise amplitude from the CFAR noise power of correlation lags, between REFs only
+    void updateNoiseFromCfar(const float &corr_noise_power);
 
     float avg_of_peak_vals();
+
+    // time of the first REF peak, refined to a fraction of a sample by `updatePeaksAfterCFO`
     uhd::time_spec_t get_ref_start_time();
+    float ref_start_frac_offset = 0.0; // samples, in [-0.5, 0.5]
 
     float estimate_phase_drift();
-    int updatePeaksAfterCFO(const std::vector<float> &abs_corr_vals, const std::deque<uhd::time_spec_t> &new_timer);
+    int updatePeaksAfterCFO(const std::vector<float> &abs_corr_vals, const HistorySnapshot<sample_tick> &new_timer);
 };
 
 #endif // PEAK_CLASS
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include "pch.hpp"
 #include "log_macros.hpp"
+#include "huge_page_alloc.hpp"
 #include <fftw3.h>
 
 class FFTWrapper
@@ -13,6 +14,9 @@ public:
 
     void initialize(size_t size, int num_threads = 1);
 
+    // own buffers, plans borrowed from `owner` (which must outlive this object) -- one plan for several channels
+    void share_plans(const FFTWrapper &owner);
+
     // Perform FFT of input array
     void fft(const std::vector<std::complex<float>> &input,
              std::vector<std::complex<float>> &output);
@@ -21,11 +25,19 @@ public:
     void ifft(const std::vector<std::complex<float>> &input,
               std::vector<std::complex<float>> &output);
 
+    // Batched FFT/iFFT -- `howmany` transforms of the initialized size, stored back to back.
+    // Plans are made once per batch size by `initialize_many`.
+    void initialize_many(const size_t &howmany);
+    void fft_many(const std::vector<std::complex<float>> &input,
+                  std::vector<std::complex<float>> &output, const size_t &howmany);
+    void ifft_many(const std::vector<std::complex<float>> &input,
+                   std::vector<std::complex<float>> &output, const size_t &howmany);
+
     // Zero-pad the input data to a specified length
     void zeroPad(const std::vector<std::complex<float>> &input,
-                 std::vector<std::complex<float>> &output, int paddedSize);
+                 std::vector<std::complex<float>> &output, size_t paddedSize);
     void zeroPad(const std::deque<std::complex<float>> &input,
-                 std::vector<std::complex<float>> &output, int paddedSize);
+                 std::vector<std::complex<float>> &output, size_t paddedSize);
 
     // Filtering
     void lowPassFilter(const std::vector<std::complex<float>> &inputSignal,
@@ -38,6 +50,16 @@ private:
     fftw_complex *fft_output_;
     fftw_plan fft_plan_;
     fftw_plan ifft_plan_;
+    bool shared_plans_ = false;
+
+    struct BatchPlans
+    {
+        fftw_complex *input = nullptr;
+        fftw_complex *output = nullptr;
+        fftw_plan fft_plan, ifft_plan;
+    };
+    std::map<size_t, BatchPlans> batch_plans_;
+    BatchPlans &get_batch_plans(const size_t &howmany);
 };
 
 #endif // FFT_WRAPPER_H
\ No newline at end of file
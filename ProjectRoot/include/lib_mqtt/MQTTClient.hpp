@@ -5,19 +5,51 @@
 #include "log_macros.hpp"
 #include "utility.hpp"
 #include "config_parser.hpp"
+#include "latency_probes.hpp"
+#include "event_sync.hpp"
+#include "mqtt_transport.hpp"
+#include <condition_variable>
 
-class MQTTClient : public mqtt::callback
+class MQTTClient
 {
 public:
     // Singleton access method
     static MQTTClient &getInstance(const std::string &clientId = "nuc");
 
+    // Broker used by the singleton (config `mqtt-broker`), must be set before the first getInstance
+    static void setBrokerAddress(const std::string &server_uri);
+
+    // Additional client, e.g. one per simulated node on a loopback:// broker
+    static std::unique_ptr<MQTTClient> create(const std::string &clientId, const std::string &server_uri);
+
+    ~MQTTClient();
+
     // Connect to the MQTT broker
     bool connect();
 
-    // Publish a message to a topic
+    // Queue a message for publishing, never blocks on the network
     bool publish(const std::string &topic, const std::string &message, bool retained = false);
 
+    // Wait until the outbound queue is drained, returns false on timeout
+    bool flush(const std::chrono::milliseconds &timeout = std::chrono::milliseconds(5000));
+
+    struct PublishStats
+    {
+        uint64_t queued, published, failed, dropped, coalesced;
+        size_t queue_depth;
+    };
+    PublishStats get_publish_stats();
+
+    struct DispatchStats
+    {
+        uint64_t dispatched, handled;
+        size_t queue_depth, max_queue_depth, busy_workers;
+    };
+    DispatchStats get_dispatch_stats();
+
+    // Called from the sender thread for each message that could not be delivered
+    void setPublishFailureCallback(const std::function<void(const std::string &topic, const std::string &error)> &callback);
+
     // Subscribe to a topic
     bool subscribe(const std::string &topic);
     void unsubscribe(const std::string &topic);
@@ -25,6 +57,10 @@ public:
     // Set a callback for incoming messages
     void setCallback(const std::string &topic, const std::function<void(const std::string &)> &callback, bool run_in_thread = false);
 
+    // One callback for all topics matching a `+`/`#` filter, e.g. the flags of every leaf.
+    // Topics with a callback of their own are not passed to filter callbacks.
+    void setFilterCallback(const std::string &topic_filter, const std::function<void(const std::string &topic, const std::string &payload)> &callback, bool run_in_thread = false);
+
     // Thread handler for MQTT message listening
     void startListening();
     void stopListening();
@@ -36,16 +72,42 @@ public:
     std::string timestamp_float_data(const float &data);
     std::string timestamp_str_data(const std::string &data);
 
+    /** Telemetry payload encoding (config `mqtt-payload-format`).
+     *
+     * JSON keeps the original text format with a local-time "time" string.
+     * CBOR sends numbers as numbers, with the schema version in "v" and the
+     * timestamp as integer ticks "t" at tick rate "tr" (Hz).
+     */
+    enum class PayloadFormat
+    {
+        JSON,
+        CBOR
+    };
+    static const int payload_schema_version = 1;
+    static bool parsePayloadFormat(const std::string &name, PayloadFormat &format);
+    void setPayloadFormat(const PayloadFormat &format);
+
+    // Clock used for "t", defaults to the monotonic clock of the latency probes (ns)
+    void setTickSource(const std::function<int64_t()> &source, const double &tick_rate);
+
+    // Encode a telemetry record, adding timestamp and schema version
+    std::string encode_payload(json data);
+
+    // Decode a JSON or CBOR payload, logs and returns false on malformed data
+    static bool decode_payload(const std::string &payload, json &data);
+    // Read the "value" field of a timestamp_*_data payload in either format
+    static bool payload_value(const std::string &payload, float &value);
+    static bool payload_value(const std::string &payload, std::string &value);
+
     std::unique_ptr<ConfigParser> topics;
     bool temporary_listen_for_last_value(std::string &val, const std::string &topic, const float &wait_count = 30, const size_t &wait_time = 50);
 
 private:
     // Mutex for thread-safe implementation
-    static std::mutex mqtt_mutex;
-    static std::mutex callback_mutex;
+    std::mutex mqtt_mutex;
+    std::mutex callback_mutex;
 
-    // Private constructor with fixed server address
-    MQTTClient(const std::string &clientId);
+    MQTTClient(const std::string &clientId, const std::string &server_uri);
 
     // Prevent copying
     MQTTClient(const MQTTClient &) = delete;
@@ -54,21 +116,77 @@ private:
     // Internal callback for MQTT messages
     void onMessage(const std::string &topic, const std::string &payload);
 
-    boost::thread mqttThread;
-    bool isRunning;
+    // Outbound queue drained by the sender thread. Retained messages are kept
+    // in `pending_retained` so repeated updates of a topic collapse to the
+    // latest value while it waits in the queue.
+    struct OutboundMessage
+    {
+        std::string topic, payload;
+        bool retained;
+        int64_t enqueue_ns;
+    };
+    void senderLoop();
+    void deliver(std::vector<OutboundMessage> &batch);
+
+    std::mutex outbound_mutex;
+    std::condition_variable outbound_cv, drained_cv;
+    std::deque<OutboundMessage> outbound_queue;
+    std::unordered_map<std::string, std::string> pending_retained;
+    size_t in_flight = 0;
+    boost::thread senderThread;
+    std::atomic<bool> senderRunning{false};
+    std::function<void(const std::string &, const std::string &)> publish_failure_callback;
+    std::atomic<uint64_t> count_queued{0}, count_published{0}, count_failed{0}, count_dropped{0}, count_coalesced{0};
+
+    static const size_t max_outbound_queue = 4096;
+    static const size_t max_publish_batch = 32;
 
-    // MQTT client instance
-    mqtt::async_client client;
-    mqtt::connect_options connectOptions;
+    boost::thread mqttThread;
+    std::atomic<bool> isRunning{false};
+    std::mutex listen_mutex;
+    std::condition_variable listen_cv;
+
+    // Callbacks registered with run_in_thread run on a fixed pool of workers.
+    // Each topic has its own FIFO and is scheduled on at most one worker at a
+    // time, so messages of a topic are handled in order while different topics
+    // run in parallel.
+    struct TopicQueue
+    {
+        std::deque<std::pair<std::string, int64_t>> payloads; // payload, enqueue time
+        std::function<void(const std::string &)> callback;
+        bool scheduled = false;
+    };
+    void dispatch(const std::string &topic, const std::function<void(const std::string &)> &callback, const std::string &payload);
+    void dispatchLoop();
+
+    std::mutex dispatch_mutex;
+    std::condition_variable dispatch_cv;
+    std::unordered_map<std::string, TopicQueue> topic_queues;
+    std::deque<std::string> ready_topics;
+    boost::thread_group dispatch_workers;
+    bool dispatchRunning = false;
+    size_t dispatch_depth = 0, max_dispatch_depth = 0, busy_workers = 0;
+    uint64_t count_dispatched = 0, count_handled = 0;
+
+    static const size_t dispatch_pool_size = 4;
+
+    std::atomic<PayloadFormat> payload_format{PayloadFormat::JSON};
+    std::mutex tick_mutex;
+    std::function<int64_t()> tick_source;
+    double tick_rate = 1e9;
+
+    // connection to the broker (paho or in-process loopback)
+    std::unique_ptr<MQTTTransport> transport;
 
     // Map to store topic and associated callback
     std::unordered_map<std::string, std::pair<std::function<void(const std::string &)>, bool>> callbacks;
+    std::map<std::string, std::pair<std::function<void(const std::string &, const std::string &)>, bool>> filter_callbacks;
 
     // Static instance pointer
     static MQTTClient *instance;
 
-    // Fixed server address
-    static const std::string serverAddress;
+    // Broker address used by getInstance
+    static std::string serverAddress;
 };
 
 #endif // MQTTCLIENT
\ No newline at end of file
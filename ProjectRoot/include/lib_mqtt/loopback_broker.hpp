@@ -0,0 +1,84 @@
+#ifndef LOOPBACK_BROKER
+#define LOOPBACK_BROKER
+
+#include "pch.hpp"
+#include "log_macros.hpp"
+#include "mqtt_transport.hpp"
+#include <condition_variable>
+
+class LoopbackTransport;
+
+/** In-process MQTT broker for running several nodes in one process.
+ *
+ * Implements the parts of MQTT the control plane relies on: topic filters with
+ * `+` and `#` wildcards, retained messages (an empty retained payload clears
+ * the topic) and QoS 1 -- a publish is acknowledged once the message has been
+ * queued to every matching subscriber, which then receives it exactly once per
+ * session. Sessions are clean; connecting with a client id that is already
+ * attached takes over the old session.
+ */
+class LoopbackBroker
+{
+public:
+    // broker instance for `loopback://<name>`, created on first use
+    static std::shared_ptr<LoopbackBroker> get(const std::string &name);
+
+    void attach(const std::string &client_id, LoopbackTransport *session);
+    void detach(const std::string &client_id, LoopbackTransport *session);
+
+    bool publish(const std::string &topic, const std::string &payload, const bool &retained);
+    void subscribe(const std::string &client_id, const std::string &topic_filter);
+    void unsubscribe(const std::string &client_id, const std::string &topic_filter);
+
+    size_t num_retained();
+
+private:
+    struct Session
+    {
+        LoopbackTransport *transport;
+        std::set<std::string> topic_filters;
+    };
+
+    std::mutex broker_mutex;
+    std::map<std::string, Session> sessions;
+    std::map<std::string, std::string> retained_messages;
+};
+
+/** Transport attached to a LoopbackBroker. Messages are handed to the message
+ * handler by a delivery thread of this transport, like paho's callback thread.
+ */
+class LoopbackTransport : public MQTTTransport
+{
+public:
+    LoopbackTransport(const std::string &broker_name, const std::string &client_id);
+    ~LoopbackTransport();
+
+    void set_message_handler(const MessageHandler &handler) override;
+    bool connect(std::string &error) override;
+    void disconnect() override;
+    void publish_batch(const std::vector<TransportMessage> &batch, const Deadline &deadline, std::vector<std::string> &errors) override;
+    bool subscribe(const std::string &topic_filter, const Deadline &deadline, std::string &error) override;
+    bool unsubscribe(const std::string &topic_filter, std::string &error) override;
+    std::string server_uri() const override { return "loopback://" + broker_name; }
+
+    // called by the broker with its lock held, must not block
+    void enqueue(const std::string &topic, const std::string &payload);
+    // called by the broker when another client takes over this client id
+    void on_session_taken_over();
+
+private:
+    void deliveryLoop();
+
+    std::string broker_name, client_id;
+    std::shared_ptr<LoopbackBroker> broker;
+    MessageHandler message_handler;
+    std::atomic<bool> connected{false};
+
+    std::mutex inbound_mutex;
+    std::condition_variable inbound_cv;
+    std::deque<std::pair<std::string, std::string>> inbound_queue;
+    bool deliveryRunning = false;
+    boost::thread deliveryThread;
+};
+
+#endif // LOOPBACK_BROKER
@@ -0,0 +1,74 @@
+#ifndef MQTT_TRANSPORT
+#define MQTT_TRANSPORT
+
+#include "pch.hpp"
+#include "log_macros.hpp"
+#include "event_sync.hpp"
+
+struct TransportMessage
+{
+    std::string topic, payload;
+    bool retained;
+};
+
+/** Connection to an MQTT broker as used by MQTTClient.
+ *
+ * All operations use QoS 1. Incoming messages are passed to the message handler
+ * from a single transport thread, in the order the broker delivers them.
+ * The broker is selected by URI: `tcp://host:port` (or ssl://, ws://) connects
+ * to a real broker through paho, `loopback://<name>` attaches to the in-process
+ * broker of that name (see loopback_broker.hpp).
+ */
+class MQTTTransport
+{
+public:
+    using MessageHandler = std::function<void(const std::string &topic, const std::string &payload)>;
+
+    static std::unique_ptr<MQTTTransport> create(const std::string &server_uri, const std::string &client_id);
+
+    // MQTT topic filter matching with `+` and `#` wildcards
+    static bool topic_matches(const std::string &topic_filter, const std::string &topic);
+
+    virtual ~MQTTTransport() = default;
+
+    // must be set before connect
+    virtual void set_message_handler(const MessageHandler &handler) = 0;
+
+    virtual bool connect(std::string &error) = 0;
+    virtual void disconnect() = 0;
+
+    /**
+     * @brief Publishes all messages and waits for their acknowledgements.
+     * @param batch    messages to publish
+     * @param deadline stop waiting for acknowledgements at this point
+     * @param errors   resized to batch size, empty string for each acknowledged message
+     */
+    virtual void publish_batch(const std::vector<TransportMessage> &batch, const Deadline &deadline, std::vector<std::string> &errors) = 0;
+
+    virtual bool subscribe(const std::string &topic_filter, const Deadline &deadline, std::string &error) = 0;
+    virtual bool unsubscribe(const std::string &topic_filter, std::string &error) = 0;
+
+    virtual std::string server_uri() const = 0;
+};
+
+/** Transport to an external broker (e.g. mosquitto) via the paho async client. */
+class PahoTransport : public MQTTTransport
+{
+public:
+    PahoTransport(const std::string &server_uri, const std::string &client_id);
+
+    void set_message_handler(const MessageHandler &handler) override;
+    bool connect(std::string &error) override;
+    void disconnect() override;
+    void publish_batch(const std::vector<TransportMessage> &batch, const Deadline &deadline, std::vector<std::string> &errors) override;
+    bool subscribe(const std::string &topic_filter, const Deadline &deadline, std::string &error) override;
+    bool unsubscribe(const std::string &topic_filter, std::string &error) override;
+    std::string server_uri() const override { return uri; }
+
+private:
+    std::string uri;
+    mqtt::async_client client;
+    mqtt::connect_options connectOptions;
+};
+
+#endif // MQTT_TRANSPORT
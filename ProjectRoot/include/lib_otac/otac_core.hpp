@@ -0,0 +1,82 @@
+#ifndef OTAC_CORE
+#define OTAC_CORE
+
+#include "pch.hpp"
+#include "log_macros.hpp"
+#include "waveforms.hpp"
+#include "FFTWrapper.hpp"
+
+/** Waveforms of an OTAC frame: full-scale prefix, zero padding, OTAC segment.
+ * Leafs transmit `fs` at full scale followed by `otac` scaled by the pre-processed input.
+ * `fs` and `otac` come from different seeds -- with a common seed the OTAC segment starts with
+ * `fs` and the matched filter sees a second frame start inside the segment.
+ */
+struct OtacWaveforms
+{
+    static constexpr size_t fs_seed = 2, otac_seed = 1;
+
+    std::vector<std::complex<float>> fs, otac;
+    size_t segment_offset = 0, segment_len = 0; // OTAC segment within the frame
+
+    static OtacWaveforms generate(const size_t &otac_wf_len);
+
+    size_t frame_len() const { return segment_offset + segment_len; }
+};
+
+/** Pre- and post-processing of the OTAC scheme.
+ * Leafs map their input in [dmin, dmax] to the power of the OTAC segment, the cent maps the
+ * power of the superimposed segments back to the sum of the inputs.
+ */
+struct OtacScaling
+{
+    float dmin, dmax, min_e2e_pow, num_leafs;
+
+    /**
+     * @param input      leaf input, must be inside [dmin, dmax]
+     * @param ctol       channel power cent -> leaf
+     * @param full_scale calibrated full scale of the leaf
+     * @param sig_scale  amplitude scale of the OTAC segment
+     */
+    bool pre_process(const float &input, const float &ctol, const float &full_scale, float &sig_scale) const;
+
+    // `out_val` is set even if it is outside the permissible bounds [dmin, dmax] x num_leafs
+    bool post_process(const float &sig_power, const float &noise_power, float &out_val) const;
+
+    static float nmse(const float &val1, const float &val2);
+};
+
+/** Matched-filter detection of an OTAC frame in a received window.
+ *
+ * The window is cross-correlated with the full-scale prefix via FFT (the FFT of the prefix is
+ * computed once per window size). Every detector owns its FFT plans and buffers, so one
+ * detector must be used by a single thread only.
+ */
+class OtacDetector
+{
+public:
+    OtacDetector(const OtacWaveforms &waveforms, const size_t &window_len, const int &num_fft_threads = 1);
+
+    struct Detection
+    {
+        bool detected = false;
+        float confidence = 0.0;   // correlation peak power over mean off-peak correlation power
+        float signal_power = 0.0; // mean power of the OTAC segment of the detected frame
+        float noise_power = 0.0;  // mean power of the window outside the detected frame, 0 if there is none
+        double frame_start = 0.0; // sub-sample start of the frame, in samples from the window start
+    };
+
+    Detection detect(const std::vector<std::complex<float>> &signal);
+
+    size_t window_len() const { return max_window_len; }
+
+    // max of ~10^4 off-peak correlation powers of noise is ~ln(10^4) = 9 times their mean
+    float min_confidence = 30.0;
+
+private:
+    size_t fft_L = 1, max_window_len, segment_offset, segment_len, frame_len;
+    std::unique_ptr<FFTWrapper> fft;
+    std::vector<std::complex<float>> fs_fft_conj, fft_in, fft_out;
+    std::vector<float> corr_pow;
+};
+
+#endif // OTAC_CORE
@@ -4,15 +4,18 @@
 #include "pch.hpp"
 #include "log_macros.hpp"
 #include "usrp_class.hpp"
-#include "config_parser.hpp"
+#include "config.hpp"
 #include "MQTTClient.hpp"
-#include "cyclestartdetector.hpp"
+#include "multichannel_csd.hpp"
 #include "waveforms.hpp"
+#include "event_sync.hpp"
+#include "otac_core.hpp"
+#include "thread_sched.hpp"
 
 class OTAC_class
 {
 public:
-    OTAC_class(USRP_class &usrp_obj, ConfigParser &parser, const std::string &device_id, const std::string &device_type, const float &otac_input, const float &dmin, const float &dmax, const size_t &num_leafs, bool &signal_stop_called);
+    OTAC_class(USRP_class &usrp_obj, std::shared_ptr<const Config> config, const std::string &device_id, const std::string &device_type, const float &otac_input, const float &dmin, const float &dmax, const size_t &num_leafs, bool &signal_stop_called);
     ~OTAC_class();
 
     bool initialize();
@@ -24,15 +27,16 @@ public:
     float otac_input, dmin, dmax, num_leafs;
 
 private:
-    ConfigParser parser;
     std::shared_ptr<USRP_class> usrp_obj;
-    std::unique_ptr<CycleStartDetector> csd_obj;
-    std::unique_ptr<PeakDetectionClass> peak_det_obj;
-    std::vector<std::complex<float>> ref_waveform, otac_waveform, fs_waveform;
+    std::shared_ptr<const Config> config;
+    std::unique_ptr<MultiChannelCSD> csd_obj;
+    RxCombining rx_combining = RxCombining::SELECTION;
+    std::vector<std::complex<float>> ref_waveform;
+    OtacWaveforms otac_waveforms;
 
-    void initialize_peak_det_obj();
     void initialize_csd_obj();
     void generate_waveform();
+    void initialize_otac_detector();
     void get_mqtt_topics();
 
     bool otac_pre_processing(float &sig_scale);
@@ -41,8 +45,17 @@ private:
     bool transmission_ref(const float &scale = 1.0, const uhd::time_spec_t &tx_timer = uhd::time_spec_t(0.0));
     bool transmission_otac(const float &scale = 1.0, const uhd::time_spec_t &tx_timer = uhd::time_spec_t(0.0));
     bool reception_ref(float &rx_sig_pow, uhd::time_spec_t &tx_timer);
-    bool reception_otac(float &otac_sig_pow, uhd::time_spec_t &tx_timer);
-    bool otac_signal_detection(const std::vector<std::complex<float>> &signal, float &signal_power, uhd::time_spec_t &signal_start_timer, const size_t &detection_type_id = 0);
+    /** Matched-filter detection of an OTAC frame (full-scale prefix followed by the OTAC segment), see OtacDetector.
+     * With several RX channels, each channel is detected in parallel and the signal powers are combined as in `rx-combining`,
+     * weighted with the noise power of each channel outside its detected frame.
+     *
+     * @param channel_signals    received window of every RX channel, starting at `signal_start_timer`
+     * @param signal_power       mean power of the OTAC segment of the detected frame
+     * @param signal_start_timer moved to the (sub-sample) start of the detected frame
+     * @param confidence         correlation peak power over mean off-peak correlation power (best channel)
+     * @return true if a frame was found with confidence above `OtacDetector::min_confidence`
+     */
+    bool otac_signal_detection(const std::vector<std::vector<std::complex<float>>> &channel_signals, float &signal_power, uhd::time_spec_t &signal_start_timer, float &confidence);
 
     float compute_nmse(const float &val1, const float &val2);
     void callback_detect_flags(const std::string &payload);
@@ -50,7 +63,17 @@ private:
     bool check_ctol();
 
     std::atomic<bool> csd_success_flag;
-    boost::thread producer_thread, consumer_thread;
+    boost::thread producer_thread, consumer_thread, ref_scheduler_thread;
+    std::vector<boost::thread> channel_consumer_threads; // CSD of RX channels other than the first
+
+    // OTAC detection of RX channels other than the first, one persistent worker per channel (cent only)
+    std::vector<std::unique_ptr<BoundedQueue<const std::vector<std::complex<float>> *>>> detection_jobs;
+    std::unique_ptr<BoundedQueue<size_t>> detection_done;
+    std::vector<OtacDetector::Detection> channel_detections;
+    std::vector<boost::thread> detection_threads;
+    void start_detection_workers();
+    void stop_detection_workers();
+    void detection_worker(const size_t &channel);
 
     /** OTAC protocol.
      * 1. Cent transmits ref -- Leafs detects, estimates channel power, and adjusts CFO and RX-gain.
@@ -59,10 +82,46 @@ private:
      * 4. Process is repeated multiple times to get a histogram of errors
      */
     void producer_leaf_proto();
-    void consumer_leaf_proto();
+    void consumer_leaf_proto(const size_t &channel = 0);
     void producer_cent_proto();
     void consumer_cent_proto();
 
+    /** Pipelined OTAC rounds on the cent.
+     * Round k+1's REF is submitted as a timed burst (ref_scheduler_cent_proto) while round k's OTAC
+     * window is captured (producer_cent_proto) and round k-1 is detected and post-processed
+     * (consumer_cent_proto). Rounds are `otac_round_period` apart in device time, so the rate is
+     * bounded by air time and leaf turnaround only.
+     */
+    void ref_scheduler_cent_proto();
+    void report_round_pipeline();
+
+    struct OtacRoundSlot
+    {
+        size_t round = 0;
+        uhd::time_spec_t ref_timer;
+        int64_t scheduled_ns = 0; // host time the round was scheduled
+    };
+
+    struct OtacCapture
+    {
+        OtacRoundSlot slot;
+        uhd::time_spec_t otac_timer;
+        std::vector<std::vector<std::complex<float>>> channel_samples; // one window per RX channel
+    };
+
+    // stage -> stage, capacities keep the REF scheduler at most one round ahead of the capture
+    BoundedQueue<OtacRoundSlot> scheduled_rounds{1};
+    BoundedQueue<OtacCapture> captured_rounds{4};
+
+    // per-stage busy time, written by the owning stage thread, reported once all stages are done
+    struct PipelineStats
+    {
+        std::atomic<int64_t> tx_ns{0}, rx_ns{0}, proc_ns{0}, round_ns{0};
+        std::atomic<size_t> scheduled{0}, captured{0}, processed{0}, accepted{0}, slipped{0};
+        int64_t start_ns = 0;
+    } pipeline_stats;
+    double otac_round_period = 0.0; // device time between two REF bursts, in secs
+
     std::string device_id, device_type;
     std::string tele_otac_topic;
     size_t max_total_round = 50;
@@ -71,6 +130,9 @@ private:
     float noise_power;
     std::vector<float> otac_output_list, nmse_list;
 
+    // OTAC frame detector per RX channel, cent only
+    std::vector<std::unique_ptr<OtacDetector>> otac_detectors;
+
     float init_proximity_tol = 0.04, proximity_tol = 0.01;
     float min_e2e_pow = 1.0, max_e2e_pow = 1.0;
 };
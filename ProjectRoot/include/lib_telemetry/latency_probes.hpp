@@ -0,0 +1,122 @@
+#ifndef LATENCY_PROBES
+#define LATENCY_PROBES
+
+#include "pch.hpp"
+#include "log_macros.hpp"
+#include "utility.hpp"
+
+/** Log-linear (HDR-style) histogram of latency values in nanoseconds.
+ *
+ * Values below 2^SUB_BUCKET_BITS are counted exactly, larger values are binned
+ * with SUB_BUCKET_BITS bits of precision (relative error < 1/32). Each shard is
+ * written by a single thread only, so recording is a couple of relaxed atomic
+ * ops and never blocks; the reporter thread reads the same atomics to merge.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr size_t SUB_BUCKET_BITS = 5;
+    static constexpr size_t SUB_BUCKET_COUNT = size_t(1) << SUB_BUCKET_BITS;
+    static constexpr size_t MAX_VALUE_BITS = 40; // ~18 minutes in nanoseconds
+    static constexpr size_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    LatencyHistogram();
+
+    void record(const uint64_t &value_ns);
+
+    // merge counts of this shard into plain (non-atomic) accumulators
+    void merge_into(std::vector<uint64_t> &counts, uint64_t &total, uint64_t &sum, uint64_t &min_val, uint64_t &max_val) const;
+
+    static size_t bucket_index(uint64_t value_ns);
+    static uint64_t bucket_value(const size_t &index);
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+    std::atomic<uint64_t> total_, sum_, min_, max_;
+};
+
+/** Registry of named latency probes and event counters.
+ *
+ * Probes are registered once by name and addressed by id afterwards. Each thread
+ * records into its own shard (created on first use), so the hot path is
+ * lock-free. `snapshot_json` merges all shards; `start_reporter` runs a thread
+ * that periodically appends snapshots to a file and hands them to a publisher
+ * (typically an MQTT telemetry topic).
+ */
+class LatencyProbes
+{
+public:
+    static LatencyProbes &getInstance();
+
+    size_t register_probe(const std::string &name);
+    size_t register_counter(const std::string &name);
+
+    void record(const size_t &probe_id, const int64_t &value_ns);
+    void increment(const size_t &counter_id, const uint64_t &count = 1);
+
+    json snapshot_json();
+
+    void start_reporter(const std::string &filename, const size_t &period_ms, const std::function<void(const std::string &)> &publisher = nullptr);
+    void stop_reporter();
+
+    // monotonic host clock used by all probes
+    static inline int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    LatencyProbes() = default;
+    ~LatencyProbes();
+    LatencyProbes(const LatencyProbes &) = delete;
+    LatencyProbes &operator=(const LatencyProbes &) = delete;
+
+    struct HistogramShard
+    {
+        size_t probe_id;
+        LatencyHistogram hist;
+    };
+
+    struct CounterShard
+    {
+        size_t counter_id;
+        std::atomic<uint64_t> value{0};
+    };
+
+    HistogramShard *create_histogram_shard(const size_t &probe_id);
+    CounterShard *create_counter_shard(const size_t &counter_id);
+
+    void reporter_loop(std::string filename, size_t period_ms, std::function<void(const std::string &)> publisher);
+
+    std::mutex registry_mutex;
+    std::vector<std::string> probe_names, counter_names;
+    std::vector<std::unique_ptr<HistogramShard>> histogram_shards;
+    std::vector<std::unique_ptr<CounterShard>> counter_shards;
+
+    boost::thread reporter_thread;
+    std::atomic<bool> reporter_running{false};
+};
+
+/** Records the elapsed time between construction and destruction into a probe. */
+class ScopedLatency
+{
+public:
+    explicit ScopedLatency(const size_t &probe_id) : probe_id(probe_id), start_ns(LatencyProbes::now_ns()) {}
+    ~ScopedLatency() { LatencyProbes::getInstance().record(probe_id, LatencyProbes::now_ns() - start_ns); }
+
+private:
+    size_t probe_id;
+    int64_t start_ns;
+};
+
+// Probe ids are resolved once per call site
+#define LATENCY_PROBE_ID(name) ([]() { static const size_t id = LatencyProbes::getInstance().register_probe(name); return id; }())
+#define LATENCY_COUNTER_ID(name) ([]() { static const size_t id = LatencyProbes::getInstance().register_counter(name); return id; }())
+
+#define LATENCY_RECORD(name, value_ns) LatencyProbes::getInstance().record(LATENCY_PROBE_ID(name), value_ns)
+#define LATENCY_RECORD_SINCE(name, start_ns) LatencyProbes::getInstance().record(LATENCY_PROBE_ID(name), LatencyProbes::now_ns() - (start_ns))
+#define LATENCY_COUNT(name) LatencyProbes::getInstance().increment(LATENCY_COUNTER_ID(name))
+// distribution of a non-time quantity (queue depth, batch size) in the same histograms
+#define LATENCY_RECORD_VALUE(name, value) LatencyProbes::getInstance().record(LATENCY_PROBE_ID(name), int64_t(value))
+
+#endif // LATENCY_PROBES
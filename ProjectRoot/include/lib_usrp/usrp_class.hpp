@@ -5,16 +5,18 @@
 
 #include "log_macros.hpp"
 #include "utility.hpp"
-#include "config_parser.hpp"
+#include "config.hpp"
 #include "usrp_init.hpp"
 #include "MQTTClient.hpp"
+#include "latency_probes.hpp"
+#include "huge_page_alloc.hpp"
 
 extern const bool DEBUG;
 
 class USRP_class : public USRP_init
 {
 public:
-    USRP_class(const ConfigParser &parser);
+    USRP_class(std::shared_ptr<const Config> config);
 
     float estimate_background_noise_power(const size_t &num_pkts = 100);
     void publish_usrp_data();
@@ -34,6 +36,34 @@ public:
         const std::function<bool(const std::vector<sample_type> &, const size_t &, const uhd::time_spec_t &)> &callback = [](const std::vector<sample_type> &, const size_t &, const uhd::time_spec_t &)
         { return false; });
 
+    using rx_channels_callback = std::function<bool(const std::vector<std::vector<sample_type>> &, const size_t &, const uhd::time_spec_t &)>;
+
+    /** Reception of all streamed RX channels (`rx-channels`), one buffer per channel.
+     * `reception` is the same for the first channel only.
+     */
+    std::vector<std::vector<sample_type>> reception_channels(
+        bool &stop_signal_called,
+        const size_t &num_rx_samps = 0,
+        const float &duration = 0.0,
+        const uhd::time_spec_t &rx_time = uhd::time_spec_t(0.0),
+        bool is_save_to_file = false,
+        const rx_channels_callback &callback = [](const std::vector<std::vector<sample_type>> &, const size_t &, const uhd::time_spec_t &)
+        { return false; });
+
+    using rx_channels_sc16_callback = std::function<bool(const std::vector<std::vector<sc16_type>> &, const size_t &, const uhd::time_spec_t &)>;
+
+    /** `reception_channels` with sc16 samples -- without conversion if the RX host format is sc16
+     * (`cpu-format sc16`), converted from float otherwise.
+     */
+    std::vector<std::vector<sc16_type>> reception_channels_sc16(
+        bool &stop_signal_called,
+        const size_t &num_rx_samps = 0,
+        const float &duration = 0.0,
+        const uhd::time_spec_t &rx_time = uhd::time_spec_t(0.0),
+        bool is_save_to_file = false,
+        const rx_channels_sc16_callback &callback = [](const std::vector<std::vector<sc16_type>> &, const size_t &, const uhd::time_spec_t &)
+        { return false; });
+
     void receive_save_with_timer(bool &stop_signal_called, const float &duration);
     void receive_fixed_num_samps(bool &stop_signal_called, const size_t &num_rx_samples, std::vector<sample_type> &out_samples, uhd::time_spec_t &out_timer);
     void receive_continuously_with_callback(bool &stop_signal_called, const std::function<bool(const std::vector<sample_type> &, const size_t &, const uhd::time_spec_t &)> &callback = [](const std::vector<sample_type> &, const size_t &, const uhd::time_spec_t &)
@@ -47,10 +77,19 @@ public:
     float init_noise_ampl = 0.0;
 
 private:
-    ConfigParser parser;
+    std::shared_ptr<const Config> config;
 
     void pre_process_tx_symbols(std::vector<sample_type> &tx_samples, const float &scale = 1.0);
     void post_process_rx_symbols(std::vector<sample_type> &rx_ramples);
+
+    template <typename HOST_SAMPLE>
+    std::vector<std::vector<HOST_SAMPLE>> reception_host(bool &stop_signal_called, const size_t &num_rx_samps, const float &duration, const uhd::time_spec_t &rx_time, bool is_save_to_file,
+                                                         const std::function<bool(const std::vector<std::vector<HOST_SAMPLE>> &, const size_t &, const uhd::time_spec_t &)> &callback);
+
+    size_t recv_first_channel(sample_type *channel0, const size_t &num_samps, uhd::rx_metadata_t &md, const double &timeout);
+    size_t recv_first_channel_host(void *channel0, const size_t &num_samps, uhd::rx_metadata_t &md, const double &timeout);
+    std::vector<std::vector<sample_type>> rx_scratch; // channels other than the first in single-channel receivers
+    std::vector<sc16_type> rx_scratch_sc16;            // first channel before conversion, sc16 host format
 };
 
 #endif // USRP_CLASS
\ No newline at end of file
@@ -5,14 +5,15 @@
 
 #include "log_macros.hpp"
 #include "utility.hpp"
-#include "config_parser.hpp"
+#include "config.hpp"
+#include "sc16_samples.hpp"
 
 extern const bool DEBUG;
 
 class USRP_init
 {
 public:
-    USRP_init(const ConfigParser &parser);
+    USRP_init(std::shared_ptr<const Config> config);
     uhd::usrp::multi_usrp::sptr usrp;
 
     void initialize(bool perform_rxtx_test = true);
@@ -23,6 +24,9 @@ public:
     void update_cfo(const float &cfo);
 
     size_t max_rx_packet_size, max_tx_packet_size;
+    std::vector<size_t> rx_channels = {0}; // streamed RX channels, from `rx-channels`
+    size_t num_rx_channels() const { return rx_channels.size(); }
+    bool rx_sc16 = false; // RX streamer delivers sc16 host samples (`cpu-format sc16`), TX is always fc32
 
     uhd::rx_streamer::sptr rx_streamer;
     uhd::tx_streamer::sptr tx_streamer;
@@ -35,7 +39,7 @@ public:
     bool use_calib_gains = false;
 
 private:
-    ConfigParser parser;
+    std::shared_ptr<const Config> config;
 
     uhd::sensor_value_t get_sensor_fn_rx(const std::string &sensor_name, const size_t &channel);
     uhd::sensor_value_t get_sensor_fn_tx(const std::string &sensor_name, const size_t &channel);
@@ -53,7 +57,7 @@ private:
     void set_bandwidth();
     void apply_additional_settings();
     void set_tx_gain(const float &_tx_gain, const int &channel = 0);
-    void set_rx_gain(const float &_rx_gain, const int &channel = 0);
+    void set_rx_gain(const float &_rx_gain, const int &channel = -1); // -1: all streamed channels
 
     // additional features
     void print_usrp_device_info();
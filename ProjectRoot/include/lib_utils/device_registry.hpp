@@ -0,0 +1,69 @@
+#ifndef DEVICE_REGISTRY
+#define DEVICE_REGISTRY
+
+#include "pch.hpp"
+#include "log_macros.hpp"
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <condition_variable>
+
+/** In-memory view of `config/devices.json` with write-behind persistence.
+ *
+ * The file is parsed once and all reads are served from memory. Before a read
+ * the file mtime is compared with the last loaded one, so values written by
+ * other processes on the same host are picked up. Writes only update memory
+ * and queue the (device, key) pair; a background thread coalesces pending
+ * writes and persists them under an exclusive `flock` on `devices.json.lock`,
+ * re-reading the file first if it changed on disk, and replacing it through a
+ * temporary file and atomic rename.
+ */
+class DeviceRegistry
+{
+public:
+    static DeviceRegistry &getInstance();
+
+    bool read(const std::string &device_id, const std::string &config_type, json &config_val);
+    bool write(const std::string &device_id, const std::string &config_type, const json &config_val);
+    bool list_devices(const std::string &device_type, std::vector<std::string> &device_ids);
+
+    // persist all pending writes before returning
+    bool flush();
+
+private:
+    DeviceRegistry();
+    ~DeviceRegistry();
+    DeviceRegistry(const DeviceRegistry &) = delete;
+    DeviceRegistry &operator=(const DeviceRegistry &) = delete;
+
+    // reload from disk if the file changed since last load
+    bool refresh();
+    // parse file and re-apply pending writes -- caller holds the file lock and data_mutex
+    bool load_from_disk();
+    bool persist_pending();
+    void writer_loop();
+
+    int open_lock_file();
+    bool get_mtime(struct timespec &mtime);
+
+    std::string devices_json_file, lock_file;
+
+    std::mutex data_mutex;
+    json devices_json_data;
+    struct timespec loaded_mtime;
+    std::atomic<bool> is_loaded{false};
+
+    // pending writes keyed by (device_id, config_type), latest value wins
+    std::map<std::pair<std::string, std::string>, json> pending_writes;
+
+    // only one thread persists at a time (writer thread or explicit flush)
+    std::mutex persist_mutex;
+
+    std::condition_variable writer_cv;
+    boost::thread writer_thread;
+    std::atomic<bool> writer_running{true};
+
+    static constexpr size_t COALESCE_DELAY_MS = 200;
+};
+
+#endif // DEVICE_REGISTRY
@@ -0,0 +1,183 @@
+#ifndef EVENT_SYNC
+#define EVENT_SYNC
+
+#include "pch.hpp"
+#include <condition_variable>
+
+/** Absolute point in time on the steady clock used to bound blocking waits. */
+class Deadline
+{
+public:
+    explicit Deadline(const std::chrono::steady_clock::duration &timeout);
+    static Deadline never();
+
+    bool expired() const;
+    std::chrono::steady_clock::time_point time_point() const { return tp; }
+
+private:
+    explicit Deadline(const std::chrono::steady_clock::time_point &tp) : tp(tp) {}
+    std::chrono::steady_clock::time_point tp;
+};
+
+/** Set of event flags (bit mask) shared between MQTT callbacks and protocol threads.
+ *
+ * `test` is a single atomic load and can be polled from the RX path; `wait_any`
+ * blocks on a condition variable until one of the requested flags is set, the
+ * deadline passes or `interrupt` is called.
+ */
+class FlagSet
+{
+public:
+    void set(const uint32_t &flags);
+    void clear(const uint32_t &flags);
+    bool test(const uint32_t &flags) const;
+
+    // test-and-clear, returns true if any of `flags` was set
+    bool consume(const uint32_t &flags);
+
+    // returns the requested flags that are set at wake-up, 0 on timeout or interrupt
+    uint32_t wait_any(const uint32_t &flags, const Deadline &deadline);
+
+    // wake all waiters, e.g. when the routine is being stopped
+    void interrupt();
+
+private:
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::atomic<uint32_t> bits{0};
+    uint64_t interrupt_count = 0;
+};
+
+/** Latest value of a topic (or any producer) that consumers can wait on.
+ *
+ * Each `set` bumps a version; consumers remember the version they have seen
+ * and `wait_next` returns as soon as a newer value is available.
+ */
+template <typename T>
+class AwaitableValue
+{
+public:
+    void set(const T &new_value)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            value = new_value;
+            ver++;
+        }
+        cv.notify_all();
+    }
+
+    uint64_t version()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return ver;
+    }
+
+    /**
+     * @brief Waits for a value newer than `seen_version`.
+     * @param out          receives the value
+     * @param seen_version last version seen by the caller, updated on success
+     * @param deadline     give up once this point in time is reached
+     * @return true if a new value was received before the deadline
+     */
+    bool wait_next(T &out, uint64_t &seen_version, const Deadline &deadline)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (!cv.wait_until(lock, deadline.time_point(), [this, &seen_version]()
+                           { return ver > seen_version; }))
+            return false;
+        out = value;
+        seen_version = ver;
+        return true;
+    }
+
+private:
+    std::mutex mtx;
+    std::condition_variable cv;
+    T value{};
+    uint64_t ver = 0;
+};
+
+/** FIFO of bounded capacity between two pipeline stages.
+ *
+ * `push` blocks while the queue is full, which keeps the producing stage at
+ * most `capacity` items ahead of the consuming one. After `close` pushes fail
+ * and `pop` drains the remaining items before failing.
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(const size_t &capacity) : capacity(std::max<size_t>(capacity, 1)) {}
+
+    // returns false on timeout or if the queue is closed -- `item` is only moved from on success,
+    // so a timed out push can be retried with the same item
+    bool push(T &&item, const Deadline &deadline)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            if (!not_full.wait_until(lock, deadline.time_point(), [this]()
+                                     { return is_closed || items.size() < capacity; }))
+                return false;
+            if (is_closed)
+                return false;
+            items.emplace_back(std::move(item));
+        }
+        not_empty.notify_one();
+        return true;
+    }
+
+    bool push(const T &item, const Deadline &deadline)
+    {
+        T copy(item);
+        return push(std::move(copy), deadline);
+    }
+
+    // returns false on timeout or once the queue is closed and drained
+    bool pop(T &out, const Deadline &deadline)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            if (!not_empty.wait_until(lock, deadline.time_point(), [this]()
+                                      { return is_closed || !items.empty(); }))
+                return false;
+            if (items.empty())
+                return false;
+            out = std::move(items.front());
+            items.pop_front();
+        }
+        not_full.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            is_closed = true;
+        }
+        not_full.notify_all();
+        not_empty.notify_all();
+    }
+
+    bool closed()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return is_closed;
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return items.size();
+    }
+
+private:
+    std::mutex mtx;
+    std::condition_variable not_full, not_empty;
+    std::deque<T> items;
+    size_t capacity;
+    bool is_closed = false;
+};
+
+#endif // EVENT_SYNC
@@ -0,0 +1,100 @@
+#ifndef HUGE_PAGE_ALLOC
+#define HUGE_PAGE_ALLOC
+
+#include "pch.hpp"
+#include "log_macros.hpp"
+#include <sys/mman.h>
+
+/** Memory arena for sample rings, capture buffers and FFT workspaces.
+ *
+ * Memory is mapped from the reserved huge page pool (MAP_HUGETLB, vm.nr_hugepages); if the pool
+ * is exhausted it falls back to anonymous memory advised for transparent huge pages. Blocks of at
+ * least one huge page (2 MB) get their own mapping. Smaller blocks -- rings and FFT workspaces at
+ * the usual sizes -- are carved from shared 2 MB slabs in power-of-two size classes. A freed block
+ * serves any later block of its class, so callers of varying sizes (capture buffers, FFT batches)
+ * grow the slabs only up to the peak number of blocks in use per class; slabs are kept until the
+ * process ends. With huge pages off, small blocks come from aligned_alloc.
+ *
+ * Every block is cache-line aligned and pre-faulted, so no page fault stalls the streaming
+ * threads later. The buffers are allocated by the control thread, so first touch would place
+ * them on its NUMA node; `set_numa_node` binds the mappings (mbind, preferred) to the node of the
+ * streaming threads instead.
+ */
+class HugePageArena
+{
+public:
+    static constexpr size_t huge_page_size = size_t(2) << 20;
+    static constexpr size_t alignment = 64;
+
+    static HugePageArena &getInstance();
+
+    void *allocate(const size_t &bytes);
+    // `bytes` must be the size passed to allocate
+    void deallocate(void *ptr, const size_t &bytes);
+
+    // false -- large blocks use normal pages (still pre-faulted), small blocks aligned_alloc
+    void set_huge_pages(const bool &enabled) { huge_pages_enabled = enabled; }
+
+    // NUMA node of later mappings, -1 for the default policy (first touch)
+    void set_numa_node(const int &node) { numa_node = node; }
+
+    // bytes held from the huge page pool, other mappings (transparent huge pages if enabled, slabs
+    // included) and small blocks in use, in slabs or from aligned_alloc
+    json stats_json() const;
+
+private:
+    HugePageArena() = default;
+    HugePageArena(const HugePageArena &) = delete;
+    HugePageArena &operator=(const HugePageArena &) = delete;
+
+    static size_t mapped_size(const size_t &bytes) { return (bytes + huge_page_size - 1) / huge_page_size * huge_page_size; }
+    static size_t aligned_size(const size_t &bytes) { return (bytes + alignment - 1) / alignment * alignment; }
+    // size class of a small block in a slab -- power of two, at least `alignment`
+    static size_t small_size(const size_t &bytes)
+    {
+        size_t size = alignment;
+        while (size < bytes)
+            size *= 2;
+        return size;
+    }
+
+    void *map_pages(const size_t &length, bool &from_pool);
+    void *allocate_small(const size_t &rounded);
+    bool in_slab(const void *ptr) const;
+
+    std::atomic<bool> huge_pages_enabled{false}, hugetlb_warned{false};
+    std::atomic<int> numa_node{-1};
+    std::atomic<size_t> hugetlb_bytes{0}, mapped_bytes{0}, small_bytes{0};
+    std::mutex mapping_mutex;
+    std::unordered_map<void *, bool> is_hugetlb; // large blocks -- from the huge page pool or not
+
+    // small blocks -- bump allocation in the last slab, freed blocks by size class
+    std::mutex slab_mutex;
+    std::vector<char *> slabs;
+    size_t slab_used = huge_page_size;
+    std::unordered_map<size_t, std::vector<void *>> free_small_blocks;
+};
+
+// std allocator on top of HugePageArena, e.g. std::vector<sample_type, HugePageAllocator<sample_type>>
+template <typename T>
+struct HugePageAllocator
+{
+    using value_type = T;
+
+    HugePageAllocator() = default;
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U> &) {}
+
+    T *allocate(const size_t &n) { return static_cast<T *>(HugePageArena::getInstance().allocate(n * sizeof(T))); }
+    void deallocate(T *ptr, const size_t &n) { HugePageArena::getInstance().deallocate(ptr, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const HugePageAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const HugePageAllocator<U> &) const { return false; }
+};
+
+template <typename T>
+using huge_page_vector = std::vector<T, HugePageAllocator<T>>;
+
+#endif // HUGE_PAGE_ALLOC
@@ -0,0 +1,56 @@
+#ifndef SAMPLE_CLOCK
+#define SAMPLE_CLOCK
+
+#include "pch.hpp"
+#include "log_macros.hpp"
+
+// time of a received sample in ticks of a SampleClock
+typedef int64_t sample_tick;
+
+/** Integer timeline of received samples.
+ *
+ * USRP time stamps are counts of the master clock, and with an integer decimation every sample
+ * is exactly `ticks_per_sample` master clock ticks after the previous one. Sample times are
+ * therefore kept as 64-bit tick counts: 8 bytes per sample instead of 16 for a time_spec_t,
+ * one integer add per sample and no rounding drift over long streams. time_spec_t is used at
+ * the API edges only (packet metadata in, REF start and TX times out).
+ *
+ * If the sample rate does not divide the master clock rate, one tick is one sample and packet
+ * times are rounded to the nearest sample.
+ */
+class SampleClock
+{
+public:
+    SampleClock(const double &master_clock_rate = 1.0, const double &sample_rate = 1.0)
+    {
+        double ratio = master_clock_rate / sample_rate;
+        if (ratio >= 1.0 and std::abs(ratio - std::round(ratio)) < 1e-6)
+        {
+            tick_rate = master_clock_rate;
+            ticks_per_sample = std::llround(ratio);
+        }
+        else
+        {
+            tick_rate = sample_rate;
+            ticks_per_sample = 1;
+        }
+    }
+
+    sample_tick to_tick(const uhd::time_spec_t &time) const { return time.to_ticks(tick_rate); }
+
+    uhd::time_spec_t to_time(const sample_tick &tick) const { return uhd::time_spec_t::from_ticks(tick, tick_rate); }
+
+    // time of a point `frac_samples` samples after the sample at `tick`
+    uhd::time_spec_t to_time(const sample_tick &tick, const double &frac_samples) const
+    {
+        return to_time(tick) + uhd::time_spec_t(frac_samples * ticks_per_sample / tick_rate);
+    }
+
+    // ticks spanned by `num_samples` samples
+    sample_tick samples(const int64_t &num_samples) const { return num_samples * ticks_per_sample; }
+
+    double tick_rate;
+    sample_tick ticks_per_sample;
+};
+
+#endif // SAMPLE_CLOCK
@@ -0,0 +1,25 @@
+#ifndef SC16_SAMPLES
+#define SC16_SAMPLES
+
+#include "pch.hpp"
+#include "log_macros.hpp"
+
+/** Helpers for the sc16 host sample path (`cpu-format sc16`).
+ *
+ * UHD hands out the over-the-wire int16 samples as they are, the host keeps them in sc16
+ * (rings, capture files) and converts to float only where the precision is needed -- the
+ * correlator FFT and the CFO estimate. The scaling is UHD's: sc16 full scale 32767 is 1.0.
+ */
+constexpr float sc16_full_scale = 32767.0;
+
+inline bool is_sc16_format(const std::string &cpu_format) { return cpu_format == "sc16"; }
+
+void sc16_to_fc32(const sc16_type *in, const size_t &num_samples, sample_type *out);
+
+// rounds to the nearest integer, saturates outside [-1, 1]
+void fc32_to_sc16(const sample_type *in, const size_t &num_samples, sc16_type *out);
+
+// |x|^2 of every sample in float units, same as for the converted samples -- integer products
+void sc16_powers(const sc16_type *in, const size_t &num_samples, float *out);
+
+#endif // SC16_SAMPLES
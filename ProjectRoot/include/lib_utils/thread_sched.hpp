@@ -0,0 +1,74 @@
+#ifndef THREAD_SCHED
+#define THREAD_SCHED
+
+#include "pch.hpp"
+#include "log_macros.hpp"
+#include "config.hpp"
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+enum class ThreadRole
+{
+    RX,      // USRP reception, CSD producer
+    DSP,     // CSD consumer, OTAC detection
+    DETECT,  // OTAC detection workers of RX channels other than the first
+    TX,      // timed USRP transmission
+    CONTROL, // main thread, protocol control
+    IO       // MQTT, telemetry, file writers
+};
+
+/** CPU set and scheduling of one thread role, parsed from "<cpus>[@<priority>]".
+ * cpus is a list of CPUs and ranges ("2,3", "1-3"), empty for any CPU; priority is the
+ * SCHED_FIFO priority in [1, 99], absent for the default scheduler. "none" keeps both.
+ */
+struct ThreadRoleSched
+{
+    std::vector<int> cpus;
+    int fifo_priority = 0;
+
+    bool is_default() const { return cpus.empty() and fifo_priority == 0; }
+
+    static bool parse(const std::string &spec, ThreadRoleSched &role_sched, std::string &error);
+};
+
+/** Applies the per-role CPU sets and real-time priorities of the config (`sched-*`) to threads.
+ *
+ * `configure` is called once by the main program after the config is parsed. Threads are then
+ * assigned to a role either from outside (`apply`, e.g. right after creating a boost::thread) or
+ * by themselves (`apply_to_current_thread`, at the top of a thread loop). Before `configure` and for
+ * roles left at "none" nothing is changed. Each call logs the scheduling the thread actually got,
+ * which may differ from the request if the process lacks the privileges for real-time priorities.
+ */
+class ThreadScheduling
+{
+public:
+    static ThreadScheduling &getInstance();
+
+    void configure(std::shared_ptr<const Config> config);
+
+    bool apply(boost::thread &thread, const ThreadRole &role, const std::string &thread_name);
+    bool apply_to_current_thread(const ThreadRole &role, const std::string &thread_name);
+
+    // achieved scheduling of every thread handled so far
+    json report_json();
+
+    // NUMA node of the first CPU of the role, -1 if the role is not pinned or the node is unknown
+    int numa_node(const ThreadRole &role);
+
+    static std::string role_name(const ThreadRole &role);
+
+private:
+    ThreadScheduling() = default;
+    ThreadScheduling(const ThreadScheduling &) = delete;
+    ThreadScheduling &operator=(const ThreadScheduling &) = delete;
+
+    bool apply_native(const pthread_t &handle, const ThreadRole &role, const std::string &thread_name);
+
+    std::mutex mutex;
+    bool configured = false, memory_locked = false;
+    std::map<ThreadRole, ThreadRoleSched> roles;
+    std::vector<json> applied;
+};
+
+#endif // THREAD_SCHED
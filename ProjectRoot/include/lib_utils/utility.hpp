@@ -12,6 +12,8 @@ std::string convertTimeToStr(const std::time_t &datetime, const std::string &for
 std::string currentDateTimeFilename();
 void append_value_with_timestamp(const std::string &filename, std::ofstream &outfile, std::string value);
 void save_stream_to_file(const std::string &filename, std::ofstream &outfile, std::vector<sample_type> stream);
+void save_stream_to_file(const std::string &filename, std::ofstream &outfile, const sample_type *stream, const size_t &num_samples);
+void save_stream_to_file(const std::string &filename, std::ofstream &outfile, const sc16_type *stream, const size_t &num_samples);
 void save_timer_to_file(const std::string &filename, std::ofstream &outfile, std::vector<double> stream);
 std::vector<sample_type> read_from_file(const std::string &filename);
 float meanAbsoluteValue(const std::vector<sample_type> &vec, const float lower_bound = 0.0);
@@ -30,9 +32,9 @@ std::pair<float, float> find_closest_gain(const std::string &json_filename, cons
 float toDecibel(float value, bool isPower = true);
 float fromDecibel(float dB, bool isPower = true);
 
-bool devices_json_read_write(json &config_data, const bool &is_read = true);
 bool saveDeviceConfig(const std::string &device_id, const std::string &config_type, const float &config_val);
 bool saveDeviceConfig(const std::string &device_id, const std::string &config_type, const json &config_val);
+bool flushDeviceConfig();
 bool readDeviceConfig(const std::string &device_id, const std::string &config_type, float &config_val);
 bool readDeviceConfig(const std::string &device_id, const std::string &config_type, json &config_val);
 bool listActiveDevices(std::vector<std::string> &device_ids);
@@ -46,7 +48,7 @@ struct GainPower
 };
 
 // Processing OTAC signal appended with Full-scale signal to obtain signal power and number of samples in the signal before otac
-void windowing_func(const std::vector<float> &signal, const size_t &otac_len, const float &threshold, std::vector<float> out_signal, float &max_signal_power, size_t &max_index);
+void windowing_func(const std::vector<float> &signal, const size_t &otac_len, const float &threshold, std::vector<float> &out_signal, float &max_signal_power, size_t &max_index);
 bool otac_wfs_proc(const std::vector<sample_type> &signal, const size_t &otac_len, const float &threshold, float &fs_signal_power, float &otac_signal_power, size_t &num_samples_till_fs);
 
 // Processing OTAC signal without Full-scale signal to obtain signal power and number of samples in the signal before otac
@@ -0,0 +1,63 @@
+#ifndef WINDOW_POWER
+#define WINDOW_POWER
+
+#include "pch.hpp"
+#include "log_macros.hpp"
+
+/** Sliding-window mean power of a block of samples in a single traversal.
+ *
+ * |x|^2 is computed block-wise (vectorizable) and accumulated into double
+ * precision prefix sums, so window powers do not drift like a float running
+ * sum. While the prefix sums are built, every completed window is evaluated
+ * for the maximum and for threshold crossings. All buffers are provided by the
+ * caller and only grow, so repeated calls do not allocate.
+ */
+class WindowPowerEngine
+{
+public:
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+    struct Result
+    {
+        size_t num_windows = 0;
+        float max_power = 0.0;
+        size_t max_index = 0;
+        size_t first_crossing = npos; // first window above threshold
+        size_t num_crossings = 0;     // number of upward threshold crossings
+    };
+
+    // full-scale prefix followed by an OTAC segment of the same window length
+    struct FrameResult
+    {
+        bool fs_found = false, otac_found = false;
+        float fs_power = 0.0, otac_power = 0.0;
+        size_t fs_index = 0, otac_index = 0;
+    };
+
+    explicit WindowPowerEngine(const size_t &window_len);
+
+    /**
+     * @param signal       samples to process
+     * @param threshold    window power threshold for crossings
+     * @param prefix       receives prefix sums of |x|^2, size signal_len + 1
+     * @param window_power optional, receives the mean power of every window
+     */
+    Result process(const std::vector<sample_type> &signal, const float &threshold, std::vector<double> &prefix, std::vector<float> *window_power = nullptr) const;
+    Result process(const sample_type *signal, const size_t &signal_len, const float &threshold, std::vector<double> &prefix, std::vector<float> *window_power = nullptr) const;
+
+    /** Full-scale window = strongest window if above threshold; OTAC segment =
+     * strongest window starting at least one window length after it.
+     */
+    FrameResult process_frame(const std::vector<sample_type> &signal, const float &threshold, std::vector<double> &prefix, std::vector<float> &window_power) const;
+
+    // mean power of [start, start + len) from prefix sums of a previous call
+    static float segment_power(const std::vector<double> &prefix, const size_t &start, const size_t &len);
+
+    size_t window_len() const { return win_len; }
+
+private:
+    size_t win_len;
+    static constexpr size_t block_size = 64;
+};
+
+#endif // WINDOW_POWER
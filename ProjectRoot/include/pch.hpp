@@ -37,6 +37,7 @@ using json = nlohmann::json;
 // typedef std::complex<std::int16_t> sample_type;
 typedef float iq_type;
 typedef std::complex<iq_type> sample_type;
+typedef std::complex<std::int16_t> sc16_type; // host samples with `cpu-format sc16`, see sc16_samples.hpp
 
 #include <uhd/exception.hpp>
 #include <uhd/types/tune_request.hpp>
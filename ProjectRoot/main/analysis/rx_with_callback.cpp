@@ -2,7 +2,7 @@
 
 #include "log_macros.hpp"
 #include "utility.hpp"
-#include "config_parser.hpp"
+#include "config.hpp"
 #include "usrp_class.hpp"
 
 #define LOG_LEVEL LogLevel::DEBUG
@@ -35,7 +35,7 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
     // parser.print_values();
 
     /*------- USRP setup --------------*/
-    USRP_class usrp_classobj(parser);
+    USRP_class usrp_classobj(Config::from_parser(parser));
     usrp_classobj.external_ref = parser.getValue_str("external-clock-ref") == "true" ? true : false;
     usrp_classobj.initialize();
 
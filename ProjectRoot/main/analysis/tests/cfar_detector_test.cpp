@@ -0,0 +1,97 @@
+#include "pch.hpp"
+#include "log_macros.hpp"
+#include "cfar_detector.hpp"
+#include "utility.hpp"
+
+/** Statistical check of CfarDetector on complex Gaussian noise, for `ca` and `os`.
+ *
+ * 1. false-alarm rate of 200 blocks at unit noise power is close to the configured pfa
+ * 2. after a 20 dB noise step the false-alarm rate stays close to pfa and noise_power() follows
+ * 3. a lag 27 dB above the noise is detected at both noise levels
+ *
+ * Returns EXIT_FAILURE if any check fails.
+ */
+
+#define LOG_LEVEL LogLevel::INFO
+
+static const size_t num_lags = 5000, blocks_per_level = 200, train_cells = 16, guard_cells = 2;
+static const double pfa = 1e-3;
+
+struct LevelResult
+{
+    size_t false_alarms = 0, cells = 0;
+    bool peak_detected = false;
+    double mean_noise_power = 0.0;
+};
+
+static LevelResult run_level(CfarDetector &cfar, std::mt19937 &gen, const float &noise_ampl, const bool &skip_first_block)
+{
+    std::normal_distribution<float> normal(0.0, noise_ampl);
+    std::vector<std::complex<float>> corr(num_lags);
+    const size_t peak_block = blocks_per_level / 2, peak_lag = num_lags / 2;
+    LevelResult result;
+    size_t noise_blocks = 0;
+
+    for (size_t blk = 0; blk < blocks_per_level; ++blk)
+    {
+        for (auto &val : corr)
+            val = std::complex<float>(normal(gen), normal(gen));
+        if (blk == peak_block)
+            corr[peak_lag] *= 22.4f; // 27 dB
+
+        cfar.process(corr.data(), num_lags);
+
+        // the training cells of the first block after a step still hold the old level
+        if (skip_first_block and blk == 0)
+            continue;
+
+        for (size_t i = 0; i < num_lags; ++i)
+        {
+            if (blk == peak_block and i == peak_lag)
+                result.peak_detected = cfar.is_detection(i);
+            else if (cfar.is_detection(i))
+                result.false_alarms++;
+        }
+        result.cells += num_lags;
+        result.mean_noise_power += cfar.noise_power();
+        noise_blocks++;
+    }
+    result.mean_noise_power /= noise_blocks;
+    return result;
+}
+
+static bool check_level(const std::string &label, const LevelResult &result, const double &noise_power)
+{
+    double rate = double(result.false_alarms) / result.cells;
+    double power_ratio = result.mean_noise_power / noise_power;
+    bool success = rate > 0.5 * pfa and rate < 2.0 * pfa and power_ratio > 0.8 and power_ratio < 1.25 and result.peak_detected;
+    LOG_INFO_FMT("%1%: false-alarm rate %2% (pfa %3%), noise power %4% x true, peak %5% -- %6%",
+                 label, rate, pfa, power_ratio, result.peak_detected ? "detected" : "missed", success ? "OK" : "FAILED");
+    return success;
+}
+
+int main()
+{
+    /*----- LOG ------------------------*/
+    std::string projectDir = get_home_dir() + "/OTA-C/ProjectRoot";
+    std::string logFileName = projectDir + "/storage/logs/cfar_detector_test_" + currentDateTimeFilename() + ".log";
+    Logger::getInstance().initialize(logFileName);
+    Logger::getInstance().setLogLevel(LOG_LEVEL);
+
+    bool success = true;
+    for (const auto &mode_name : {"ca", "os"})
+    {
+        CfarDetector cfar(parse_cfar_mode(mode_name), train_cells, guard_cells, pfa);
+        std::mt19937 gen(1);
+
+        // E|x|^2 = 2 * noise_ampl^2 for independent real and imaginary parts
+        LevelResult low = run_level(cfar, gen, 1.0, false);
+        success &= check_level(std::string(mode_name) + " at 0 dB", low, 2.0);
+
+        LevelResult high = run_level(cfar, gen, 10.0, true);
+        success &= check_level(std::string(mode_name) + " after a 20 dB step", high, 200.0);
+    }
+
+    LOG_INFO_FMT("CFAR detector test %1%.", success ? "passed" : "FAILED");
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,140 @@
+#include "pch.hpp"
+#include "log_macros.hpp"
+#include "channel_emulator.hpp"
+#include "utility.hpp"
+
+/** Statistical and functional check of the channel emulator.
+ *
+ * 1. GaussianRng: sample mean and variance of fill(), power of add_noise()
+ * 2. ChannelLink: a complex tone through a single path at a fractional delay matches the exactly
+ *    delayed tone (NMSE below -40 dB)
+ * 3. ChannelLink / ChannelEmulator: after reset() the same input gives the same output sequence,
+ *    with CFO, phase noise and AWGN on
+ *
+ * Returns EXIT_FAILURE if any check fails.
+ */
+
+#define LOG_LEVEL LogLevel::INFO
+
+static const double sample_rate = 2e6;
+
+static bool check_gaussian()
+{
+    const size_t num_vals = 1 << 20;
+    GaussianRng rng(7);
+    std::vector<float> vals(num_vals);
+    rng.fill(vals.data(), num_vals, 2.0);
+
+    double sum = 0.0, sum_sq = 0.0;
+    for (const auto &val : vals)
+    {
+        sum += val;
+        sum_sq += double(val) * val;
+    }
+    double mean = sum / num_vals, var = sum_sq / num_vals - mean * mean;
+
+    // complex noise of power 0.5
+    std::vector<sample_type> samples(num_vals, sample_type(0.0));
+    rng.add_noise(samples.data(), num_vals, 0.5);
+    double power = 0.0;
+    for (const auto &sample : samples)
+        power += std::norm(sample);
+    power /= num_vals;
+
+    // standard errors: mean 2 / 1024, variance 4 * sqrt(2 / 2^20), power 0.5 / 1024
+    bool success = std::abs(mean) < 0.01 and std::abs(var / 4.0 - 1.0) < 0.01 and std::abs(power / 0.5 - 1.0) < 0.01;
+    LOG_INFO_FMT("GaussianRng: mean %1% (0), variance %2% (4), complex noise power %3% (0.5) -- %4%", mean, var, power, success ? "OK" : "FAILED");
+    return success;
+}
+
+static bool check_fractional_delay()
+{
+    const size_t num_samples = 4096, settle = 64;
+    const double freq = 0.05; // cycles per sample
+    std::vector<sample_type> tone(num_samples);
+    for (size_t i = 0; i < num_samples; ++i)
+        tone[i] = sample_type(std::polar(1.0, 2 * M_PI * freq * i));
+
+    bool success = true;
+    for (const double &delay : {3.0, 7.9, 10.25, 10.5, 20.0 + 1.0 / 3})
+    {
+        ChannelLink link;
+        link.set_paths({{delay, sample_type(1.0)}});
+        std::vector<sample_type> out(num_samples, sample_type(0.0));
+        link.process(tone.data(), num_samples, out.data());
+
+        double err = 0.0, ref = 0.0;
+        for (size_t i = settle; i < num_samples; ++i)
+        {
+            sample_type expected = sample_type(std::polar(1.0, 2 * M_PI * freq * (i - delay)));
+            err += std::norm(out[i] - expected);
+            ref += std::norm(expected);
+        }
+        double nmse_db = 10 * std::log10(err / ref);
+        bool delay_success = nmse_db < -40.0;
+        LOG_INFO_FMT("Fractional delay %1% samples: NMSE %2% dB -- %3%", delay, nmse_db, delay_success ? "OK" : "FAILED");
+        success &= delay_success;
+    }
+    return success;
+}
+
+// `input` through every link of the emulator, passed in blocks of `block_len`
+static std::vector<sample_type> run_blocks(ChannelEmulator &emulator, const std::vector<sample_type> &input, const size_t &block_len)
+{
+    std::vector<sample_type> output(input.size()), block_out;
+    for (size_t start = 0; start + block_len <= input.size(); start += block_len)
+    {
+        std::vector<std::vector<sample_type>> blocks(emulator.num_links(), std::vector<sample_type>(input.begin() + start, input.begin() + start + block_len));
+        emulator.process(blocks, block_out);
+        std::copy(block_out.begin(), block_out.end(), output.begin() + start);
+    }
+    return output;
+}
+
+static bool check_reset()
+{
+    const size_t num_samples = 8000, block_len = 1000;
+    std::vector<sample_type> input(num_samples);
+    GaussianRng input_rng(3);
+    input_rng.add_noise(input.data(), num_samples, 1.0);
+
+    ChannelEmulator emulator(sample_rate, 11);
+    for (size_t n = 0; n < 2; ++n)
+    {
+        ChannelLink &link = emulator.link(emulator.add_link());
+        link.set_paths({{2.5 + n, sample_type(0.8, 0.1)}, {6.75, sample_type(0.0, 0.3)}});
+        link.set_cfo(150.0 * (n + 1), sample_rate);
+        link.set_phase_noise(100.0, sample_rate, 21 + n);
+    }
+    emulator.set_noise_power(0.01);
+
+    std::vector<sample_type> first = run_blocks(emulator, input, block_len);
+    emulator.reset();
+    std::vector<sample_type> second = run_blocks(emulator, input, block_len);
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < num_samples; ++i)
+        if (std::abs(first[i] - second[i]) > 1e-6f)
+            mismatches++;
+
+    bool success = mismatches == 0;
+    LOG_INFO_FMT("Reset: %1% of %2% samples differ after reset -- %3%", mismatches, num_samples, success ? "OK" : "FAILED");
+    return success;
+}
+
+int main()
+{
+    /*----- LOG ------------------------*/
+    std::string projectDir = get_home_dir() + "/OTA-C/ProjectRoot";
+    std::string logFileName = projectDir + "/storage/logs/channel_emulator_test_" + currentDateTimeFilename() + ".log";
+    Logger::getInstance().initialize(logFileName);
+    Logger::getInstance().setLogLevel(LOG_LEVEL);
+
+    bool success = true;
+    success &= check_gaussian();
+    success &= check_fractional_delay();
+    success &= check_reset();
+
+    LOG_INFO_FMT("Channel emulator test %1%.", success ? "passed" : "FAILED");
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
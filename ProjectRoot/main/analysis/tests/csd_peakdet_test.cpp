@@ -1,7 +1,7 @@
 #include "pch.hpp"
 #include "log_macros.hpp"
 #include "cyclestartdetector.hpp"
-#include "config_parser.hpp"
+#include "config.hpp"
 #include "utility.hpp"
 
 #define LOG_LEVEL LogLevel::DEBUG
@@ -74,8 +74,9 @@ int main()
     double rx_sample_duration_float = 1 / parser.getValue_float("rate");
     uhd::time_spec_t rx_sample_duration = uhd::time_spec_t(rx_sample_duration_float);
     float noise_level = 0.000304542; // refer to info.text
-    PeakDetectionClass peakDet_obj(parser, noise_level);
-    CycleStartDetector csd_obj(parser, rx_sample_duration, peakDet_obj);
+    std::shared_ptr<const Config> config = Config::from_parser(parser);
+    PeakDetectionClass peakDet_obj(config, noise_level);
+    CycleStartDetector csd_obj(config, rx_sample_duration, peakDet_obj);
 
     /*------ Threads - Consumer / Producer --------*/
     std::atomic<bool> csd_success_signal(false);
@@ -0,0 +1,69 @@
+#include "pch.hpp"
+#include "log_macros.hpp"
+#include "otac_core.hpp"
+#include "utility.hpp"
+
+/** Frame start check of OtacDetector on the frames OTAC_class transmits.
+ *
+ * A frame (full-scale prefix, OTAC segment scaled by `sig_scale`) with a random channel phase is
+ * placed at several offsets of a window with AWGN at 0 dB SNR. At every offset and scale the
+ * frame must be detected at the right start (within half a sample) -- at `sig_scale = 1` the OTAC
+ * segment is as strong as the prefix, so any similarity between the two shows up as a wrong start.
+ *
+ * Returns EXIT_FAILURE if any check fails.
+ */
+
+#define LOG_LEVEL LogLevel::INFO
+
+static const size_t otac_wf_len = 1013, window_len = 10 * otac_wf_len, trials = 20;
+
+int main()
+{
+    /*----- LOG ------------------------*/
+    std::string projectDir = get_home_dir() + "/OTA-C/ProjectRoot";
+    std::string logFileName = projectDir + "/storage/logs/otac_detector_test_" + currentDateTimeFilename() + ".log";
+    Logger::getInstance().initialize(logFileName);
+    Logger::getInstance().setLogLevel(LOG_LEVEL);
+
+    OtacWaveforms waveforms = OtacWaveforms::generate(otac_wf_len);
+    OtacDetector detector(waveforms, window_len);
+
+    std::mt19937 gen(1);
+    std::normal_distribution<float> normal(0.0, std::sqrt(0.5)); // unit power complex noise
+    std::uniform_real_distribution<float> phase_dist(0.0, 2 * M_PI);
+    std::vector<std::complex<float>> window(window_len);
+
+    const size_t last_offset = window_len - waveforms.frame_len();
+    bool success = true;
+    for (const float &sig_scale : {1.0f, 0.5f})
+    {
+        for (const size_t &offset : {size_t(0), otac_wf_len, 2 * otac_wf_len, last_offset})
+        {
+            size_t wrong_starts = 0;
+            float min_confidence = std::numeric_limits<float>::max();
+            for (size_t trial = 0; trial < trials; ++trial)
+            {
+                for (auto &val : window)
+                    val = std::complex<float>(normal(gen), normal(gen));
+                std::complex<float> channel = std::polar(1.0f, phase_dist(gen));
+                for (size_t i = 0; i < waveforms.fs.size(); ++i)
+                    window[offset + i] += channel * waveforms.fs[i];
+                for (size_t i = 0; i < waveforms.otac.size(); ++i)
+                    window[offset + waveforms.fs.size() + i] += channel * sig_scale * waveforms.otac[i];
+
+                OtacDetector::Detection detection = detector.detect(window);
+                if (not detection.detected or std::abs(detection.frame_start - double(offset)) >= 0.5)
+                    wrong_starts++;
+                min_confidence = std::min(min_confidence, detection.confidence);
+            }
+
+            bool point_success = wrong_starts == 0;
+            LOG_INFO_FMT("sig_scale %1%, frame at %2%: %3%/%4% wrong or missed starts, min confidence %5% -- %6%",
+                         sig_scale, offset, wrong_starts, trials, min_confidence, point_success ? "OK" : "FAILED");
+            success &= point_success;
+        }
+    }
+
+    LOG_INFO_FMT("OTAC detector test %1%.", success ? "passed" : "FAILED");
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -2,7 +2,7 @@
 
 #include "log_macros.hpp"
 #include "utility.hpp"
-#include "config_parser.hpp"
+#include "config.hpp"
 #include "usrp_class.hpp"
 #include "waveforms.hpp"
 
@@ -53,7 +53,7 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
     parser.print_values();
 
     /*------- USRP setup --------------*/
-    USRP_class usrp_classobj(parser);
+    USRP_class usrp_classobj(Config::from_parser(parser));
 
     usrp_classobj.initialize();
     // float tx_samp_rate = usrp_classobj.tx_rate;
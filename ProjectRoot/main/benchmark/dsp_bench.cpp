@@ -0,0 +1,332 @@
+#include "pch.hpp"
+
+#include "log_macros.hpp"
+#include "utility.hpp"
+#include "config.hpp"
+#include "FFTWrapper.hpp"
+#include "cyclestartdetector.hpp"
+#include "peakdetector.hpp"
+#include "circular_buffer.hpp"
+#include "otac_core.hpp"
+#include "channel_emulator.hpp"
+
+#include <filesystem>
+#include <benchmark/benchmark.h>
+
+/** Microbenchmarks of the DSP and I/O primitives.
+ *
+ * Sizes follow config/config.conf (REF correlation and OTAC windows), so the numbers are those
+ * of the real receive path. Results are written as JSON to storage/benchmarks/ unless
+ * --benchmark_out is given; compare two runs with Google Benchmark's tools/compare.py.
+ *
+ * usage: dsp_bench [config=<path>] [--benchmark_filter=<regex>] [other Google Benchmark flags]
+ */
+
+static std::shared_ptr<const Config> config;
+static std::string bench_dir;
+
+// noise-like test signal, power `power`
+static std::vector<sample_type> test_signal(const size_t &num_samples, const float &power = 1.0, const uint64_t &seed = 1)
+{
+    std::vector<sample_type> signal(num_samples, sample_type(0.0, 0.0));
+    GaussianRng rng(seed);
+    rng.add_noise(signal.data(), num_samples, power);
+    return signal;
+}
+
+static size_t next_pow2(const size_t &n)
+{
+    size_t L = 1;
+    while (L < n)
+        L *= 2;
+    return L;
+}
+
+// discards console output (CSD progress line, logger echo) while a benchmark runs
+class MuteCout
+{
+public:
+    MuteCout() : saved(std::cout.rdbuf(null_stream.rdbuf())) {}
+    ~MuteCout() { std::cout.rdbuf(saved); }
+
+private:
+    std::ofstream null_stream{"/dev/null"};
+    std::streambuf *saved;
+};
+
+/*----------------- FFT -----------------*/
+
+static void BM_fft(benchmark::State &state, size_t fft_L)
+{
+    FFTWrapper fft;
+    fft.initialize(fft_L, int(config->num_fft_threads));
+    auto input = test_signal(fft_L);
+    std::vector<sample_type> output;
+    for (auto _ : state)
+    {
+        fft.fft(input, output);
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetItemsProcessed(state.iterations() * fft_L);
+}
+
+static void BM_ifft(benchmark::State &state, size_t fft_L)
+{
+    FFTWrapper fft;
+    fft.initialize(fft_L, int(config->num_fft_threads));
+    auto input = test_signal(fft_L);
+    std::vector<sample_type> output;
+    for (auto _ : state)
+    {
+        fft.ifft(input, output);
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetItemsProcessed(state.iterations() * fft_L);
+}
+
+/*----------------- Cycle start detection -----------------*/
+
+// one produce + consume round of the CSD on noise -- the steady state before a REF arrives
+static void BM_csd_consume(benchmark::State &state)
+{
+    MuteCout mute;
+    size_t corr_seq_len = config->ref_n_zfc * config->corr_seq_len_mul;
+    size_t capacity = next_pow2(2 * std::max<size_t>(corr_seq_len, config->max_rx_packet_size + 1));
+    float noise_ampl = 0.01;
+
+    PeakDetectionClass peak_det_obj(config, noise_ampl);
+    CycleStartDetector csd(config, capacity, uhd::time_spec_t(1.0 / config->rate), config->master_clock_rate, peak_det_obj);
+
+    auto samples = test_signal(corr_seq_len, noise_ampl * noise_ampl);
+    std::atomic<bool> csd_success{false};
+    bool stop = false;
+    uhd::time_spec_t packet_time(0.0);
+    for (auto _ : state)
+    {
+        csd.produce(samples, samples.size(), packet_time, stop);
+        csd.consume(csd_success, stop);
+        packet_time += uhd::time_spec_t(corr_seq_len / config->rate);
+    }
+    state.SetItemsProcessed(state.iterations() * corr_seq_len);
+}
+
+static void BM_peak_process_corr(benchmark::State &state)
+{
+    size_t block_len = config->ref_n_zfc * config->corr_seq_len_mul;
+    float noise_ampl = 0.01;
+    PeakDetectionClass peak_det_obj(config, noise_ampl);
+
+    // correlation magnitudes of noise, below the detection threshold
+    auto noise = test_signal(block_len, noise_ampl * noise_ampl);
+    std::vector<std::complex<float>> corr(block_len);
+    for (size_t i = 0; i < block_len; ++i)
+        corr[i] = std::abs(noise[i]) * config->ref_n_zfc;
+
+    sample_tick samp_time = 0;
+    for (auto _ : state)
+    {
+        for (const auto &val : corr)
+        {
+            peak_det_obj.process_corr(val, samp_time);
+            samp_time += peak_det_obj.sample_clock.ticks_per_sample;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * block_len);
+}
+
+/*----------------- Utility DSP -----------------*/
+
+static void BM_correct_cfo(benchmark::State &state, float scale)
+{
+    size_t num_samples = config->ref_n_zfc * config->corr_seq_len_mul;
+    auto signal = test_signal(num_samples);
+    size_t counter = 0;
+    for (auto _ : state)
+    {
+        correct_cfo(signal, counter, scale, 1e-3);
+        benchmark::DoNotOptimize(signal.data());
+    }
+    state.SetItemsProcessed(state.iterations() * num_samples);
+}
+
+static void BM_calc_signal_power(benchmark::State &state)
+{
+    size_t num_samples = state.range(0);
+    auto signal = test_signal(num_samples);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(calc_signal_power(signal, 0, num_samples));
+    state.SetItemsProcessed(state.iterations() * num_samples);
+}
+
+static void BM_otac_wofs_proc(benchmark::State &state)
+{
+    size_t otac_len = config->test_signal_len;
+    auto signal = test_signal(10 * otac_len, 1e-4);
+    auto burst = test_signal(otac_len, 1.0, 2);
+    std::copy(burst.begin(), burst.end(), signal.begin() + 3 * otac_len);
+
+    float signal_power = 0.0;
+    size_t num_samples_till_otac = 0;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(otac_wofs_proc(signal, otac_len, 1e-2, signal_power, num_samples_till_otac));
+    state.SetItemsProcessed(state.iterations() * signal.size());
+}
+
+static void BM_otac_detect(benchmark::State &state)
+{
+    size_t otac_len = config->test_signal_len;
+    OtacWaveforms waveforms = OtacWaveforms::generate(otac_len);
+    OtacDetector detector(waveforms, 10 * otac_len);
+
+    auto signal = test_signal(10 * otac_len, 1e-4);
+    for (size_t i = 0; i < waveforms.fs.size(); ++i)
+        signal[2 * otac_len + i] += waveforms.fs[i];
+    for (auto _ : state)
+        benchmark::DoNotOptimize(detector.detect(signal));
+    state.SetItemsProcessed(state.iterations() * signal.size());
+}
+
+/*----------------- File I/O -----------------*/
+
+static void BM_save_stream_to_file(benchmark::State &state)
+{
+    size_t num_samples = state.range(0);
+    std::string filename = bench_dir + "/bench_save_stream.dat";
+    auto signal = test_signal(num_samples);
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        std::remove(filename.c_str());
+        state.ResumeTiming();
+
+        std::ofstream outfile;
+        save_stream_to_file(filename, outfile, signal);
+        outfile.close();
+    }
+    std::remove(filename.c_str());
+    state.SetBytesProcessed(state.iterations() * num_samples * sizeof(sample_type));
+}
+
+static void BM_read_from_file(benchmark::State &state)
+{
+    size_t num_samples = state.range(0);
+    std::string filename = bench_dir + "/bench_read_stream.dat";
+    std::remove(filename.c_str()); // save_stream_to_file appends
+    {
+        std::ofstream outfile;
+        save_stream_to_file(filename, outfile, test_signal(num_samples));
+    }
+    for (auto _ : state)
+        benchmark::DoNotOptimize(read_from_file(filename));
+    std::remove(filename.c_str());
+    state.SetBytesProcessed(state.iterations() * num_samples * sizeof(sample_type));
+}
+
+/*----------------- Buffers and logging -----------------*/
+
+static void BM_circular_buffer(benchmark::State &state)
+{
+    size_t capacity = 1 << 16, burst = state.range(0);
+    CircularBuffer<sample_type> buffer(capacity);
+    sample_type sample(1.0, -1.0);
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < burst; ++i)
+            buffer.push(sample);
+        for (size_t i = 0; i < burst; ++i)
+            buffer.pop(sample);
+    }
+    benchmark::DoNotOptimize(sample);
+    state.SetItemsProcessed(state.iterations() * burst);
+}
+
+static void BM_logger_log(benchmark::State &state, LogLevel level)
+{
+    MuteCout mute;
+    Logger::getInstance().setLogLevel(LogLevel::INFO);
+    std::string message = "Estimated ref signal power is 0.0123.";
+    for (auto _ : state)
+        Logger::getInstance().log(level, message);
+    state.SetItemsProcessed(state.iterations());
+}
+
+int main(int argc, char *argv[])
+{
+    /*------ Initialize ---------------*/
+    std::string homeDirStr = get_home_dir();
+    std::string projectDir = homeDirStr + "/OTA-C/ProjectRoot";
+    std::string curr_time_str = currentDateTimeFilename();
+    std::string config_file = projectDir + "/config/config.conf";
+
+    // config=<path> is ours, everything else goes to Google Benchmark
+    std::vector<char *> bench_args = {argv[0]};
+    bool has_out = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("config=", 0) == 0)
+            config_file = arg.substr(7);
+        else
+        {
+            has_out |= arg.rfind("--benchmark_out=", 0) == 0;
+            bench_args.push_back(argv[i]);
+        }
+    }
+
+    bench_dir = projectDir + "/storage/benchmarks";
+    std::filesystem::create_directories(bench_dir);
+    std::string out_arg = "--benchmark_out=" + bench_dir + "/dsp_bench_" + curr_time_str + ".json";
+    std::string out_format_arg = "--benchmark_out_format=json";
+    if (not has_out)
+    {
+        bench_args.push_back(&out_arg[0]);
+        bench_args.push_back(&out_format_arg[0]);
+    }
+
+    /*----- LOG ------------------------*/
+    std::string logFileName = projectDir + "/storage/logs/dsp_bench_" + curr_time_str + ".log";
+    Logger::getInstance().initialize(logFileName);
+    Logger::getInstance().setLogLevel(LogLevel::INFO);
+
+    /*------ Parse Config -------------*/
+    ConfigParser parser(config_file);
+    parser.set_value("device-id", "benchmark", "str");
+    config = Config::from_parser(parser);
+
+    /*------ Register benchmarks -------*/
+    size_t N_zfc = config->ref_n_zfc;
+    size_t corr_seq_len = N_zfc * config->corr_seq_len_mul;
+    size_t otac_len = config->test_signal_len;
+    std::map<std::string, size_t> fft_sizes = {
+        {"csd_corr", next_pow2(corr_seq_len + N_zfc - 1)},
+        {"csd_saved_ref", next_pow2(N_zfc * (config->ref_r_zfc + 2) + N_zfc - 1)},
+        {"otac_window", next_pow2(10 * otac_len + otac_len - 1)}};
+    for (const auto &size : fft_sizes)
+    {
+        benchmark::RegisterBenchmark(("BM_fft/" + size.first + "/" + std::to_string(size.second)).c_str(), BM_fft, size.second);
+        benchmark::RegisterBenchmark(("BM_ifft/" + size.first + "/" + std::to_string(size.second)).c_str(), BM_ifft, size.second);
+    }
+
+    benchmark::RegisterBenchmark("BM_csd_consume", BM_csd_consume);
+    benchmark::RegisterBenchmark("BM_peak_process_corr", BM_peak_process_corr);
+    benchmark::RegisterBenchmark("BM_correct_cfo/rotate", BM_correct_cfo, 1.0f);
+    benchmark::RegisterBenchmark("BM_correct_cfo/scale_rotate", BM_correct_cfo, 0.5f);
+    benchmark::RegisterBenchmark("BM_calc_signal_power", BM_calc_signal_power)->Arg(otac_len)->Arg(corr_seq_len);
+    benchmark::RegisterBenchmark("BM_otac_wofs_proc", BM_otac_wofs_proc);
+    benchmark::RegisterBenchmark("BM_otac_detect", BM_otac_detect);
+    benchmark::RegisterBenchmark("BM_save_stream_to_file", BM_save_stream_to_file)->Arg(1 << 16)->Arg(1 << 20);
+    benchmark::RegisterBenchmark("BM_read_from_file", BM_read_from_file)->Arg(1 << 16)->Arg(1 << 20);
+    benchmark::RegisterBenchmark("BM_circular_buffer", BM_circular_buffer)->Arg(1)->Arg(1024);
+    benchmark::RegisterBenchmark("BM_logger_log/filtered", BM_logger_log, LogLevel::DEBUG);
+    benchmark::RegisterBenchmark("BM_logger_log/written", BM_logger_log, LogLevel::INFO);
+
+    int bench_argc = int(bench_args.size());
+    benchmark::Initialize(&bench_argc, bench_args.data());
+    if (benchmark::ReportUnrecognizedArguments(bench_argc, bench_args.data()))
+        return EXIT_FAILURE;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    LOG_INFO_FMT("Benchmark results saved to %1%", (has_out ? std::string("--benchmark_out") : out_arg.substr(16)));
+    return EXIT_SUCCESS;
+}
@@ -2,11 +2,13 @@
 
 #include "log_macros.hpp"
 #include "utility.hpp"
-#include "config_parser.hpp"
+#include "config.hpp"
 #include "usrp_class.hpp"
 #include "waveforms.hpp"
 #include "cyclestartdetector.hpp"
 #include "MQTTClient.hpp"
+#include "thread_sched.hpp"
+#include "huge_page_alloc.hpp"
 #include <filesystem>
 
 #define LOG_LEVEL LogLevel::DEBUG
@@ -218,6 +220,12 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
 
     LOG_INFO_FMT("Starting Calibration routine at %1% ...", is_central_server ? "CENT" : "LEAF");
 
+    /*------- Thread scheduling -------*/
+    ThreadScheduling::getInstance().configure(Config::from_parser(parser));
+    ThreadScheduling::getInstance().apply_to_current_thread(ThreadRole::CONTROL, "main");
+    HugePageArena::getInstance().set_huge_pages(Config::from_parser(parser)->huge_pages);
+    HugePageArena::getInstance().set_numa_node(ThreadScheduling::getInstance().numa_node(ThreadRole::DSP));
+
     /*------- MQTT Client setup -------*/
     std::string client_id = device_type + "_" + device_id;
     MQTTClient &mqttClient = MQTTClient::getInstance(client_id);
@@ -228,7 +236,7 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
     }
 
     /*------- USRP setup --------------*/
-    USRP_class usrp_obj(parser);
+    USRP_class usrp_obj(Config::from_parser(parser));
 
     usrp_obj.external_ref = parser.getValue_str("external-clock-ref") == "true" ? true : false;
     usrp_obj.initialize(true);
@@ -244,8 +252,9 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
     uhd::time_spec_t rx_sample_duration = uhd::time_spec_t(rx_sample_duration_float);
     float init_noise_ampl = usrp_obj.init_noise_ampl;
     size_t capacity = std::pow(2.0, parser.getValue_int("capacity-pow"));
-    PeakDetectionClass peakDet_obj(parser, init_noise_ampl);
-    CycleStartDetector csd_obj(parser, capacity, rx_sample_duration, peakDet_obj);
+    std::shared_ptr<const Config> config = Config::from_parser(parser);
+    PeakDetectionClass peakDet_obj(config, init_noise_ampl);
+    CycleStartDetector csd_obj(config, capacity, rx_sample_duration, usrp_obj.master_clock_rate, peakDet_obj);
 
     csd_obj.tx_wait_microsec = 0.3 * 1e6;
 
@@ -265,15 +274,20 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
                                                          { producer_thread(usrp_obj, peakDet_obj, csd_obj, parser, csd_success_signal, homeDirStr, is_central_server, max_calib_rounds); });
 
     uhd::set_thread_name(my_producer_thread, "producer_thread");
+    ThreadScheduling::getInstance().apply(*my_producer_thread, ThreadRole::RX, "producer_thread");
 
     // consumer thread
     auto my_consumer_thread = thread_group.create_thread([=, &csd_obj, &parser, &csd_success_signal]()
                                                          { consumer_thread(csd_obj, parser, csd_success_signal); });
 
     uhd::set_thread_name(my_consumer_thread, "consumer_thread");
+    ThreadScheduling::getInstance().apply(*my_consumer_thread, ThreadRole::DSP, "consumer_thread");
 
     std::this_thread::sleep_for(std::chrono::milliseconds(50));
     thread_group.join_all();
 
+    // persist pending devices.json updates (CFO, gains) while logging still works
+    if (!flushDeviceConfig())
+        LOG_WARN("Pending devices.json updates not written before exit.");
     return EXIT_SUCCESS;
 };
\ No newline at end of file
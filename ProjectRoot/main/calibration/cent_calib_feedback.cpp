@@ -2,7 +2,7 @@
 
 #include "log_macros.hpp"
 #include "utility.hpp"
-#include "config_parser.hpp"
+#include "config.hpp"
 #include "usrp_class.hpp"
 #include "waveforms.hpp"
 #include "cyclestartdetector.hpp"
@@ -161,7 +161,7 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
     mqttClient.publish("config/run_config_info", parser.print_json());
 
     /*------- USRP setup --------------*/
-    USRP_class usrp_obj(parser);
+    USRP_class usrp_obj(Config::from_parser(parser));
 
     usrp_obj.external_ref = parser.getValue_str("external-clock-ref") == "true" ? true : false;
     usrp_obj.initialize(true);
@@ -175,8 +175,9 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
     uhd::time_spec_t rx_sample_duration = uhd::time_spec_t(rx_sample_duration_float);
     float init_noise_ampl = usrp_obj.init_noise_ampl;
     size_t capacity = std::pow(2.0, parser.getValue_int("capacity-pow"));
-    PeakDetectionClass peakDet_obj(parser, init_noise_ampl);
-    CycleStartDetector csd_obj(parser, capacity, rx_sample_duration, peakDet_obj);
+    std::shared_ptr<const Config> config = Config::from_parser(parser);
+    PeakDetectionClass peakDet_obj(config, init_noise_ampl);
+    CycleStartDetector csd_obj(config, capacity, rx_sample_duration, usrp_obj.master_clock_rate, peakDet_obj);
     csd_obj.is_correct_cfo = false;
 
     /*------ Threads - Consumer / Producer --------*/
@@ -202,5 +203,8 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
     std::this_thread::sleep_for(std::chrono::milliseconds(50));
     thread_group.join_all();
 
+    // persist pending devices.json updates (CFO, gains) while logging still works
+    if (!flushDeviceConfig())
+        LOG_WARN("Pending devices.json updates not written before exit.");
     return EXIT_SUCCESS;
 };
\ No newline at end of file
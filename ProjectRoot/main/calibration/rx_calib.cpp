@@ -2,7 +2,7 @@
 
 #include "log_macros.hpp"
 #include "utility.hpp"
-#include "config_parser.hpp"
+#include "config.hpp"
 #include "usrp_class.hpp"
 #include "waveforms.hpp"
 
@@ -42,7 +42,7 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
     parser.set_value("storage-folder", projectDir + "/storage", "str", "Location of storage director");
 
     /*------- USRP setup --------------*/
-    USRP_class usrp_obj(parser);
+    USRP_class usrp_obj(Config::from_parser(parser));
 
     usrp_obj.external_ref = parser.getValue_str("external-clock-ref") == "true" ? true : false;
     usrp_obj.initialize();
@@ -74,5 +74,8 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
     std::this_thread::sleep_for(std::chrono::milliseconds(5000));
     stop_signal_called = true;
 
+    // persist pending devices.json updates (CFO, gains) while logging still works
+    if (!flushDeviceConfig())
+        LOG_WARN("Pending devices.json updates not written before exit.");
     return EXIT_SUCCESS;
 };
\ No newline at end of file
@@ -2,7 +2,7 @@
 
 #include "log_macros.hpp"
 #include "utility.hpp"
-#include "config_parser.hpp"
+#include "config.hpp"
 #include "usrp_class.hpp"
 #include "waveforms.hpp"
 #include "cyclestartdetector.hpp"
@@ -249,7 +249,7 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
     mqttClient.unsubscribe(calib_topic);
 
     /*------- USRP setup --------------*/
-    USRP_class usrp_obj(parser);
+    USRP_class usrp_obj(Config::from_parser(parser));
 
     // external reference
     usrp_obj.external_ref = parser.getValue_str("external-clock-ref") == "true" ? true : false;
@@ -264,8 +264,9 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
     uhd::time_spec_t rx_sample_duration = uhd::time_spec_t(rx_sample_duration_float);
     float init_noise_ampl = usrp_obj.init_noise_ampl;
     size_t capacity = std::pow(2.0, parser.getValue_int("capacity-pow"));
-    PeakDetectionClass peakDet_obj(parser, init_noise_ampl);
-    CycleStartDetector csd_obj(parser, capacity, rx_sample_duration, peakDet_obj);
+    std::shared_ptr<const Config> config = Config::from_parser(parser);
+    PeakDetectionClass peakDet_obj(config, init_noise_ampl);
+    CycleStartDetector csd_obj(config, capacity, rx_sample_duration, usrp_obj.master_clock_rate, peakDet_obj);
     // float last_cfo = obtain_last_cfo(device_id);
     csd_obj.cfo = last_cfo;
     csd_obj.calibration_ratio = calibration_ratio;
@@ -293,5 +294,8 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
     std::this_thread::sleep_for(std::chrono::milliseconds(50));
     thread_group.join_all();
 
+    // persist pending devices.json updates (CFO, gains) while logging still works
+    if (!flushDeviceConfig())
+        LOG_WARN("Pending devices.json updates not written before exit.");
     return EXIT_SUCCESS;
 };
\ No newline at end of file
@@ -1,12 +1,16 @@
 #include "pch.hpp"
 
 #include "usrp_class.hpp"
-#include "config_parser.hpp"
+#include "config.hpp"
 #include "calibration.hpp"
+#include "calibration_scheduler.hpp"
 #include "otac_processor.hpp"
 #include "log_macros.hpp"
 #include "utility.hpp"
 #include "MQTTClient.hpp"
+#include "latency_probes.hpp"
+#include "thread_sched.hpp"
+#include "huge_page_alloc.hpp"
 
 #define LOG_LEVEL LogLevel::DEBUG
 static bool stop_signal_called = false;
@@ -25,8 +29,9 @@ void gen_mqtt_control_msg(std::string &device_id, std::string &counterpard_id, c
     LOG_INFO("(2) Run scaling tests.");
     LOG_INFO("(3) Analyse time synchronization performance.");
     LOG_INFO("(4) Analyse OTAC-based consensus performance.");
-    LOG_INFO("(5) Exit program.");
-    LOG_INFO("Enter choice (1-5):");
+    LOG_INFO("(5) Stop the running calibration.");
+    LOG_INFO("(6) Exit program.");
+    LOG_INFO("Enter choice (1-6):");
 
     // Take input from the user
     std::cin >> choice;
@@ -41,7 +46,7 @@ void gen_mqtt_control_msg(std::string &device_id, std::string &counterpard_id, c
         if (is_cent)
         {
             cent_id = device_id;
-            LOG_INFO("Enter serial of leaf device:");
+            LOG_INFO("Enter serial of leaf device (or 'all' to calibrate all active devices at once):");
             std::cin >> leaf_id;
             counterpard_id = leaf_id;
         }
@@ -51,6 +56,36 @@ void gen_mqtt_control_msg(std::string &device_id, std::string &counterpard_id, c
             leaf_id = device_id;
         }
         std::string topic_calib = mqttClient.topics->getValue_str("calibration");
+
+        if (is_cent and leaf_id == "all")
+        {
+            std::vector<std::string> leaf_id_list;
+            if (not listActiveDevices(leaf_id_list) or leaf_id_list.empty())
+            {
+                LOG_WARN("Unable to get device list.");
+                break;
+            }
+
+            // every leaf answers the common REF in its own response slot
+            json jstring;
+            jstring["message"] = "start";
+            jstring["cent-id"] = cent_id;
+            jstring["time"] = currentDateTime();
+            for (size_t slot = 0; slot < leaf_id_list.size(); ++slot)
+            {
+                jstring["leaf-id"] = leaf_id_list[slot];
+                jstring["slot"] = slot;
+                mqttClient.publish(topic_calib + leaf_id_list[slot], jstring.dump(4), false);
+            }
+
+            jstring.erase("slot");
+            jstring["leaf-id"] = "all";
+            jstring["leaf-ids"] = leaf_id_list;
+            LOG_INFO_FMT("Sending data to topic %1% : %2%", topic_calib + cent_id, jstring.dump(4));
+            mqttClient.publish(topic_calib + cent_id, jstring.dump(4), false);
+            break;
+        }
+
         json jstring;
         jstring["message"] = "start";
         jstring["leaf-id"] = leaf_id;
@@ -137,18 +172,47 @@ void gen_mqtt_control_msg(std::string &device_id, std::string &counterpard_id, c
         break;
     }
     case 5:
+    {
+        MQTTClient &mqttClient = MQTTClient::getInstance(device_id);
+        std::string topic_calib = mqttClient.topics->getValue_str("calibration");
+
+        // leafs first, then the routine of this device
+        json jstring;
+        jstring["message"] = "stop";
+        jstring["time"] = currentDateTime();
+        std::vector<std::string> leaf_id_list;
+        if (is_cent and not listActiveDevices(leaf_id_list))
+            LOG_WARN("Unable to get device list, stopping the cent only.");
+        for (const auto &leaf_id : leaf_id_list)
+            mqttClient.publish(topic_calib + leaf_id, jstring.dump(4), false);
+
+        LOG_INFO_FMT("Sending data to topic %1% : %2%", topic_calib + device_id, jstring.dump(4));
+        mqttClient.publish(topic_calib + device_id, jstring.dump(4), false);
+        break;
+    }
+    case 6:
     {
         stop_signal_called = true;
         break;
     }
     default:
     {
-        LOG_INFO("Invalid choice. Please enter a number between 1 and 5.");
+        LOG_INFO("Invalid choice. Please enter a number between 1 and 6.");
         break;
     }
     }
 }
 
+// CBOR telemetry "t" in ticks of the USRP time, at the master clock rate the device actually runs
+// at -- comparable across nodes sharing a time reference, unlike host clocks
+void use_usrp_ticks(const std::shared_ptr<USRP_class> &usrp_obj)
+{
+    const double tick_rate = usrp_obj->master_clock_rate;
+    MQTTClient::getInstance().setTickSource([usrp_obj, tick_rate]()
+                                            { return int64_t(usrp_obj->get_time_now().to_ticks(tick_rate)); },
+                                            tick_rate);
+}
+
 int UHD_SAFE_MAIN(int argc, char *argv[])
 {
     /*------ Initialize ---------------*/
@@ -171,39 +235,54 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
     std::shared_ptr<ConfigParser> parser = std::make_shared<ConfigParser>(projectDir + "/config/config.conf");
     parser->set_value("device-id", device_id, "str", "USRP device serial");
     parser->set_value("storage-folder", projectDir + "/storage", "str", "Location of storage directory");
+    std::shared_ptr<const Config> config = Config::from_parser(*parser);
+
+    /*------- Thread scheduling -------*/
+    // before MQTT and telemetry start their threads, which pick up the `io` role themselves
+    ThreadScheduling::getInstance().configure(config);
+    ThreadScheduling::getInstance().apply_to_current_thread(ThreadRole::CONTROL, "main");
+    HugePageArena::getInstance().set_huge_pages(config->huge_pages);
+    HugePageArena::getInstance().set_numa_node(ThreadScheduling::getInstance().numa_node(ThreadRole::DSP));
 
     /*------- MQTT Client setup -------*/
+    MQTTClient::setBrokerAddress(config->mqtt_broker);
     MQTTClient &mqttClient = MQTTClient::getInstance(device_id);
+    MQTTClient::PayloadFormat payload_format;
+    if (MQTTClient::parsePayloadFormat(config->mqtt_payload_format, payload_format))
+        mqttClient.setPayloadFormat(payload_format);
+
+    /*------- Latency telemetry -------*/
+    std::string latency_topic = mqttClient.topics->getValue_str("tele-latency") + device_id;
+    std::string latency_file = projectDir + "/storage/logs/latency_" + device_type + "_" + device_id + "_" + curr_time_str + ".jsonl";
+    LatencyProbes::getInstance().start_reporter(latency_file, config->latency_report_ms, [&mqttClient, latency_topic](const std::string &snapshot)
+                                                { mqttClient.publish(latency_topic, snapshot, false); });
 
     /*------- USRP setup --------------*/
     // USRP_class usrp_obj(parser);
-    std::shared_ptr<USRP_class> usrp_obj = std::make_shared<USRP_class>(*parser);
+    std::shared_ptr<USRP_class> usrp_obj = std::make_shared<USRP_class>(config);
 
     // external reference
-    usrp_obj->external_ref = parser->getValue_str("external-clock-ref") == "true" ? true : false;
+    usrp_obj->external_ref = config->external_clock_ref;
 
-    parser->print_values();
+    config->print_values();
 
     /*-------- Subscribe to Control topics ---------*/
     std::atomic_bool program_ends(true);
 
-    // Calibration routine
-    auto control_calibration_callback = [usrp_obj, parser, &program_ends, &device_type](const std::string &payload)
+    // calibration routine started by the last "start" message, stopped by "stop". Callbacks of one
+    // topic run in order, so "start" hands the routine to `calib_worker` and returns -- a "stop"
+    // behind it on the same topic is handled while the routine runs.
+    std::shared_ptr<CalibrationScheduler> active_calib_scheduler;
+    std::shared_ptr<Calibration> active_calib;
+    std::mutex calib_mutex;
+    std::thread calib_worker;
+    std::atomic_bool calib_running(false);
+
+    // runs one calibration routine to its end, on `calib_worker`
+    auto run_calibration = [usrp_obj, config, &program_ends, &device_type, &active_calib_scheduler, &active_calib, &calib_mutex, &calib_running](const json jdata)
     {
-        json jdata;
-        try
-        {
-            jdata = json::parse(payload);
-        }
-        catch (json::exception &e)
-        {
-            LOG_WARN_FMT("JSON error : %1%", e.what());
-            LOG_WARN_FMT("Incorrect format of control message = %1%", payload);
-            program_ends.store(true);
-            return;
-        }
+        ThreadScheduling::getInstance().apply_to_current_thread(ThreadRole::CONTROL, "calibration");
 
-        std::string msg = jdata["message"];
         std::string main_dev, c_dev;
         if (device_type == "cent")
         {
@@ -217,49 +296,149 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
         }
 
         usrp_obj->initialize();
+        use_usrp_ticks(usrp_obj);
 
-        parser->set_value("max-rx-packet-size", std::to_string(usrp_obj->max_rx_packet_size), "int", "Max Rx packet size");
+        auto run_config = config->with([&usrp_obj](Config &c)
+                                       { c.max_rx_packet_size = usrp_obj->max_rx_packet_size; });
 
         // run background noise estimator
         // if (device_type == "leaf")
         //     usrp_obj->collect_background_noise_powers();
 
-        Calibration calib_class_obj(*usrp_obj, *parser, main_dev, c_dev, device_type, stop_signal_called);
+        // cent calibrating several leafs concurrently
+        if (device_type == "cent" and jdata.contains("leaf-ids"))
+        {
+            std::vector<std::string> leaf_ids = jdata["leaf-ids"];
+            auto calib_scheduler = std::make_shared<CalibrationScheduler>(*usrp_obj, run_config, main_dev, leaf_ids, stop_signal_called);
+            if (!calib_scheduler->initialize())
+            {
+                LOG_WARN("Calibration scheduler initilization FAILED!");
+                program_ends.store(true);
+                calib_running.store(false);
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(calib_mutex);
+                active_calib_scheduler = calib_scheduler;
+            }
+
+            LOG_INFO_FMT("Starting Calibration routine for %1% leafs...", leaf_ids.size());
+            calib_scheduler->run();
+            program_ends.store(true); // menu back on the cent, to send "stop" while the routine runs
+
+            while (!calib_scheduler->wait_calibration_end(std::chrono::milliseconds(100)) and not stop_signal_called)
+                ;
+
+            {
+                std::lock_guard<std::mutex> lock(calib_mutex);
+                active_calib_scheduler.reset();
+            }
+
+            LOG_INFO("Calbration ended.");
+            program_ends.store(true);
+            calib_running.store(false);
+            return;
+        }
 
-        if (!calib_class_obj.initialize())
+        auto calib_class_obj = std::make_shared<Calibration>(*usrp_obj, run_config, main_dev, c_dev, device_type, stop_signal_called);
+
+        if (!calib_class_obj->initialize())
         {
             LOG_WARN("Calibration Class object initilization FAILED!");
             program_ends.store(true);
+            calib_running.store(false);
             return;
         }
 
-        if (msg == "start")
+        if (device_type == "leaf")
+            calib_class_obj->set_response_slot(jdata.value("slot", size_t(0)));
+
         {
-            LOG_INFO("Starting Calibration routine...");
-            calib_class_obj.run_proto2();
-        }
-        else if (msg == "stop")
-        {
-            LOG_INFO("Stopping Calibration routine...");
-            calib_class_obj.stop();
+            std::lock_guard<std::mutex> lock(calib_mutex);
+            active_calib = calib_class_obj;
         }
 
-        while (!calib_class_obj.calibration_ends and not stop_signal_called)
+        LOG_INFO("Starting Calibration routine...");
+        calib_class_obj->run_proto2();
+        if (device_type == "cent")
+            program_ends.store(true); // menu back, to send "stop" while the routine runs
+
+        // wake up periodically to check for SIGINT
+        while (!calib_class_obj->wait_calibration_end(std::chrono::milliseconds(100)) and not stop_signal_called)
+            ;
+
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            std::lock_guard<std::mutex> lock(calib_mutex);
+            active_calib.reset();
         }
 
         LOG_INFO("Calbration ended.");
 
         program_ends.store(true);
+        calib_running.store(false);
+    };
 
-        return;
+    // stops the running calibration routine, if any
+    auto stop_calibration = [&active_calib_scheduler, &active_calib, &calib_mutex]()
+    {
+        std::lock_guard<std::mutex> lock(calib_mutex);
+        if (active_calib_scheduler)
+            active_calib_scheduler->stop();
+        else if (active_calib)
+            active_calib->stop();
+        else
+            return false;
+        return true;
+    };
+
+    // Calibration routine
+    auto control_calibration_callback = [&program_ends, &calib_worker, &calib_running, run_calibration, stop_calibration](const std::string &payload)
+    {
+        json jdata;
+        try
+        {
+            jdata = json::parse(payload);
+        }
+        catch (json::exception &e)
+        {
+            LOG_WARN_FMT("JSON error : %1%", e.what());
+            LOG_WARN_FMT("Incorrect format of control message = %1%", payload);
+            program_ends.store(true);
+            return;
+        }
+
+        std::string msg = jdata["message"];
+        if (msg == "stop")
+        {
+            LOG_INFO("Stopping Calibration routine...");
+            if (!stop_calibration())
+                LOG_WARN("No calibration routine running to stop.");
+            return;
+        }
+        else if (msg != "start")
+        {
+            LOG_WARN_FMT("Unknown calibration message '%1%'.", msg);
+            return;
+        }
+
+        if (calib_running)
+        {
+            LOG_WARN("A calibration routine is already running, send \"stop\" first.");
+            return;
+        }
+
+        // the previous routine has ended, only its thread is left to join
+        if (calib_worker.joinable())
+            calib_worker.join();
+        calib_running.store(true);
+        calib_worker = std::thread(run_calibration, jdata);
     };
     auto control_calib_topic = mqttClient.topics->getValue_str("calibration") + device_id;
     mqttClient.setCallback(control_calib_topic, control_calibration_callback, true);
 
     // scaling test routine
-    auto control_scaling_test_callback = [usrp_obj, parser, &program_ends, &device_type](const std::string &payload)
+    auto control_scaling_test_callback = [usrp_obj, config, &program_ends, &device_type](const std::string &payload)
     {
         json jdata;
         try
@@ -290,12 +469,16 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
         if (device_type == "leaf")
             usrp_obj->use_calib_gains = true;
         usrp_obj->initialize();
+        use_usrp_ticks(usrp_obj);
+
+        auto run_config = config->with([&usrp_obj](Config &c)
+                                       { c.max_rx_packet_size = usrp_obj->max_rx_packet_size; });
 
         // run background noise estimator
         // if (device_type == "leaf")
         //     usrp_obj->collect_background_noise_powers();
 
-        Calibration calib_class_obj(*usrp_obj, *parser, main_dev, c_dev, device_type, stop_signal_called);
+        Calibration calib_class_obj(*usrp_obj, run_config, main_dev, c_dev, device_type, stop_signal_called);
 
         if (!calib_class_obj.initialize())
         {
@@ -315,10 +498,9 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
             calib_class_obj.stop();
         }
 
-        while (!calib_class_obj.scaling_test_ends and not stop_signal_called)
-        {
-            std::this_thread::sleep_for(std::chrono::milliseconds(20));
-        }
+        // wake up periodically to check for SIGINT
+        while (!calib_class_obj.wait_scaling_test_end(std::chrono::milliseconds(100)) and not stop_signal_called)
+            ;
 
         LOG_INFO("Calbration ended.");
 
@@ -332,7 +514,7 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
     // TODO: Synchronization routine
 
     // OTAC routine
-    auto control_otac_callback = [usrp_obj, parser, &program_ends, &device_id, &device_type](const std::string &payload)
+    auto control_otac_callback = [usrp_obj, config, &program_ends, &device_id, &device_type](const std::string &payload)
     {
         LOG_INFO("------- Starting OTAC routine ----------- ");
         json jdata;
@@ -357,12 +539,16 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
         if (device_type == "leaf")
             usrp_obj->use_calib_gains = true;
         usrp_obj->initialize();
+        use_usrp_ticks(usrp_obj);
+
+        auto run_config = config->with([&usrp_obj](Config &c)
+                                       { c.max_rx_packet_size = usrp_obj->max_rx_packet_size; });
 
         // run background noise estimator
         // if (device_type == "leaf")
         //     usrp_obj->collect_background_noise_powers();
 
-        OTAC_class otac_obj(*usrp_obj, *parser, device_id, device_type, input_data, dmin, dmax, num_leafs, stop_signal_called);
+        OTAC_class otac_obj(*usrp_obj, run_config, device_id, device_type, input_data, dmin, dmax, num_leafs, stop_signal_called);
 
         if (!otac_obj.initialize())
         {
@@ -393,7 +579,7 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
     // run contoller on a separate thread
     std::string counterpart_id;
     if (device_type == "leaf")
-        counterpart_id = parser->getValue_str("cent-id");
+        counterpart_id = config->cent_id;
     bool is_cent = device_type == "cent";
 
     while (not stop_signal_called)
@@ -414,5 +600,16 @@ int UHD_SAFE_MAIN(int argc, char *argv[])
 
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
+
+    // a running calibration routine sees stop_signal_called and ends
+    if (calib_worker.joinable())
+        calib_worker.join();
+
+    LatencyProbes::getInstance().stop_reporter();
+    if (!mqttClient.flush())
+        LOG_WARN("Outbound MQTT queue not drained before exit.");
+    // persist pending devices.json updates (CFO, gains) while logging still works
+    if (!flushDeviceConfig())
+        LOG_WARN("Pending devices.json updates not written before exit.");
     return EXIT_SUCCESS;
 };
\ No newline at end of file
@@ -0,0 +1,319 @@
+#include "pch.hpp"
+
+#include "log_macros.hpp"
+#include "utility.hpp"
+#include "config.hpp"
+#include "otac_core.hpp"
+#include "channel_emulator.hpp"
+#include "latency_probes.hpp"
+
+#define LOG_LEVEL LogLevel::INFO
+
+/** Monte-Carlo simulation of the OTAC scheme.
+ *
+ * Every trial superimposes the frames of N simulated leafs -- pre-processed input, random channel
+ * phase, residual CFO and timing error -- adds AWGN, and runs the cent detection and
+ * post-processing of OTAC_class (OtacDetector, OtacScaling) on the result.
+ *
+ * usage: otac_mc_sim [key=value ...]
+ *   leafs=1,2,4        number of leafs
+ *   snr-db=0,10,20     SNR of the weakest leaf over the noise at the cent
+ *   cfo-hz=0,100       residual CFO of each leaf is uniform in [-cfo, cfo]
+ *   timing-std=0,0.5   std of the timing error of each leaf, in samples
+ *   trials=10000       trials per sweep point
+ *   threads=0          worker threads, 0 = hardware concurrency
+ *   seed=1             trial n of point p is seeded from (seed, p, n) only
+ *   dmin=1 dmax=10     input range of the leafs
+ *   config=<path>      defaults to config/config.conf of the project
+ *   out=<path>         writes <path>.bin (columns) and <path>.json (layout, sweep points)
+ */
+
+struct SweepPoint
+{
+    uint32_t num_leafs;
+    float snr_db, cfo_hz, timing_std;
+};
+
+// columnar results, one entry per trial, trial t of point p at p * trials + t
+struct TrialColumns
+{
+    std::vector<uint32_t> point, trial;
+    std::vector<uint8_t> detected;
+    std::vector<float> input_sum, output, nmse, confidence, timing_err;
+
+    void resize(const size_t &n)
+    {
+        point.resize(n);
+        trial.resize(n);
+        detected.resize(n);
+        input_sum.resize(n);
+        output.resize(n);
+        nmse.resize(n);
+        confidence.resize(n);
+        timing_err.resize(n);
+    }
+};
+
+static uint64_t splitmix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t trial_seed(const uint64_t &seed, const uint64_t &point, const uint64_t &trial)
+{
+    return splitmix64(seed ^ splitmix64((point << 32) | trial));
+}
+
+/** Runs trials for one worker thread -- owns the detector (FFT plans) and all trial buffers. */
+class TrialRunner
+{
+public:
+    TrialRunner(const OtacWaveforms &waveforms_, std::shared_ptr<const Config> config, const float &dmin, const float &dmax)
+        : waveforms(waveforms_),
+          detector(waveforms_, 10 * config->test_signal_len),
+          window_len(10 * config->test_signal_len),
+          frame_offset(2 * config->test_signal_len),
+          sample_rate(config->rate),
+          dmin(dmin), dmax(dmax),
+          min_e2e_pow(std::norm(config->min_e2e_amp)),
+          max_e2e_pow(std::norm(config->max_e2e_amp))
+    {
+        tx.assign(window_len, sample_type(0.0, 0.0));
+        rx.reserve(window_len);
+    }
+
+    void run(const SweepPoint &point, const uint64_t &seed, TrialColumns &out, const size_t &idx)
+    {
+        std::mt19937_64 rng(seed);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::normal_distribution<float> gauss(0.0f, 1.0f);
+
+        OtacScaling scaling{dmin, dmax, min_e2e_pow, float(point.num_leafs)};
+        float noise_power = min_e2e_pow * std::pow(10.0f, -point.snr_db / 10.0f);
+
+        rx.assign(window_len, sample_type(0.0, 0.0));
+        float input_sum = 0.0, mean_delay = 0.0;
+        for (uint32_t n = 0; n < point.num_leafs; ++n)
+        {
+            float input = dmin + (dmax - dmin) * unit(rng);
+            float ctol = min_e2e_pow + (max_e2e_pow - min_e2e_pow) * unit(rng);
+            float phase = 2 * M_PI * unit(rng);
+            float cfo = point.cfo_hz * (2 * unit(rng) - 1);
+            float delay = frame_offset + point.timing_std * gauss(rng);
+            input_sum += input;
+            mean_delay += delay / point.num_leafs;
+
+            float sig_scale = 0.0;
+            scaling.pre_process(input, ctol, 1.0, sig_scale);
+            sig_scale = std::min<float>(sig_scale, 1.0); // as in OTAC_class::transmission_otac
+
+            std::copy(waveforms.fs.begin(), waveforms.fs.end(), tx.begin());
+            for (size_t i = 0; i < waveforms.otac.size(); ++i)
+                tx[waveforms.fs.size() + i] = waveforms.otac[i] * sig_scale;
+
+            link.reset();
+            link.set_paths({{delay, std::polar(std::sqrt(ctol), phase)}});
+            link.set_cfo(cfo, sample_rate);
+            link.process(tx.data(), window_len, rx.data());
+        }
+
+        noise_rng.seed(rng());
+        noise_rng.add_noise(rx.data(), window_len, noise_power);
+
+        auto detection = detector.detect(rx);
+        float output = 0.0;
+        if (detection.detected)
+            scaling.post_process(detection.signal_power, noise_power, output);
+
+        out.detected[idx] = detection.detected;
+        out.input_sum[idx] = input_sum;
+        out.output[idx] = output;
+        out.nmse[idx] = detection.detected ? OtacScaling::nmse(input_sum, output) : std::numeric_limits<float>::quiet_NaN();
+        out.confidence[idx] = detection.confidence;
+        out.timing_err[idx] = detection.detected ? float(detection.frame_start - mean_delay) : std::numeric_limits<float>::quiet_NaN();
+    }
+
+private:
+    const OtacWaveforms &waveforms;
+    OtacDetector detector;
+    size_t window_len;
+    float frame_offset, sample_rate, dmin, dmax, min_e2e_pow, max_e2e_pow;
+    ChannelLink link;
+    GaussianRng noise_rng;
+    std::vector<sample_type> tx, rx; // tx: frame of one leaf, zero padded to the window
+};
+
+template <typename T>
+static std::vector<T> parse_list(const std::string &value)
+{
+    std::vector<std::string> items;
+    boost::split(items, value, boost::is_any_of(","));
+    std::vector<T> list;
+    for (const auto &item : items)
+        list.push_back(boost::lexical_cast<T>(boost::trim_copy(item)));
+    return list;
+}
+
+template <typename T>
+static void write_column(std::ofstream &file, const std::vector<T> &column, const std::string &name, const std::string &dtype, json &layout)
+{
+    layout.push_back({{"name", name}, {"dtype", dtype}, {"offset", size_t(file.tellp())}, {"count", column.size()}});
+    file.write(reinterpret_cast<const char *>(column.data()), column.size() * sizeof(T));
+}
+
+int main(int argc, char *argv[])
+{
+    /*------ Initialize ---------------*/
+    std::string homeDirStr = get_home_dir();
+    std::string projectDir = homeDirStr + "/OTA-C/ProjectRoot";
+    std::string curr_time_str = currentDateTimeFilename();
+
+    std::map<std::string, std::string> args = {
+        {"leafs", "1,2,4,8"},
+        {"snr-db", "0,10,20"},
+        {"cfo-hz", "0"},
+        {"timing-std", "0"},
+        {"trials", "10000"},
+        {"threads", "0"},
+        {"seed", "1"},
+        {"dmin", "1"},
+        {"dmax", "10"},
+        {"config", projectDir + "/config/config.conf"},
+        {"out", projectDir + "/storage/otac_mc_sim_" + curr_time_str}};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        size_t pos = arg.find('=');
+        if (pos == std::string::npos or args.count(arg.substr(0, pos)) == 0)
+            throw std::invalid_argument("ERROR : unknown argument " + arg + ", expected key=value (see main/simulation/otac_mc_sim.cpp).");
+        args[arg.substr(0, pos)] = arg.substr(pos + 1);
+    }
+
+    /*----- LOG ------------------------*/
+    std::string logFileName = projectDir + "/storage/logs/otac_mc_sim_" + curr_time_str + ".log";
+    Logger::getInstance().initialize(logFileName);
+    Logger::getInstance().setLogLevel(LOG_LEVEL);
+
+    /*------ Parse Config -------------*/
+    ConfigParser parser(args["config"]);
+    parser.set_value("device-id", "simulation", "str");
+    auto config = Config::from_parser(parser);
+
+    float dmin = boost::lexical_cast<float>(args["dmin"]);
+    float dmax = boost::lexical_cast<float>(args["dmax"]);
+    size_t trials = boost::lexical_cast<size_t>(args["trials"]);
+    uint64_t seed = boost::lexical_cast<uint64_t>(args["seed"]);
+    size_t num_threads = boost::lexical_cast<size_t>(args["threads"]);
+    if (num_threads == 0)
+        num_threads = std::max<size_t>(boost::thread::hardware_concurrency(), 1);
+    if (dmax <= dmin or trials == 0 or trials > std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("ERROR : require dmin < dmax and 0 < trials < 2^32.");
+
+    std::vector<SweepPoint> points;
+    for (auto num_leafs : parse_list<uint32_t>(args["leafs"]))
+        for (auto snr_db : parse_list<float>(args["snr-db"]))
+            for (auto cfo_hz : parse_list<float>(args["cfo-hz"]))
+                for (auto timing_std : parse_list<float>(args["timing-std"]))
+                    points.push_back({num_leafs, snr_db, cfo_hz, timing_std});
+
+    size_t total_trials = points.size() * trials;
+    LOG_INFO_FMT("Simulating %1% sweep points x %2% trials on %3% threads.", points.size(), trials, num_threads);
+
+    /*------ Run trials ---------------*/
+    OtacWaveforms waveforms = OtacWaveforms::generate(config->test_signal_len);
+
+    TrialColumns results;
+    results.resize(total_trials);
+
+    // FFTW planning is not thread-safe -- runners are created and destroyed here, not in the workers
+    std::vector<std::unique_ptr<TrialRunner>> runners;
+    for (size_t t = 0; t < num_threads; ++t)
+        runners.push_back(std::make_unique<TrialRunner>(waveforms, config, dmin, dmax));
+
+    const size_t chunk = 256;
+    std::atomic<size_t> next_trial{0};
+    auto worker = [&](TrialRunner *runner)
+    {
+        for (size_t begin = next_trial.fetch_add(chunk); begin < total_trials; begin = next_trial.fetch_add(chunk))
+        {
+            size_t end = std::min(begin + chunk, total_trials);
+            for (size_t idx = begin; idx < end; ++idx)
+            {
+                size_t p = idx / trials, t = idx % trials;
+                results.point[idx] = p;
+                results.trial[idx] = t;
+                runner->run(points[p], trial_seed(seed, p, t), results, idx);
+            }
+        }
+    };
+
+    int64_t start_ns = LatencyProbes::now_ns();
+    boost::thread_group workers;
+    for (auto &runner : runners)
+        workers.create_thread(boost::bind<void>(worker, runner.get()));
+    workers.join_all();
+    double elapsed = (LatencyProbes::now_ns() - start_ns) / 1e9;
+    runners.clear();
+
+    LOG_INFO_FMT("%1% trials in %2% secs -- %3% trials/sec.", total_trials, elapsed, total_trials / elapsed);
+
+    /*------ Summary -------------------*/
+    for (size_t p = 0; p < points.size(); ++p)
+    {
+        size_t num_detected = 0;
+        double nmse_sum = 0.0;
+        for (size_t idx = p * trials; idx < (p + 1) * trials; ++idx)
+        {
+            if (not results.detected[idx])
+                continue;
+            num_detected++;
+            nmse_sum += results.nmse[idx];
+        }
+        LOG_INFO_FMT("leafs = %1%, snr = %2% dB, cfo = %3% Hz, timing std = %4% : detected %5%/%6%, mean NMSE = %7%",
+                     points[p].num_leafs, points[p].snr_db, points[p].cfo_hz, points[p].timing_std,
+                     num_detected, trials, (num_detected > 0 ? nmse_sum / num_detected : std::numeric_limits<double>::quiet_NaN()));
+    }
+
+    /*------ Save results --------------*/
+    std::ofstream bin_file(args["out"] + ".bin", std::ios::binary);
+    if (not bin_file)
+        LOG_ERROR_FMT("Failed to open %1%.bin", args["out"]);
+
+    json columns = json::array();
+    write_column(bin_file, results.point, "point", "uint32", columns);
+    write_column(bin_file, results.trial, "trial", "uint32", columns);
+    write_column(bin_file, results.detected, "detected", "uint8", columns);
+    write_column(bin_file, results.input_sum, "input_sum", "float32", columns);
+    write_column(bin_file, results.output, "output", "float32", columns);
+    write_column(bin_file, results.nmse, "nmse", "float32", columns);
+    write_column(bin_file, results.confidence, "confidence", "float32", columns);
+    write_column(bin_file, results.timing_err, "timing_err", "float32", columns);
+    bin_file.close();
+
+    json sweep = json::array();
+    for (const auto &point : points)
+        sweep.push_back({{"leafs", point.num_leafs}, {"snr_db", point.snr_db}, {"cfo_hz", point.cfo_hz}, {"timing_std", point.timing_std}});
+
+    json meta = {
+        {"data_file", args["out"] + ".bin"},
+        {"byte_order", "little"},
+        {"trials_per_point", trials},
+        {"seed", seed},
+        {"dmin", dmin},
+        {"dmax", dmax},
+        {"test_signal_len", config->test_signal_len},
+        {"rate", config->rate},
+        {"min_e2e_amp", config->min_e2e_amp},
+        {"max_e2e_amp", config->max_e2e_amp},
+        {"columns", columns},
+        {"points", sweep}};
+    std::ofstream meta_file(args["out"] + ".json");
+    meta_file << meta.dump(4) << std::endl;
+
+    LOG_INFO_FMT("Results saved to %1%.bin and %1%.json", args["out"]);
+    return EXIT_SUCCESS;
+}
@@ -5,6 +5,14 @@ import sqlite3
 import json
 import time
 
+try:
+    import cbor2
+except ImportError:
+    cbor2 = None
+
+# schema version of binary (CBOR) telemetry payloads understood by this listener
+PAYLOAD_SCHEMA_VERSION = 1
+
 list_of_topics = [
     "calibration/#",
     "control/#",
@@ -28,10 +36,33 @@ c.execute('''
           ''')
 conn.commit()
 
+def decode_payload(payload, timestamp):
+    """Returns payload as text -- CBOR payloads (first byte 0xa0-0xbf, a CBOR map)
+    are converted to JSON so the database keeps a single format."""
+    if len(payload) == 0 or not (0xa0 <= payload[0] <= 0xbf):
+        return payload.decode('utf-8', errors='replace')
+
+    if cbor2 is None:
+        print("Received CBOR payload but cbor2 is not installed (pip install cbor2)")
+        return payload.hex()
+
+    try:
+        data = cbor2.loads(payload)
+    except Exception as e:
+        print(f"CBOR decoding error: {e}")
+        return payload.hex()
+
+    if data.get("v", PAYLOAD_SCHEMA_VERSION) > PAYLOAD_SCHEMA_VERSION:
+        print(f"Payload schema version {data['v']} is newer than supported {PAYLOAD_SCHEMA_VERSION}")
+    # binary payloads carry device ticks ("t" at rate "tr") instead of a local time string
+    if "time" not in data:
+        data["time"] = timestamp
+    return json.dumps(data)
+
 # Callback when a message is received
 def on_message(client, userdata, msg):
-    payload_str = msg.payload.decode('utf-8')
     timestamp = time.strftime('%Y-%m-%d %H:%M:%S', time.localtime())
+    payload_str = decode_payload(msg.payload, timestamp)
     print(f"Received message on {msg.topic}: {payload_str}")
 
     # Insert message into the database
@@ -2,19 +2,19 @@
 
 Calibration::Calibration(
     USRP_class &usrp_obj_,
-    ConfigParser &parser_,
+    std::shared_ptr<const Config> config_,
     const std::string &device_id_,
     const std::string &counterpart_id_,
     const std::string &device_type_,
-    bool &signal_stop_called_) : usrp_obj(&usrp_obj_),
-                                 parser(parser_),
-                                 device_id(device_id_),
-                                 counterpart_id(counterpart_id_),
-                                 device_type(device_type_),
-                                 signal_stop_called(signal_stop_called_),
+    bool &signal_stop_called_) : signal_stop_called(signal_stop_called_),
+                                 usrp_obj(&usrp_obj_),
+                                 config(config_),
                                  csd_obj(nullptr),
                                  peak_det_obj(nullptr),
-                                 ref_waveform()
+                                 ref_waveform(),
+                                 device_id(device_id_),
+                                 counterpart_id(counterpart_id_),
+                                 device_type(device_type_)
 {
     if (device_type == "cent")
     {
@@ -39,17 +39,17 @@ Calibration::~Calibration()
 
 void Calibration::initialize_peak_det_obj()
 {
-    peak_det_obj = std::make_unique<PeakDetectionClass>(parser, usrp_obj->init_noise_ampl);
+    peak_det_obj = std::make_unique<PeakDetectionClass>(config, usrp_obj->init_noise_ampl);
 }
 
 void Calibration::initialize_csd_obj()
 {
-    size_t capacity = std::pow(2.0, parser.getValue_int("capacity-pow"));
-    min_e2e_pow = std::norm(parser.getValue_float("min-e2e-amp"));
-    max_e2e_pow = std::norm(parser.getValue_float("max-e2e-amp"));
-    double rx_sample_duration_float = 1 / parser.getValue_float("rate");
+    size_t capacity = std::pow(2.0, config->capacity_pow);
+    min_e2e_pow = std::norm(config->min_e2e_amp);
+    max_e2e_pow = std::norm(config->max_e2e_amp);
+    double rx_sample_duration_float = 1 / config->rate;
     uhd::time_spec_t rx_sample_duration = uhd::time_spec_t(rx_sample_duration_float);
-    csd_obj = std::make_unique<CycleStartDetector>(parser, capacity, rx_sample_duration, *peak_det_obj);
+    csd_obj = std::make_unique<CycleStartDetector>(config, capacity, rx_sample_duration, usrp_obj->master_clock_rate, *peak_det_obj);
 }
 
 void Calibration::get_mqtt_topics()
@@ -66,7 +66,7 @@ void Calibration::get_mqtt_topics()
     flag_topic_leaf = mqttClient.topics->getValue_str("calib-flags") + leaf_id; // flags are set by the leaf
     mctest_topic = mqttClient.topics->getValue_str("calib-mctest") + cent_id;
 
-    ltoc_topic = mqttClient.topics->getValue_str("calib-ltoc") + cent_id;       // ltoc sigpow is sent by cent
+    ltoc_topic = mqttClient.topics->getValue_str("calib-ltoc") + leaf_id;       // ltoc sigpow is sent by cent
     ctol_topic = mqttClient.topics->getValue_str("calib-ctol") + leaf_id;       // ctol sigpow is sent by cent
     cal_scale_topic = mqttClient.topics->getValue_str("calib-scale") + leaf_id; // flags are set by the leaf
 
@@ -78,15 +78,15 @@ void Calibration::get_mqtt_topics()
 void Calibration::generate_waveform()
 {
     WaveformGenerator wf_gen;
-    size_t N_zfc = parser.getValue_int("Ref-N-zfc");
-    size_t q_zfc = parser.getValue_int("Ref-m-zfc");
-    size_t reps_zfc = parser.getValue_int("Ref-R-zfc"); // extra long ref signal for stability
-    size_t wf_pad = size_t(parser.getValue_int("Ref-padding-mul") * N_zfc);
+    size_t N_zfc = config->ref_n_zfc;
+    size_t q_zfc = config->ref_m_zfc;
+    size_t reps_zfc = config->ref_r_zfc; // extra long ref signal for stability
+    size_t wf_pad = size_t(config->ref_padding_mul * N_zfc);
 
     wf_gen.initialize(wf_gen.ZFC, N_zfc, reps_zfc, 0, wf_pad, q_zfc, calib_sig_scale, 0);
     ref_waveform = wf_gen.generate_waveform();
 
-    size_t otac_wf_len = parser.getValue_int("test-signal-len");
+    size_t otac_wf_len = config->test_signal_len;
     wf_gen.initialize(wf_gen.UNIT_RAND, otac_wf_len, 1, 0, otac_wf_len, 1, calib_sig_scale, 1);
     otac_waveform = wf_gen.generate_waveform();
 }
@@ -96,6 +96,8 @@ bool Calibration::initialize()
     csd_success_flag = false;
     calibration_successful = false;
     calibration_ends = false;
+    routine_flags.clear(ROUTINE_CALIBRATION);
+    peer_flags.clear(FLAG_RECV | FLAG_RETX | FLAG_END);
     ltoc = -1.0, ctol = -1.0;
     try
     {
@@ -151,6 +153,7 @@ void Calibration::run_proto1()
         producer_thread = boost::thread(&Calibration::producer_cent_proto1, this);
         consumer_thread = boost::thread(&Calibration::consumer_cent_proto1, this);
     }
+    apply_thread_roles();
 };
 
 void Calibration::run_proto2()
@@ -173,11 +176,13 @@ void Calibration::run_proto2()
         producer_thread = boost::thread(&Calibration::producer_cent_proto2, this);
         consumer_thread = boost::thread(&Calibration::consumer_cent_proto2, this);
     }
+    apply_thread_roles();
 };
 
 void Calibration::run_scaling_tests()
 {
     scaling_test_ends = false;
+    routine_flags.clear(ROUTINE_SCALING_TEST);
 
     // warm up the device
     for (int i = 0; i < 5; ++i)
@@ -188,7 +193,7 @@ void Calibration::run_scaling_tests()
         std::this_thread::sleep_for(std::chrono::milliseconds(50));
     }
 
-    end_flag = false;
+    peer_flags.clear(FLAG_END);
 
     if (device_type == "leaf")
     {
@@ -200,18 +205,47 @@ void Calibration::run_scaling_tests()
         producer_thread = boost::thread(&Calibration::run_scaling_tests_cent, this);
         consumer_thread = boost::thread(&Calibration::consumer_cent_proto1, this);
     }
+    apply_thread_roles();
+}
+
+void Calibration::apply_thread_roles()
+{
+    ThreadScheduling &sched = ThreadScheduling::getInstance();
+    sched.apply(producer_thread, ThreadRole::RX, "calib." + device_type + ".producer");
+    sched.apply(consumer_thread, ThreadRole::DSP, "calib." + device_type + ".consumer");
 }
 
 void Calibration::stop()
 {
     csd_success_flag.store(true);
-    calibration_ends = true;
-    scaling_test_ends = true;
+    end_routine(ROUTINE_CALIBRATION | ROUTINE_SCALING_TEST);
+    peer_flags.interrupt();
 
     std::this_thread::sleep_for(std::chrono::milliseconds(500));
+}
 
-    LOG_INFO("Deleting Calibration Class object!");
-    delete this;
+void Calibration::end_routine(const uint32_t &routine)
+{
+    if (routine & ROUTINE_CALIBRATION)
+        calibration_ends = true;
+    if (routine & ROUTINE_SCALING_TEST)
+        scaling_test_ends = true;
+    routine_flags.set(routine);
+}
+
+void Calibration::set_response_slot(const size_t &slot)
+{
+    response_slot = slot;
+}
+
+bool Calibration::wait_calibration_end(const std::chrono::milliseconds &timeout)
+{
+    return routine_flags.wait_any(ROUTINE_CALIBRATION, Deadline(timeout)) != 0;
+}
+
+bool Calibration::wait_scaling_test_end(const std::chrono::milliseconds &timeout)
+{
+    return routine_flags.wait_any(ROUTINE_SCALING_TEST, Deadline(timeout)) != 0;
 }
 
 // checks whether two values are close to each other, based on tolerance value set inside the function
@@ -232,51 +266,39 @@ bool Calibration::proximity_check(const float &val1, const float &val2)
 // callback to update ltoc value
 void Calibration::callback_update_ltoc(const std::string &payload)
 {
-    try
-    {
-        json jsonData = json::parse(payload);
-        if (jsonData.contains("value"))
-        {
-            std::string temp_ltoc = jsonData["value"];
-            ltoc = std::stof(temp_ltoc);
-            LOG_DEBUG_FMT("MQTT >> LTOC received = %1%", ltoc);
-            recv_success = true;
-            if (ltoc < 0)
-                LOG_WARN("CTOL is not updated yet!");
-            // else if (proximity_check(ctol, ltoc))
-            //     calibration_successful = true;
-        }
-    }
-    catch (const json::parse_error &e)
+    float ltoc_val;
+    if (not MQTTClient::payload_value(payload, ltoc_val))
     {
-        LOG_WARN_FMT("MQTT >> JSON parsing error : %1%", e.what());
-        LOG_WARN_FMT("Incorrect JSON string = %1%", payload);
+        LOG_WARN("MQTT >> LTOC message without valid value.");
+        return;
     }
+
+    ltoc = ltoc_val;
+    LOG_DEBUG_FMT("MQTT >> LTOC received = %1%", ltoc);
+    ltoc_updates.set(ltoc);
+    if (ltoc < 0)
+        LOG_WARN("CTOL is not updated yet!");
+    // else if (proximity_check(ctol, ltoc))
+    //     calibration_successful = true;
 }
 
 void Calibration::callback_detect_flags(const std::string &payload)
 {
-    try
+    std::string flag_value;
+    if (not MQTTClient::payload_value(payload, flag_value))
     {
-        json jsonData = json::parse(payload);
-        if (jsonData.contains("value"))
-        {
-            std::string flag_value = jsonData["value"];
-            if (flag_value == "recv")
-                recv_flag = true;
-            else if (flag_value == "retx")
-                retx_flag = true;
-            else if (flag_value == "end")
-                end_flag = true;
-            else
-                LOG_WARN_FMT("MQTT >> Flag %1% does not match any.", jsonData["value"]);
-        }
-    }
-    catch (const json::parse_error &e)
-    {
-        LOG_WARN_FMT("MQTT >> JSON parsing error : %1%", e.what());
-        LOG_WARN_FMT("Incorrect JSON string = %1%", payload);
+        LOG_WARN("MQTT >> Flag message without valid value.");
+        return;
     }
+
+    if (flag_value == "recv")
+        peer_flags.set(FLAG_RECV);
+    else if (flag_value == "retx")
+        peer_flags.set(FLAG_RETX);
+    else if (flag_value == "end")
+        peer_flags.set(FLAG_END);
+    else
+        LOG_WARN_FMT("MQTT >> Flag %1% does not match any.", flag_value);
 }
 
 bool Calibration::check_ctol()
@@ -380,11 +402,13 @@ void Calibration::producer_leaf_proto1()
         // Update Tx/Rx gains based on ltoc values obtained
         size_t leaf_tx_round = 1;
         recv_success = false;
-        // Transmit scaled REF
+        uint64_t ltoc_version = ltoc_updates.version();
+        // Transmit scaled REF every 100ms until cent replies with ltoc
         while (not signal_stop_called and not calibration_successful and not recv_success)
         {
             transmission_ref(full_scale);
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            float ltoc_recv;
+            recv_success = ltoc_updates.wait_next(ltoc_recv, ltoc_version, Deadline(std::chrono::milliseconds(100)));
         }
 
         // based on ratio between ctol and ltoc rssi values, update TX gain of leaf node
@@ -402,7 +426,7 @@ void Calibration::producer_leaf_proto1()
         proximity_tol = proximity_tol * std::max(1.0, std::ceil(double(round / 10)));
     }
 
-    calibration_ends = true;
+    end_routine(ROUTINE_CALIBRATION);
 };
 
 void Calibration::producer_cent_proto1()
@@ -413,24 +437,22 @@ void Calibration::producer_cent_proto1()
     // reception/producer params
     size_t round = 1;
 
-    while (not signal_stop_called && not end_flag && round++ < max_total_round)
+    while (not signal_stop_called && not peer_flags.test(FLAG_END) && round++ < max_total_round)
     {
         LOG_INFO_FMT("-------------- Transmit Round %1% ------------", round);
 
-        // Transmit REF
-        while (not recv_flag && not end_flag && not signal_stop_called)
+        // Transmit REF every 100ms until leaf raises a flag
+        while (not peer_flags.test(FLAG_RECV | FLAG_END) && not signal_stop_called)
         {
             transmission_ref();
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            peer_flags.wait_any(FLAG_RECV | FLAG_END, Deadline(std::chrono::milliseconds(100)));
         }
 
-        if (signal_stop_called || end_flag)
+        if (signal_stop_called || peer_flags.test(FLAG_END))
             break;
 
         // MQTT message received -- start reception
-        if (recv_flag)
-            recv_flag = false;
-        else
+        if (not peer_flags.consume(FLAG_RECV))
             LOG_WARN("Receive flag is not set! Should not reach here!!!");
 
         // start receiving REF signal
@@ -479,7 +501,7 @@ void Calibration::producer_cent_proto1()
         mqttClient.publish(ltoc_topic, mqttClient.timestamp_float_data(ltoc), false);
     }
 
-    calibration_ends = true;
+    end_routine(ROUTINE_CALIBRATION);
 }
 
 void Calibration::consumer_leaf_proto1()
@@ -538,11 +560,13 @@ void Calibration::producer_leaf_proto2()
 
             // transmit otac signal
             recv_success = false;
+            uint64_t ltoc_version = ltoc_updates.version();
             if (tx_timer <= uhd::time_spec_t(0.0))
             {
                 LOG_WARN("Estimate REF timer incorrect. Transmitting OTAC signal without proper reference.");
-                tx_timer = usrp_obj->usrp->get_time_now() + uhd::time_spec_t(parser.getValue_float("start-tx-wait-microsec") / 1e6);
+                tx_timer = usrp_obj->usrp->get_time_now() + uhd::time_spec_t(config->start_tx_wait_microsec / 1e6);
             }
+            tx_timer += uhd::time_spec_t(response_slot * response_slot_len(*config) / usrp_obj->tx_rate);
 
             float sig_scale = std::min<float>(full_scale / std::sqrt(ctol / min_e2e_pow), 10.0);
             LOG_DEBUG_FMT("Transmitting OTAC signal with scale %1% = (%2% * %3% / %4%)", full_scale / std::sqrt(ctol / min_e2e_pow), full_scale, std::sqrt(min_e2e_pow), std::sqrt(ctol));
@@ -559,9 +583,8 @@ void Calibration::producer_leaf_proto2()
             }
             else
             {
-                size_t wait_counter = 0;
-                while (not recv_success && wait_counter++ < 20)
-                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                float ltoc_recv;
+                recv_success = ltoc_updates.wait_next(ltoc_recv, ltoc_version, Deadline(std::chrono::seconds(2)));
 
                 if (recv_success)
                 {
@@ -587,7 +610,7 @@ void Calibration::producer_leaf_proto2()
         proximity_tol = init_proximity_tol * std::max(1.0, std::ceil(double(round / 3)));
     }
 
-    calibration_ends = true;
+    end_routine(ROUTINE_CALIBRATION);
 }
 
 void Calibration::producer_cent_proto2()
@@ -597,20 +620,21 @@ void Calibration::producer_cent_proto2()
     // reception/producer params
     size_t round = 0;
 
-    size_t N_zfc = parser.getValue_int("Ref-N-zfc");
-    size_t ref_pad_len = parser.getValue_int("Ref-padding-mul") * N_zfc;
+    size_t N_zfc = config->ref_n_zfc;
+    size_t ref_pad_len = config->ref_padding_mul * N_zfc;
     double first_sample_gap = ref_pad_len / usrp_obj->rx_rate;
-    double wait_duration = first_sample_gap + (parser.getValue_float("start-tx-wait-microsec") / 1e6);
-    size_t otac_wf_len = parser.getValue_int("test-signal-len");
+    double wait_duration = first_sample_gap + (config->start_tx_wait_microsec / 1e6);
+    size_t otac_wf_len = config->test_signal_len;
 
-    while (not signal_stop_called && not end_flag && round++ < max_total_round)
+    while (not signal_stop_called && not peer_flags.test(FLAG_END) && round++ < max_total_round)
     {
         LOG_INFO_FMT("-------------- Round %1% ------------", round);
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-
-        if (retx_flag)
-            retx_flag = false;
+        // pause between rounds -- a retransmission request from leaf starts the next round right away
+        peer_flags.wait_any(FLAG_RETX | FLAG_END, Deadline(std::chrono::milliseconds(1000)));
+        if (peer_flags.test(FLAG_END))
+            break;
+        peer_flags.clear(FLAG_RETX);
 
         // Transmit REF
         uhd::time_spec_t tx_timer = usrp_obj->usrp->get_time_now() + uhd::time_spec_t(10e-3);
@@ -625,7 +649,7 @@ void Calibration::producer_cent_proto2()
                 txrx_gap -= ((otac_wf_len / usrp_obj->rx_rate) * 1e6);
                 LOG_INFO_FMT("OTAC signal synchronization gap = %1% microsecs", txrx_gap);
                 LOG_INFO_FMT("OTAC ltoc = %1%", ltoc / min_e2e_pow);
-                float exp_wait_time = parser.getValue_float("start-tx-wait-microsec");
+                float exp_wait_time = config->start_tx_wait_microsec;
                 if (txrx_gap > exp_wait_time + 200)
                 {
                     LOG_WARN("OTAC signal reception delay is too big -> Reject this data.");
@@ -638,7 +662,7 @@ void Calibration::producer_cent_proto2()
         }
     }
 
-    calibration_ends = true;
+    end_routine(ROUTINE_CALIBRATION);
 }
 
 void Calibration::consumer_leaf_proto2()
@@ -653,10 +677,8 @@ void Calibration::consumer_leaf_proto2()
 
 void Calibration::consumer_cent_proto2()
 {
-    while (not signal_stop_called)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
+    while (not signal_stop_called and not calibration_ends)
+        routine_flags.wait_any(ROUTINE_CALIBRATION, Deadline(std::chrono::milliseconds(100)));
 }
 
 bool Calibration::transmission_ref(const float &scale, const uhd::time_spec_t &tx_timer)
@@ -707,13 +729,23 @@ bool Calibration::reception_ref(float &rx_sig_pow, uhd::time_spec_t &tx_timer)
     {
         csd_obj->produce(samples, sample_size, sample_time, signal_stop_called);
 
-        if (csd_success_flag || retx_flag || end_flag)
+        if (csd_success_flag || peer_flags.test(FLAG_RETX | FLAG_END))
             return true;
         else
             return false;
     };
 
-    usrp_obj->reception(signal_stop_called, 0, 0, uhd::time_spec_t(0.0), false, producer_wrapper);
+    // with `cpu-format sc16` the packets go to the sc16 ring without conversion
+    auto producer_wrapper_sc16 = [this](const std::vector<std::vector<sc16_type>> &samples, const size_t &sample_size, const uhd::time_spec_t &sample_time)
+    {
+        csd_obj->produce(samples[0], sample_size, sample_time, signal_stop_called);
+        return csd_success_flag || peer_flags.test(FLAG_RETX | FLAG_END);
+    };
+
+    if (usrp_obj->rx_sc16)
+        usrp_obj->reception_channels_sc16(signal_stop_called, 0, 0, uhd::time_spec_t(0.0), false, producer_wrapper_sc16);
+    else
+        usrp_obj->reception(signal_stop_called, 0, 0, uhd::time_spec_t(0.0), false, producer_wrapper);
 
     if (!csd_success_flag)
     {
@@ -732,40 +764,17 @@ bool Calibration::reception_ref(float &rx_sig_pow, uhd::time_spec_t &tx_timer)
 bool Calibration::reception_otac(float &rx_sig_pow, uhd::time_spec_t &tx_timer)
 {
     float usrp_noise_power = usrp_obj->init_noise_ampl * usrp_obj->init_noise_ampl;
-    size_t otac_wf_len = parser.getValue_int("test-signal-len");
-    size_t req_num_samps = 5 * otac_wf_len;
+    size_t otac_wf_len = config->test_signal_len;
+    size_t req_num_samps = response_slot_len(*config);
     auto otac_rx_samps = usrp_obj->reception(signal_stop_called, req_num_samps, 0.0, tx_timer, true);
 
     if (otac_rx_samps.size() == req_num_samps)
     {
-        std::vector<float> norm_samples(otac_rx_samps.size());
-        std::transform(otac_rx_samps.begin(), otac_rx_samps.end(), norm_samples.begin(), [](const std::complex<float> &c)
-                       { return std::norm(c); });
         // compute signal power over window
-        float max_val = 0.0, temp_val = 0.0, win_pow = 0.0;
-        size_t max_index = 0;
-        for (size_t i = 0; i < req_num_samps - otac_wf_len; ++i)
-        {
-            if (i == 0)
-            {
-                for (size_t j = 0; j < otac_wf_len; ++j)
-                {
-                    temp_val += norm_samples[j];
-                }
-            }
-            else
-            {
-                temp_val -= norm_samples[i - 1];
-                temp_val += norm_samples[i + otac_wf_len - 1];
-            }
-
-            win_pow = temp_val / otac_wf_len;
-            if (win_pow > max_val)
-            {
-                max_val = win_pow;
-                max_index = i;
-            }
-        }
+        WindowPowerEngine engine(otac_wf_len);
+        auto result = engine.process(otac_rx_samps, 10 * usrp_noise_power, window_prefix);
+        float max_val = std::max(result.max_power, 0.0f);
+        size_t max_index = result.max_index;
 
         if (max_val < 10 * usrp_noise_power)
         {
@@ -859,27 +868,16 @@ void Calibration::run_scaling_tests_leaf()
 
     size_t tx_counter = 0;
     float mctest_pow = 0.0;
-    size_t mc_round_temp;
+    AwaitableValue<float> mctest_updates;
 
     // Callback to listen for mctest result from cent
-    auto callback_mctest = [&tx_counter, &mc_round, &mctest_pow](const std::string &payload)
+    auto callback_mctest = [&mctest_updates](const std::string &payload)
     {
-        try
+        float mctest_val;
+        if (MQTTClient::payload_value(payload, mctest_val))
         {
-            json jsonData = json::parse(payload);
-
-            if (jsonData.contains("value"))
-            {
-                std::string temp_mctest = jsonData["value"];
-                mctest_pow = std::stof(temp_mctest);
-                LOG_DEBUG_FMT("MQTT >> MCTEST received = %1%", mctest_pow);
-                mc_round++;
-            }
-        }
-        catch (const json::parse_error &e)
-        {
-            LOG_WARN_FMT("MQTT >> JSON parsing error : %1%", e.what());
-            LOG_WARN_FMT("Incorrect JSON string = %1%", payload);
+            LOG_DEBUG_FMT("MQTT >> MCTEST received = %1%", mctest_val);
+            mctest_updates.set(mctest_val);
         }
     };
 
@@ -888,17 +886,22 @@ void Calibration::run_scaling_tests_leaf()
     while (mc_round < max_mctest_rounds)
     {
         float mc_temp = dist(gen);
-        mc_round_temp = mc_round;
-        while (mc_round == mc_round_temp and tx_counter++ < 10)
+        uint64_t mctest_version = mctest_updates.version();
+        bool mctest_recv = false;
+        while (not mctest_recv and tx_counter++ < 10 and not signal_stop_called)
         {
             LOG_DEBUG_FMT("MC Round %1% : transmitting signal of amplitude = %2%", mc_round, mc_temp);
             transmission_ref(mc_temp / calib_sig_scale);
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            mctest_recv = mctest_updates.wait_next(mctest_pow, mctest_version, Deadline(std::chrono::milliseconds(500)));
         }
 
         tx_counter = 0;
+        if (mctest_recv)
+            mc_round++;
 
-        if (mctest_pow == 0.0)
+        if (signal_stop_called)
+            break;
+        else if (mctest_pow == 0.0)
         {
             LOG_WARN("No data received from cent.");
         }
@@ -907,13 +910,15 @@ void Calibration::run_scaling_tests_leaf()
             json tString;
             tString["tx_scale"] = mc_temp;
             tString["rx_pow"] = mctest_pow;
-            tString["time"] = currentDateTime();
-            mqttClient.publish(tele_scaling_topic, tString.dump(4), false);
+            mqttClient.publish(tele_scaling_topic, mqttClient.encode_payload(std::move(tString)), false);
             mctest_pow = 0.0;
         }
     }
 
-    scaling_test_ends = true;
+    // the callback captures locals of this function
+    mqttClient.unsubscribe(mctest_topic);
+
+    end_routine(ROUTINE_SCALING_TEST);
 }
 
 void Calibration::run_scaling_tests_cent()
@@ -923,7 +928,7 @@ void Calibration::run_scaling_tests_cent()
 
     size_t mc_round = 0;
     bool receive_flag = false;
-    end_flag = false;
+    peer_flags.clear(FLAG_END);
     float mc_temp;
     uhd::time_spec_t tmp_timer;
     while (mc_round++ < max_mctest_rounds)
@@ -956,5 +961,5 @@ void Calibration::run_scaling_tests_cent()
         }
     }
 
-    scaling_test_ends = true;
+    end_routine(ROUTINE_SCALING_TEST);
 }
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include "calibration_scheduler.hpp"
+
+CalibrationScheduler::CalibrationScheduler(
+    USRP_class &usrp_obj_,
+    std::shared_ptr<const Config> config_,
+    const std::string &cent_id_,
+    const std::vector<std::string> &leaf_ids,
+    bool &signal_stop_called_) : signal_stop_called(signal_stop_called_),
+                                 config(config_),
+                                 usrp_obj(&usrp_obj_),
+                                 cent_id(cent_id_),
+                                 sessions(leaf_ids.size())
+{
+    for (size_t slot = 0; slot < leaf_ids.size(); ++slot)
+    {
+        sessions[slot].leaf_id = leaf_ids[slot];
+        if (not slot_of_leaf.emplace(leaf_ids[slot], slot).second)
+            LOG_WARN_FMT("Leaf %1% is listed twice, only slot %2% is used.", leaf_ids[slot], slot_of_leaf[leaf_ids[slot]]);
+    }
+}
+
+CalibrationScheduler::~CalibrationScheduler()
+{
+    if (producer_thread.joinable())
+        producer_thread.join();
+
+    MQTTClient &mqttClient = MQTTClient::getInstance(cent_id);
+    if (not flag_topic_filter.empty())
+        mqttClient.unsubscribe(flag_topic_filter);
+}
+
+bool CalibrationScheduler::initialize()
+{
+    calibration_ends = false;
+    routine_flags.clear(1);
+    try
+    {
+        min_e2e_pow = std::norm(config->min_e2e_amp);
+
+        WaveformGenerator wf_gen;
+        size_t N_zfc = config->ref_n_zfc;
+        size_t wf_pad = size_t(config->ref_padding_mul * N_zfc);
+        wf_gen.initialize(wf_gen.ZFC, N_zfc, config->ref_r_zfc, 0, wf_pad, config->ref_m_zfc, 1.0, 0);
+        ref_waveform = wf_gen.generate_waveform();
+
+        MQTTClient &mqttClient = MQTTClient::getInstance(cent_id);
+        for (auto &session : sessions)
+            session.ltoc_topic = mqttClient.topics->getValue_str("calib-ltoc") + session.leaf_id;
+
+        // flags of all leafs through one subscription, `calibration/flags/<leaf-id>`
+        flag_topic_prefix = mqttClient.topics->getValue_str("calib-flags");
+        flag_topic_filter = flag_topic_prefix + "+";
+        mqttClient.setFilterCallback(flag_topic_filter, [this](const std::string &topic, const std::string &payload)
+                                     { on_leaf_flag(topic, payload); });
+        return true;
+    }
+    catch (std::exception &e)
+    {
+        LOG_WARN_FMT("Calibration scheduler initialization failed with ERROR: %1%", e.what());
+        return false;
+    }
+}
+
+void CalibrationScheduler::run()
+{
+    producer_thread = boost::thread(&CalibrationScheduler::producer_cent_proto, this);
+    ThreadScheduling::getInstance().apply(producer_thread, ThreadRole::RX, "calib_scheduler.producer");
+}
+
+void CalibrationScheduler::stop()
+{
+    for (auto &session : sessions)
+        session.flags |= FLAG_END;
+    leaf_events.interrupt();
+}
+
+bool CalibrationScheduler::wait_calibration_end(const std::chrono::milliseconds &timeout)
+{
+    return routine_flags.wait_any(1, Deadline(timeout)) != 0;
+}
+
+void CalibrationScheduler::on_leaf_flag(const std::string &topic, const std::string &payload)
+{
+    auto it = slot_of_leaf.find(topic.substr(flag_topic_prefix.size()));
+    if (it == slot_of_leaf.end())
+        return; // leaf of another session
+
+    std::string flag_value;
+    if (not MQTTClient::payload_value(payload, flag_value))
+    {
+        LOG_WARN("MQTT >> Flag message without valid value.");
+        return;
+    }
+
+    LeafSession &session = sessions[it->second];
+    if (flag_value == "recv")
+        session.flags |= FLAG_RECV;
+    else if (flag_value == "retx")
+        session.flags |= FLAG_RETX;
+    else if (flag_value == "end")
+        session.flags |= FLAG_END;
+    else
+    {
+        LOG_WARN_FMT("MQTT >> Flag %1% of leaf %2% does not match any.", flag_value, session.leaf_id);
+        return;
+    }
+    leaf_events.set(1);
+}
+
+// returns once every active leaf asked for the next REF (or ended), or at the deadline
+void CalibrationScheduler::wait_for_leafs(const Deadline &deadline)
+{
+    while (not signal_stop_called)
+    {
+        leaf_events.clear(1);
+        bool all_ready = true;
+        for (const auto &session : sessions)
+            if (not session.done and not(session.flags & (FLAG_RETX | FLAG_END)))
+                all_ready = false;
+
+        if (all_ready or deadline.expired())
+            return;
+        leaf_events.wait_any(1, deadline);
+    }
+}
+
+void CalibrationScheduler::producer_cent_proto()
+{
+    float usrp_noise_power = usrp_obj->init_noise_ampl * usrp_obj->init_noise_ampl;
+    size_t N_zfc = config->ref_n_zfc;
+    size_t ref_pad_len = config->ref_padding_mul * N_zfc;
+    double first_sample_gap = ref_pad_len / usrp_obj->rx_rate;
+    double wait_duration = first_sample_gap + (config->start_tx_wait_microsec / 1e6);
+    size_t otac_wf_len = config->test_signal_len;
+    size_t slot_len = Calibration::response_slot_len(*config);
+    WindowPowerEngine engine(otac_wf_len);
+
+    MQTTClient &mqttClient = MQTTClient::getInstance(cent_id);
+    int64_t start_ns = LatencyProbes::now_ns();
+    size_t round = 0;
+
+    LOG_INFO_FMT("Calibrating %1% leafs with one REF per round, %2% samples per response slot", sessions.size(), slot_len);
+
+    while (not signal_stop_called && round++ < max_total_round)
+    {
+        // leaf turnaround -- leafs that asked for a retransmission start the next round right away
+        if (round > 1)
+            wait_for_leafs(Deadline(std::chrono::milliseconds(config->calib_round_gap_ms)));
+
+        size_t num_slots = 0;
+        for (size_t slot = 0; slot < sessions.size(); ++slot)
+        {
+            LeafSession &session = sessions[slot];
+            uint32_t flags = session.flags.exchange(0);
+            if (flags & FLAG_END and not session.done)
+            {
+                session.done = true;
+                LOG_INFO_FMT("Leaf %1% finished calibration after %2% responses.", session.leaf_id, session.responses);
+            }
+            if (not session.done)
+                num_slots = slot + 1; // capture up to the last active slot
+        }
+        if (num_slots == 0)
+            break;
+
+        LOG_INFO_FMT("-------------- Round %1% ------------", round);
+        int64_t round_start_ns = LatencyProbes::now_ns();
+
+        // Transmit REF
+        uhd::time_spec_t tx_timer = usrp_obj->usrp->get_time_now() + uhd::time_spec_t(10e-3);
+        if (not usrp_obj->transmission(ref_waveform, tx_timer, signal_stop_called, true))
+        {
+            LOG_WARN("REF transmission failed!");
+            continue;
+        }
+
+        // answers of all leafs, slot after slot
+        uhd::time_spec_t otac_timer = tx_timer + uhd::time_spec_t(wait_duration);
+        size_t req_num_samps = num_slots * slot_len;
+        auto rx_samps = usrp_obj->reception(signal_stop_called, req_num_samps, 0.0, otac_timer, true);
+        if (rx_samps.size() != req_num_samps)
+        {
+            LOG_WARN("Reception failed!");
+            continue;
+        }
+
+        for (size_t slot = 0; slot < num_slots; ++slot)
+        {
+            LeafSession &session = sessions[slot];
+            if (session.done)
+                continue;
+
+            auto result = engine.process(rx_samps.data() + slot * slot_len, slot_len, 10 * usrp_noise_power, window_prefix);
+            if (result.max_power < 10 * usrp_noise_power)
+            {
+                session.missed++;
+                LOG_WARN_FMT("Leaf %1% : estimated OTAC signal power = %2% .. is too low!", session.leaf_id, std::max(result.max_power, 0.0f));
+                continue;
+            }
+
+            float txrx_gap = (result.max_index / usrp_obj->rx_rate) * 1e6 - (otac_wf_len / usrp_obj->rx_rate) * 1e6;
+            if (txrx_gap > config->start_tx_wait_microsec + 200)
+            {
+                session.missed++;
+                LOG_WARN_FMT("Leaf %1% : OTAC signal reception delay %2% microsecs is too big -> Reject this data.", session.leaf_id, txrx_gap);
+                continue;
+            }
+
+            session.ltoc = result.max_power;
+            session.responses++;
+            LOG_INFO_FMT("Leaf %1% : OTAC ltoc = %2%, synchronization gap = %3% microsecs", session.leaf_id, session.ltoc / min_e2e_pow, txrx_gap);
+            mqttClient.publish(session.ltoc_topic, mqttClient.timestamp_float_data(session.ltoc / min_e2e_pow), false);
+        }
+        LATENCY_RECORD_SINCE("calib.sched_round", round_start_ns);
+    }
+
+    report_sessions((LatencyProbes::now_ns() - start_ns) / 1e9);
+    calibration_ends = true;
+    routine_flags.set(1);
+}
+
+void CalibrationScheduler::report_sessions(const double &elapsed)
+{
+    size_t num_done = 0;
+    for (const auto &session : sessions)
+    {
+        num_done += session.done;
+        LOG_INFO_FMT("Leaf %1% : %2% -- %3% responses, %4% missed, last ltoc = %5%", session.leaf_id, (session.done ? "calibrated" : "not finished"), session.responses, session.missed, session.ltoc);
+    }
+    LOG_INFO_FMT("Calibration of %1%/%2% leafs finished in %3% secs.", num_done, sessions.size(), elapsed);
+}
@@ -0,0 +1,387 @@
+#include "channel_emulator.hpp"
+
+static uint64_t splitmix64_next(uint64_t &x)
+{
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t rotl(const uint64_t &x, const int &k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static double sinc(const double &x)
+{
+    if (std::abs(x) < 1e-12)
+        return 1.0;
+    return std::sin(M_PI * x) / (M_PI * x);
+}
+
+// complex multiply-accumulate on interleaved floats, acc[i] += tap * src[i] -- vectorizes unlike std::complex
+static void complex_mac(float *acc, const float *src, const sample_type &tap, const size_t &num_samples)
+{
+    const float tr = tap.real(), ti = tap.imag();
+    for (size_t i = 0; i < 2 * num_samples; i += 2)
+    {
+        acc[i] += tr * src[i] - ti * src[i + 1];
+        acc[i + 1] += tr * src[i + 1] + ti * src[i];
+    }
+}
+
+/*----------------- GaussianRng -----------------*/
+
+GaussianRng::GaussianRng(const uint64_t &seed_val)
+{
+    seed(seed_val);
+}
+
+void GaussianRng::seed(const uint64_t &seed_val)
+{
+    uint64_t x = seed_val;
+    for (auto &s : state)
+        s = splitmix64_next(x);
+    has_spare = false;
+}
+
+uint64_t GaussianRng::next_bits()
+{
+    const uint64_t result = rotl(state[1] * 5, 7) * 9;
+    const uint64_t t = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = rotl(state[3], 45);
+    return result;
+}
+
+const std::vector<float> &GaussianRng::quantile_table()
+{
+    static const std::vector<float> table = []
+    {
+        const size_t table_len = 4096;
+        std::vector<double> quantiles(table_len);
+        double var = 0.0;
+        for (size_t i = 0; i < table_len; ++i)
+        {
+            // inverse of the normal CDF at the bin center, by bisection
+            double p = (i + 0.5) / table_len, lo = -10.0, hi = 10.0;
+            for (int iter = 0; iter < 64; ++iter)
+            {
+                double mid = 0.5 * (lo + hi);
+                if (0.5 * std::erfc(-mid / M_SQRT2) < p)
+                    lo = mid;
+                else
+                    hi = mid;
+            }
+            quantiles[i] = 0.5 * (lo + hi);
+            var += quantiles[i] * quantiles[i] / table_len;
+        }
+
+        // the sum of two entries has unit variance
+        std::vector<float> scaled(table_len);
+        for (size_t i = 0; i < table_len; ++i)
+            scaled[i] = quantiles[i] / std::sqrt(2 * var);
+        return scaled;
+    }();
+    return table;
+}
+
+float GaussianRng::next()
+{
+    if (has_spare)
+    {
+        has_spare = false;
+        return spare;
+    }
+    const float *table = quantile_table().data();
+    uint64_t bits = next_bits();
+    spare = table[(bits >> 28) & 0xfff] + table[(bits >> 16) & 0xfff];
+    has_spare = true;
+    return table[bits >> 52] + table[(bits >> 40) & 0xfff];
+}
+
+// the same sequence as `num_vals` calls of next(), whatever the split into calls
+void GaussianRng::fill(float *out, const size_t &num_vals, const float &std_dev)
+{
+    const float *table = quantile_table().data();
+    size_t i = 0;
+    if (has_spare and num_vals > 0)
+        out[i++] = std_dev * next();
+    for (; i + 2 <= num_vals; i += 2)
+    {
+        uint64_t bits = next_bits();
+        out[i] = std_dev * (table[bits >> 52] + table[(bits >> 40) & 0xfff]);
+        out[i + 1] = std_dev * (table[(bits >> 28) & 0xfff] + table[(bits >> 16) & 0xfff]);
+    }
+    if (i < num_vals)
+        out[i] = std_dev * next();
+}
+
+void GaussianRng::add_noise(sample_type *samples, const size_t &num_samples, const float &noise_power)
+{
+    const float *table = quantile_table().data();
+    const float std_dev = std::sqrt(noise_power / 2);
+    float *vals = reinterpret_cast<float *>(samples);
+    for (size_t i = 0; i < 2 * num_samples; i += 2)
+    {
+        uint64_t bits = next_bits();
+        vals[i] += std_dev * (table[bits >> 52] + table[(bits >> 40) & 0xfff]);
+        vals[i + 1] += std_dev * (table[(bits >> 28) & 0xfff] + table[(bits >> 16) & 0xfff]);
+    }
+}
+
+/*----------------- ChannelLink -----------------*/
+
+ChannelLink::ChannelLink() : fir(1, sample_type(1.0)), cfo_steps(cfo_block, sample_type(1.0))
+{
+    pn_increments.resize(cfo_block);
+    block_rot.resize(cfo_block);
+}
+
+// phase p holds the taps of a delay of p / interp_phases samples, tap m acts at integer delay m - (interp_taps / 2 - 1)
+const std::vector<float> &ChannelLink::interp_bank()
+{
+    static const std::vector<float> bank = []
+    {
+        const int lobes = interp_taps / 2;
+        std::vector<float> taps(interp_phases * interp_taps);
+        for (int p = 0; p < interp_phases; ++p)
+        {
+            double frac = double(p) / interp_phases, tap_sum = 0.0;
+            std::vector<double> lanczos(interp_taps);
+            for (int m = 0; m < interp_taps; ++m)
+            {
+                double x = (m - lobes + 1) - frac;
+                lanczos[m] = sinc(x) * sinc(x / lobes);
+                tap_sum += lanczos[m];
+            }
+            for (int m = 0; m < interp_taps; ++m)
+                taps[p * interp_taps + m] = lanczos[m] / tap_sum; // unit DC gain
+        }
+        return taps;
+    }();
+    return bank;
+}
+
+void ChannelLink::set_paths(const std::vector<Path> &paths)
+{
+    const int lead = interp_taps / 2 - 1;
+    const float *bank = interp_bank().data();
+
+    std::map<long, sample_type> taps;
+    for (const auto &path : paths)
+    {
+        if (path.delay < 0.0)
+        {
+            LOG_WARN_FMT("Channel path delay %1% is negative, path is ignored.", path.delay);
+            continue;
+        }
+        long int_delay = long(std::floor(path.delay));
+        long phase = std::lround((path.delay - int_delay) * interp_phases);
+        if (phase == interp_phases)
+        {
+            int_delay++;
+            phase = 0;
+        }
+        for (int m = 0; m < interp_taps; ++m)
+        {
+            long n = int_delay + m - lead;
+            float tap = bank[phase * interp_taps + m];
+            if (n >= 0 and tap != 0.0f) // precursor taps of delays below `lead` samples are cut
+                taps[n] += path.gain * tap;
+        }
+    }
+
+    if (taps.empty())
+    {
+        fir.assign(1, sample_type(0.0));
+        fir_start = 0;
+    }
+    else
+    {
+        fir_start = taps.begin()->first;
+        fir.assign(taps.rbegin()->first - fir_start + 1, sample_type(0.0));
+        for (const auto &tap : taps)
+            fir[tap.first - fir_start] = tap.second;
+    }
+    resize_history(fir_start + fir.size() - 1);
+}
+
+// keeps the most recent input samples
+void ChannelLink::resize_history(const size_t &new_len)
+{
+    if (new_len > history.size())
+        history.insert(history.begin(), new_len - history.size(), sample_type(0.0));
+    else
+        history.erase(history.begin(), history.begin() + (history.size() - new_len));
+    history_len = new_len;
+}
+
+void ChannelLink::set_cfo(const double &cfo_hz, const double &sample_rate)
+{
+    cfo_omega = 2 * M_PI * cfo_hz / sample_rate;
+    for (size_t k = 0; k < cfo_block; ++k)
+        cfo_steps[k] = sample_type(std::polar(1.0, cfo_omega * k));
+}
+
+void ChannelLink::set_phase_noise(const double &linewidth_hz, const double &sample_rate, const uint64_t &seed)
+{
+    pn_std = std::sqrt(2 * M_PI * linewidth_hz / sample_rate);
+    pn_seed = seed;
+    pn_rng.seed(pn_seed);
+}
+
+void ChannelLink::reset()
+{
+    std::fill(history.begin(), history.end(), sample_type(0.0));
+    cfo_phase = 0.0;
+    pn_rot = sample_type(1.0);
+    pn_rng.seed(pn_seed);
+}
+
+void ChannelLink::process(const sample_type *in, const size_t &num_samples, sample_type *out)
+{
+    // a single path at an integer delay of zero is a gain -- no filtering, no copies
+    if (history_len == 0 and fir.size() == 1)
+    {
+        rotate_accumulate(in, fir[0], num_samples, out);
+        return;
+    }
+
+    extended.resize(history_len + num_samples);
+    std::copy(history.begin(), history.end(), extended.begin());
+    std::copy(in, in + num_samples, extended.begin() + history_len);
+
+    filtered.assign(num_samples, sample_type(0.0));
+    float *acc = reinterpret_cast<float *>(filtered.data());
+    const sample_type *newest = extended.data() + history_len - fir_start; // in[i - fir_start] at newest[i]
+    for (size_t j = 0; j < fir.size(); ++j)
+        if (fir[j] != sample_type(0.0))
+            complex_mac(acc, reinterpret_cast<const float *>(newest - j), fir[j], num_samples);
+
+    std::copy(extended.end() - history_len, extended.end(), history.begin());
+
+    rotate_accumulate(filtered.data(), sample_type(1.0), num_samples, out);
+}
+
+// out[i] += gain * e^{j(cfo phase + phase noise)} * in[i]
+void ChannelLink::rotate_accumulate(const sample_type *in, const sample_type &gain, const size_t &num_samples, sample_type *out)
+{
+    if (cfo_omega == 0.0 and pn_std == 0.0)
+    {
+        complex_mac(reinterpret_cast<float *>(out), reinterpret_cast<const float *>(in), gain, num_samples);
+        return;
+    }
+
+    const float *src = reinterpret_cast<const float *>(in);
+    float *dst = reinterpret_cast<float *>(out);
+    const float *rot = reinterpret_cast<const float *>(block_rot.data());
+    for (size_t start = 0; start < num_samples; start += cfo_block)
+    {
+        size_t len = std::min(cfo_block, num_samples - start);
+
+        // phase at the block start from the double accumulator, no drift of the recursive phasor
+        sample_type base = gain * std::polar(1.0f, float(cfo_phase));
+        cfo_phase = std::fmod(cfo_phase + cfo_omega * len, 2 * M_PI);
+
+        if (pn_std > 0.0)
+        {
+            pn_rng.fill(pn_increments.data(), len, pn_std);
+            for (size_t k = 0; k < len; ++k)
+            {
+                float d = pn_increments[k];
+                pn_rot *= sample_type(1.0f - 0.5f * d * d, d); // e^{jd} up to O(d^3)
+                block_rot[k] = base * cfo_steps[k] * pn_rot;
+            }
+            pn_rot /= std::abs(pn_rot);
+        }
+        else
+        {
+            const float br = base.real(), bi = base.imag();
+            const float *steps = reinterpret_cast<const float *>(cfo_steps.data());
+            float *rot_out = reinterpret_cast<float *>(block_rot.data());
+            for (size_t k = 0; k < 2 * len; k += 2)
+            {
+                rot_out[k] = br * steps[k] - bi * steps[k + 1];
+                rot_out[k + 1] = br * steps[k + 1] + bi * steps[k];
+            }
+        }
+
+        const float *block_in = src + 2 * start;
+        float *block_out = dst + 2 * start;
+        for (size_t i = 0; i < 2 * len; i += 2)
+        {
+            block_out[i] += block_in[i] * rot[i] - block_in[i + 1] * rot[i + 1];
+            block_out[i + 1] += block_in[i] * rot[i + 1] + block_in[i + 1] * rot[i];
+        }
+    }
+}
+
+/*----------------- ChannelEmulator -----------------*/
+
+ChannelEmulator::ChannelEmulator(const double &sample_rate, const uint64_t &seed) : rate(sample_rate), base_seed(seed), noise_rng(seed)
+{
+}
+
+size_t ChannelEmulator::add_link()
+{
+    links.emplace_back();
+    return links.size() - 1;
+}
+
+bool ChannelEmulator::process(const std::vector<const sample_type *> &inputs, const size_t &num_samples, sample_type *out)
+{
+    if (inputs.size() != links.size())
+    {
+        LOG_WARN_FMT("Channel emulator has %1% links but got %2% input blocks.", links.size(), inputs.size());
+        return false;
+    }
+
+    std::fill(out, out + num_samples, sample_type(0.0));
+    for (size_t l = 0; l < links.size(); ++l)
+    {
+        const sample_type *in = inputs[l];
+        if (in == nullptr)
+        {
+            // silent transmitters still advance the filter history of their link
+            if (silence.size() < num_samples)
+                silence.resize(num_samples, sample_type(0.0));
+            in = silence.data();
+        }
+        links[l].process(in, num_samples, out);
+    }
+
+    if (noise_power > 0.0)
+        noise_rng.add_noise(out, num_samples, noise_power);
+    return true;
+}
+
+bool ChannelEmulator::process(const std::vector<std::vector<sample_type>> &inputs, std::vector<sample_type> &out)
+{
+    size_t num_samples = inputs.empty() ? 0 : inputs[0].size();
+    std::vector<const sample_type *> blocks;
+    for (const auto &input : inputs)
+    {
+        if (input.size() != num_samples)
+        {
+            LOG_WARN("Channel emulator input blocks differ in length.");
+            return false;
+        }
+        blocks.push_back(input.data());
+    }
+
+    out.resize(num_samples);
+    return process(blocks, num_samples, out.data());
+}
+
+void ChannelEmulator::reset()
+{
+    for (auto &link : links)
+        link.reset();
+    noise_rng.seed(base_seed);
+}
@@ -0,0 +1,261 @@
+#include "config.hpp"
+#include "thread_sched.hpp"
+#include <numeric>
+
+static void report_missing(const std::string &key, const bool &required, std::vector<std::string> &errors)
+{
+    if (required)
+        errors.emplace_back("missing required key '" + key + "'");
+}
+
+static void report_type(const ConfigParser &parser, const std::string &key, const std::string &expected, std::vector<std::string> &errors)
+{
+    errors.emplace_back("key '" + key + "' must be of type " + expected + " (found " + parser.type_of(key) + ")");
+}
+
+static void read_field(const ConfigParser &parser, const std::string &key, const bool &required, std::string &out, std::vector<std::string> &errors)
+{
+    if (parser.try_get(key, out))
+        return;
+    if (parser.type_of(key) == "")
+        report_missing(key, required, errors);
+    else
+        report_type(parser, key, "str", errors);
+}
+
+static void read_field(const ConfigParser &parser, const std::string &key, const bool &required, size_t &out, std::vector<std::string> &errors)
+{
+    if (parser.try_get(key, out))
+        return;
+    if (parser.type_of(key) == "")
+        report_missing(key, required, errors);
+    else
+        report_type(parser, key, "int", errors);
+}
+
+static void read_field(const ConfigParser &parser, const std::string &key, const bool &required, float &out, std::vector<std::string> &errors)
+{
+    if (parser.try_get(key, out))
+        return;
+
+    // integers are accepted where floats are expected
+    size_t int_val;
+    if (parser.try_get(key, int_val))
+    {
+        out = float(int_val);
+        return;
+    }
+
+    if (parser.type_of(key) == "")
+        report_missing(key, required, errors);
+    else
+        report_type(parser, key, "float", errors);
+}
+
+static void read_field(const ConfigParser &parser, const std::string &key, const bool &required, bool &out, std::vector<std::string> &errors)
+{
+    std::string str_val;
+    if (parser.try_get(key, str_val))
+    {
+        if (str_val == "true")
+            out = true;
+        else if (str_val == "false")
+            out = false;
+        else
+            errors.emplace_back("key '" + key + "' must be 'true' or 'false' (found '" + str_val + "')");
+        return;
+    }
+
+    if (parser.type_of(key) == "")
+        report_missing(key, required, errors);
+    else
+        report_type(parser, key, "str (true/false)", errors);
+}
+
+std::shared_ptr<const Config> Config::from_parser(const ConfigParser &parser)
+{
+    auto config = std::make_shared<Config>();
+    std::vector<std::string> errors;
+
+#define CONFIG_REQUIRED(field, key, type, desc) read_field(parser, key, true, config->field, errors);
+#define CONFIG_OPTIONAL(field, key, type, def, desc) read_field(parser, key, false, config->field, errors);
+#include "config_schema.def"
+#undef CONFIG_REQUIRED
+#undef CONFIG_OPTIONAL
+
+    config->validate(errors);
+
+    if (!errors.empty())
+    {
+        for (const auto &err : errors)
+            LOG_WARN_FMT("Config error: %1%", err);
+        LOG_ERROR_FMT("Invalid configuration -- %1% error(s) found.", errors.size());
+    }
+
+    return config;
+}
+
+std::shared_ptr<const Config> Config::with(const std::function<void(Config &)> &modifier) const
+{
+    auto config = std::make_shared<Config>(*this);
+    modifier(*config);
+
+    std::vector<std::string> errors;
+    config->validate(errors);
+    if (!errors.empty())
+    {
+        for (const auto &err : errors)
+            LOG_WARN_FMT("Config error: %1%", err);
+        LOG_ERROR_FMT("Invalid configuration -- %1% error(s) found.", errors.size());
+    }
+
+    return config;
+}
+
+void Config::validate(std::vector<std::string> &errors) const
+{
+    if (rate <= 0.0)
+        errors.emplace_back("'rate' must be positive");
+    if (master_clock_rate <= 0.0)
+        errors.emplace_back("'master-clock-rate' must be positive");
+    if (gain_mgmt != "gain" && gain_mgmt != "power")
+        errors.emplace_back("'gain-mgmt' must be 'gain' or 'power'");
+    if (capacity_pow == 0 || capacity_pow > 30)
+        errors.emplace_back("'capacity-pow' must be in [1, 30]");
+    if (ref_n_zfc == 0 || ref_r_zfc == 0)
+        errors.emplace_back("'Ref-N-zfc' and 'Ref-R-zfc' must be non-zero");
+    if (ref_m_zfc >= ref_n_zfc)
+        errors.emplace_back("'Ref-m-zfc' must be smaller than 'Ref-N-zfc'");
+    if (corr_seq_len_mul == 0)
+        errors.emplace_back("'corr-seq-len-mul' must be non-zero");
+    if (csd_max_batch_blocks == 0)
+        errors.emplace_back("'csd-max-batch-blocks' must be non-zero");
+    if (csd_energy_gate_db < 0.0)
+        errors.emplace_back("'csd-energy-gate-db' must not be negative");
+    if (cfar_mode != "none" && cfar_mode != "ca" && cfar_mode != "os")
+        errors.emplace_back("'cfar-mode' must be 'none', 'ca' or 'os'");
+    if (cfar_pfa <= 0.0 || cfar_pfa >= 1.0)
+        errors.emplace_back("'cfar-pfa' must be in (0, 1)");
+    if (cfar_train_cells == 0)
+        errors.emplace_back("'cfar-train-cells' must be non-zero");
+    if (cfar_train_cells + cfar_guard_cells >= ref_n_zfc)
+        errors.emplace_back("'cfar-train-cells' + 'cfar-guard-cells' must be smaller than 'Ref-N-zfc' (REF peaks would be training cells)");
+    if (cpu_format != "fc32" && cpu_format != "sc16")
+        errors.emplace_back("'cpu-format' must be 'fc32' or 'sc16'");
+    if (num_fft_threads == 0)
+        errors.emplace_back("'num-FFT-threads' must be non-zero");
+    if (min_e2e_amp > max_e2e_amp)
+        errors.emplace_back("'min-e2e-amp' must not exceed 'max-e2e-amp'");
+    if (otac_round_guard_microsec < 0.0)
+        errors.emplace_back("'otac-round-guard-microsec' must not be negative");
+    if (mqtt_broker.find("://") == std::string::npos)
+        errors.emplace_back("'mqtt-broker' must be a URI such as tcp://host:port or loopback://name");
+    if (mqtt_payload_format != "json" && mqtt_payload_format != "cbor")
+        errors.emplace_back("'mqtt-payload-format' must be 'json' or 'cbor'");
+    if (max_rx_packet_size != 0 && (size_t(1) << capacity_pow) <= max_rx_packet_size)
+        errors.emplace_back("buffer capacity 2^capacity-pow must be greater than 'max-rx-packet-size'");
+    if (rx_combining != "selection" && rx_combining != "snr_weighted")
+        errors.emplace_back("'rx-combining' must be 'selection' or 'snr_weighted'");
+
+    std::vector<size_t> channels;
+    try
+    {
+        channels = rx_channel_list();
+    }
+    catch (const boost::bad_lexical_cast &)
+    {
+        errors.emplace_back("'rx-channels' must be a comma-separated list of channel numbers");
+    }
+    std::sort(channels.begin(), channels.end());
+    if (channels.empty() || std::adjacent_find(channels.begin(), channels.end()) != channels.end())
+        errors.emplace_back("'rx-channels' must list at least one channel, each only once");
+
+    for (const auto &[key, spec] : {std::make_pair("sched-rx", sched_rx), std::make_pair("sched-dsp", sched_dsp), std::make_pair("sched-detect", sched_detect), std::make_pair("sched-tx", sched_tx),
+                                    std::make_pair("sched-control", sched_control), std::make_pair("sched-io", sched_io)})
+    {
+        ThreadRoleSched role_sched;
+        std::string error;
+        if (!ThreadRoleSched::parse(spec, role_sched, error))
+            errors.emplace_back("'" + std::string(key) + "': " + error);
+    }
+
+    std::vector<size_t> roots;
+    try
+    {
+        roots = ref_zfc_roots();
+    }
+    catch (const boost::bad_lexical_cast &)
+    {
+        errors.emplace_back("'Ref-extra-m-zfc' must be a comma-separated list of ZFC roots");
+    }
+    for (const auto &root : roots)
+        if (root == 0 || root >= ref_n_zfc || std::gcd(root, ref_n_zfc) != 1)
+            errors.emplace_back("ZFC roots must be in [1, Ref-N-zfc) and coprime with 'Ref-N-zfc', got " + std::to_string(root));
+    std::sort(roots.begin(), roots.end());
+    if (std::adjacent_find(roots.begin(), roots.end()) != roots.end())
+        errors.emplace_back("'Ref-extra-m-zfc' must not repeat a root or 'Ref-m-zfc'");
+}
+
+// comma-separated non-negative integers, empty items are skipped
+static std::vector<size_t> parse_index_list(const std::string &list)
+{
+    std::vector<std::string> items;
+    boost::split(items, list, boost::is_any_of(","));
+    std::vector<size_t> indices;
+    for (const auto &item : items)
+    {
+        std::string trimmed = boost::trim_copy(item);
+        if (!trimmed.empty())
+            indices.push_back(boost::lexical_cast<size_t>(trimmed));
+    }
+    return indices;
+}
+
+std::vector<size_t> Config::rx_channel_list() const
+{
+    return parse_index_list(rx_channels);
+}
+
+std::vector<size_t> Config::ref_zfc_roots() const
+{
+    std::vector<size_t> roots = {ref_m_zfc};
+    auto extra_roots = parse_index_list(ref_extra_m_zfc);
+    roots.insert(roots.end(), extra_roots.begin(), extra_roots.end());
+    return roots;
+}
+
+template <typename T>
+static std::string value_to_string(const T &val)
+{
+    std::ostringstream oss;
+    oss << val;
+    return oss.str();
+}
+
+static std::string value_to_string(const bool &val)
+{
+    return val ? "true" : "false";
+}
+
+void Config::print_values() const
+{
+    LOG_INFO("Config Values:");
+#define CONFIG_PRINT(field, key, desc) LOG_INFO(boost::str(boost::format("%1% %2% %3%") % boost::io::group(std::left, std::setw(30), key) % boost::io::group(std::left, std::setw(10), value_to_string(field)) % boost::io::group(std::left, std::setw(80), desc)));
+#define CONFIG_REQUIRED(field, key, type, desc) CONFIG_PRINT(field, key, desc)
+#define CONFIG_OPTIONAL(field, key, type, def, desc) CONFIG_PRINT(field, key, desc)
+#include "config_schema.def"
+#undef CONFIG_REQUIRED
+#undef CONFIG_OPTIONAL
+#undef CONFIG_PRINT
+}
+
+json Config::to_json() const
+{
+    json json_data = json::object();
+#define CONFIG_REQUIRED(field, key, type, desc) json_data[key] = field;
+#define CONFIG_OPTIONAL(field, key, type, def, desc) json_data[key] = field;
+#include "config_schema.def"
+#undef CONFIG_REQUIRED
+#undef CONFIG_OPTIONAL
+    return json_data;
+}
@@ -98,6 +98,44 @@ float ConfigParser::getValue_float(const std::string &varName)
     return float();
 }
 
+bool ConfigParser::try_get(const std::string &varName, std::string &value) const
+{
+    auto it = string_data.find(varName);
+    if (it == string_data.end())
+        return false;
+    value = it->second;
+    return true;
+}
+
+bool ConfigParser::try_get(const std::string &varName, size_t &value) const
+{
+    auto it = int_data.find(varName);
+    if (it == int_data.end())
+        return false;
+    value = it->second;
+    return true;
+}
+
+bool ConfigParser::try_get(const std::string &varName, float &value) const
+{
+    auto it = float_data.find(varName);
+    if (it == float_data.end())
+        return false;
+    value = it->second;
+    return true;
+}
+
+std::string ConfigParser::type_of(const std::string &varName) const
+{
+    if (string_data.count(varName))
+        return "str";
+    if (int_data.count(varName))
+        return "int";
+    if (float_data.count(varName))
+        return "float";
+    return "";
+}
+
 void ConfigParser::set_value(const std::string &varname, const std::string &varval, const std::string &vartype, const std::string &desc)
 {
     if (vartype == "str" or vartype == "string")
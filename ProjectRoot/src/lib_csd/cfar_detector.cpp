@@ -0,0 +1,123 @@
+#include "cfar_detector.hpp"
+
+CfarMode parse_cfar_mode(const std::string &name)
+{
+    if (name == "ca")
+        return CfarMode::CA;
+    if (name == "os")
+        return CfarMode::OS;
+    return CfarMode::NONE;
+}
+
+CfarDetector::CfarDetector(const CfarMode &mode, const size_t &train_cells, const size_t &guard_cells, const double &pfa)
+    : cfar_mode(mode), train(train_cells), guard(guard_cells), reach(train_cells + guard_cells)
+{
+    if (train == 0)
+        LOG_ERROR("CFAR needs at least one training cell on each side.");
+
+    scales.assign(2 * train + 1, 0.0);
+    for (size_t n = 1; n <= 2 * train; ++n)
+        scales[n] = cfar_mode == CfarMode::OS ? os_scale(n, os_order(n), pfa) : ca_scale(n, pfa);
+}
+
+// Pfa = (1 + scale / n)^-n for the mean of n exponential cells
+double CfarDetector::ca_scale(const size_t &num_cells, const double &pfa)
+{
+    return num_cells * (std::pow(pfa, -1.0 / num_cells) - 1.0);
+}
+
+// Pfa = prod_{i<k} (n - i) / (n - i + scale) for the k-th smallest of n exponential cells, solved by bisection
+double CfarDetector::os_scale(const size_t &num_cells, const size_t &order, const double &pfa)
+{
+    auto false_alarm_rate = [&](const double &scale)
+    {
+        double rate = 1.0;
+        for (size_t i = 0; i < order; ++i)
+            rate *= double(num_cells - i) / (num_cells - i + scale);
+        return rate;
+    };
+
+    double low = 0.0, high = 1.0;
+    while (false_alarm_rate(high) > pfa and high < 1e12)
+        high *= 2;
+    for (int iter = 0; iter < 100; ++iter)
+    {
+        double mid = 0.5 * (low + high);
+        if (false_alarm_rate(mid) > pfa)
+            low = mid;
+        else
+            high = mid;
+    }
+    return high;
+}
+
+void CfarDetector::process(const std::complex<float> *corr, const size_t &num_lags)
+{
+    // the last lags of the previous block are training cells of this one
+    history_len = std::min(reach, cells.size());
+    std::copy(cells.end() - history_len, cells.end(), cells.begin());
+
+    const size_t total = history_len + num_lags;
+    cells.resize(total);
+    lag_thresholds.resize(num_lags);
+
+    // |corr|^2 over the interleaved floats -- no dependencies, vectorized by the compiler
+    const float *vals = reinterpret_cast<const float *>(corr);
+    float *block_cells = cells.data() + history_len;
+    for (size_t i = 0; i < num_lags; ++i)
+        block_cells[i] = vals[2 * i] * vals[2 * i] + vals[2 * i + 1] * vals[2 * i + 1];
+
+    if (cfar_mode == CfarMode::CA)
+    {
+        // window sums from double prefix sums, as in WindowPowerEngine
+        prefix.resize(total + 1);
+        prefix[0] = 0.0;
+        for (size_t p = 0; p < total; ++p)
+            prefix[p + 1] = prefix[p] + cells[p];
+    }
+
+    for (size_t i = 0; i < num_lags; ++i)
+    {
+        const size_t p = history_len + i;
+        // lagging cells [lag_begin, lag_end), leading cells [lead_begin, lead_end)
+        const size_t lag_begin = p >= reach ? p - reach : 0;
+        const size_t lag_end = p >= guard ? p - guard : 0;
+        const size_t lead_begin = std::min(p + guard + 1, total);
+        const size_t lead_end = std::min(p + reach + 1, total);
+        const size_t num_cells = (lag_end - lag_begin) + (lead_end - lead_begin);
+
+        if (num_cells == 0)
+        {
+            lag_thresholds[i] = std::numeric_limits<float>::max();
+            continue;
+        }
+
+        if (cfar_mode == CfarMode::OS)
+        {
+            window.assign(cells.begin() + lag_begin, cells.begin() + lag_end);
+            window.insert(window.end(), cells.begin() + lead_begin, cells.begin() + lead_end);
+            auto order_it = window.begin() + (os_order(num_cells) - 1);
+            std::nth_element(window.begin(), order_it, window.end());
+            lag_thresholds[i] = scales[num_cells] * *order_it;
+        }
+        else
+        {
+            double sum = (prefix[lag_end] - prefix[lag_begin]) + (prefix[lead_end] - prefix[lead_begin]);
+            lag_thresholds[i] = scales[num_cells] * sum / num_cells;
+        }
+    }
+
+    // noise power of the block without the detections
+    double noise_sum = 0.0;
+    size_t noise_count = 0;
+    for (size_t i = 0; i < num_lags; ++i)
+    {
+        if (block_cells[i] <= lag_thresholds[i])
+        {
+            noise_sum += block_cells[i];
+            noise_count++;
+        }
+    }
+    if (noise_count > 0)
+        block_noise_power = noise_sum / noise_count;
+}
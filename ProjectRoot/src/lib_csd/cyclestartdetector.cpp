@@ -1,30 +1,38 @@
 #include "cyclestartdetector.hpp"
 
+static size_t packet_arrivals_capacity = 1024;
+
 CycleStartDetector::CycleStartDetector(
-    ConfigParser &parser,
+    std::shared_ptr<const Config> config,
     size_t &capacity,
     const uhd::time_spec_t &rx_sample_duration,
-    PeakDetectionClass &peak_det_obj) : parser(parser),
-                                        synced_buffer(capacity),
+    const double &master_clock_rate,
+    PeakDetectionClass &peak_det_obj,
+    const CycleStartDetector *plan_source) : config(config),
                                         rx_sample_duration(rx_sample_duration),
                                         peak_det_obj_ref(peak_det_obj),
-                                        samples_buffer(),
+                                        block_overlap(),
                                         timer(),
                                         fftw_wrapper(),
                                         cfo(0.0),
                                         cfo_counter(0),
-                                        calibration_ratio(1.0)
+                                        calibration_ratio(1.0),
+                                        packet_arrivals(packet_arrivals_capacity)
 {
     prev_timer = uhd::time_spec_t(0.0);
-    N_zfc = parser.getValue_int("Ref-N-zfc");
-    m_zfc = parser.getValue_int("Ref-m-zfc");
-    R_zfc = parser.getValue_int("Ref-R-zfc");
+    N_zfc = config->ref_n_zfc;
+
+    sample_clock = SampleClock(master_clock_rate, 1.0 / rx_sample_duration.get_real_secs());
+    peak_det_obj_ref.sample_clock = sample_clock;
+
+    m_zfc = config->ref_m_zfc;
+    R_zfc = config->ref_r_zfc;
 
-    tx_wait_microsec = parser.getValue_float("start-tx-wait-microsec");
+    tx_wait_microsec = config->start_tx_wait_microsec;
 
     // get saved CFO
     float read_cfo;
-    bool get_cfo_success = readDeviceConfig(parser.getValue_str("device-id"), "CFO", read_cfo);
+    bool get_cfo_success = readDeviceConfig(config->device_id, "CFO", read_cfo);
     if (get_cfo_success)
     {
         if (read_cfo > 0.0)
@@ -35,15 +43,27 @@ CycleStartDetector::CycleStartDetector(
     save_ref_len = N_zfc * (R_zfc + 2);
     saved_ref.resize(save_ref_len);
     saved_ref_timer.resize(save_ref_len);
+    cfo_corrected_ref.resize(save_ref_len);
+
+    ring_sc16 = is_sc16_format(config->cpu_format);
+    if (ring_sc16)
+        synced_buffer_sc16 = std::make_unique<SyncedBufferManager<sc16_type, sample_tick>>(capacity);
+    else
+        synced_buffer = std::make_unique<SyncedBufferManager<std::complex<float>, sample_tick>>(capacity);
 
-    size_t max_rx_packet_size = parser.getValue_int("max-rx-packet-size");
-    // capacity = std::pow(2.0, parser.getValue_int("capacity-pow"));
+    if (config->csd_energy_gate_db > 0.0)
+        gate_factor = fromDecibel(config->csd_energy_gate_db);
+
+    size_t max_rx_packet_size = config->max_rx_packet_size;
+    // capacity = std::pow(2.0, config->capacity_pow);
     if (capacity <= max_rx_packet_size)
         LOG_ERROR("Buffer capacity must be greater than maximum receive buffer size.");
 
-    corr_seq_len = N_zfc * parser.getValue_int("corr-seq-len-mul");
+    corr_seq_len = N_zfc * config->corr_seq_len_mul;
 
-    samples_buffer.resize(corr_seq_len + N_zfc - 1);
+    block_overlap.resize(N_zfc - 1);
+    if (gate_factor > 0.0)
+        gate_cells.assign(corr_seq_len + N_zfc - 1, 0.0);
     timer.resize(corr_seq_len);
 
     WaveformGenerator wf_gen = WaveformGenerator();
@@ -55,17 +75,54 @@ CycleStartDetector::CycleStartDetector(
     {
         fft_L *= 2;
     }
-    int num_FFT_threads = int(parser.getValue_int("num-FFT-threads"));
-    fftw_wrapper.initialize(fft_L, num_FFT_threads);
-    std::vector<std::complex<float>> padded_zfc;
-    fftw_wrapper.zeroPad(zfc_seq, padded_zfc, fft_L);
-    fftw_wrapper.fft(padded_zfc, zfc_seq_fft_conj);
-    for (auto &val : zfc_seq_fft_conj)
+    int num_FFT_threads = int(config->num_fft_threads);
+    zfc_roots = config->ref_zfc_roots();
+    max_batch_blocks = config->csd_max_batch_blocks;
+    for (size_t k = 1; k < zfc_roots.size(); ++k)
     {
-        val = std::conj(val);
+        extra_root_peak_dets.emplace_back(std::make_unique<PeakDetectionClass>(config, peak_det_obj.noise_ampl));
+        extra_root_peak_dets.back()->sample_clock = sample_clock;
+    }
+
+    CfarMode cfar_mode = parse_cfar_mode(config->cfar_mode);
+    if (cfar_mode != CfarMode::NONE)
+    {
+        cfar = std::make_unique<CfarDetector>(cfar_mode, config->cfar_train_cells, config->cfar_guard_cells, config->cfar_pfa);
+        for (size_t k = 1; k < zfc_roots.size(); ++k)
+            extra_root_cfars.emplace_back(std::make_unique<CfarDetector>(cfar_mode, config->cfar_train_cells, config->cfar_guard_cells, config->cfar_pfa));
+    }
+
+    if (plan_source)
+    {
+        fftw_wrapper.share_plans(plan_source->fftw_wrapper);
+        roots_fft_conj = plan_source->roots_fft_conj;
+    }
+    else
+    {
+        fftw_wrapper.initialize(fft_L, num_FFT_threads);
+        // batches of 1, 2, 4, ... blocks (forward) times the number of roots (inverse)
+        for (size_t num_blocks = 1; num_blocks <= max_batch_blocks; num_blocks *= 2)
+        {
+            if (num_blocks > 1)
+                fftw_wrapper.initialize_many(num_blocks);
+            if (num_blocks * zfc_roots.size() > 1)
+                fftw_wrapper.initialize_many(num_blocks * zfc_roots.size());
+        }
+
+        for (const auto &root : zfc_roots)
+        {
+            wf_gen.initialize(wf_gen.ZFC, N_zfc, 1, 0, 0, root, 1.0, 0);
+            std::vector<std::complex<float>> padded_zfc, zfc_fft;
+            fftw_wrapper.zeroPad(wf_gen.generate_waveform(), padded_zfc, fft_L);
+            fftw_wrapper.fft(padded_zfc, zfc_fft);
+            for (auto &val : zfc_fft)
+            {
+                roots_fft_conj.push_back(std::conj(val));
+            }
+        }
     }
 
-    update_noise_level = (parser.getValue_str("update-noise-level") == "true") ? true : false;
+    update_noise_level = config->update_noise_level;
     is_correct_cfo = true;
 
     if (capacity < corr_seq_len)
@@ -81,6 +138,13 @@ CycleStartDetector::CycleStartDetector(
         fft_LL *= 2;
     }
 
+    if (plan_source)
+    {
+        fftw_wrapper_LL.share_plans(plan_source->fftw_wrapper_LL);
+        zfc_seq_fft_conj_LL = plan_source->zfc_seq_fft_conj_LL;
+        return;
+    }
+
     fftw_wrapper_LL.initialize(fft_LL, num_FFT_threads);
     std::vector<std::complex<float>> padded_zfc_LL;
     fftw_wrapper_LL.zeroPad(zfc_seq, padded_zfc_LL, fft_LL);
@@ -93,15 +157,26 @@ CycleStartDetector::CycleStartDetector(
 
 void CycleStartDetector::reset()
 {
-    synced_buffer.clear();
+    if (ring_sc16)
+        synced_buffer_sc16->clear();
+    else
+        synced_buffer->clear();
     prev_timer = uhd::time_spec_t(0.0);
     peak_det_obj_ref.reset();
     cfo_counter = 0;
 
     saved_ref.clear();
-    saved_ref.resize(save_ref_len);
     saved_ref_timer.clear();
-    saved_ref_timer.resize(save_ref_len);
+
+    reset_cfar();
+    std::fill(gate_cells.begin(), gate_cells.end(), 0.0);
+
+    // the producer keeps counting and pushing arrivals -- drain them from this (consumer) side and
+    // count the samples dropped with the ring as consumed
+    while (packet_arrivals.pop(pending_arrival))
+        ;
+    pending_arrival = {0, 0};
+    consumed_samples = produced_samples.load(std::memory_order_acquire);
 }
 
 void CycleStartDetector::post_peak_det()
@@ -115,7 +190,7 @@ void CycleStartDetector::post_peak_det()
         cfo += new_cfo; // radians/sample
         // cfo_count_max = rational_number_approximation(cfo / (2 * M_PI));
         // Add CFO to config file
-        if (not saveDeviceConfig(parser.getValue_str("device-id"), "CFO", float(cfo)))
+        if (not saveDeviceConfig(config->device_id, "CFO", float(cfo)))
             LOG_WARN("CFO cannot be saved to the config file.");
         LOG_DEBUG_FMT("Estimated new CFO = %1% rad/sample and current CFO = %2% rad/sample.", new_cfo, cfo);
     }
@@ -130,18 +205,21 @@ void CycleStartDetector::post_peak_det()
 
 void CycleStartDetector::update_peaks_info(const float &new_cfo)
 {
-    // correct CFO
-    std::deque<std::complex<float>> cfo_corrected_ref(save_ref_len);
-
-    if (is_correct_cfo)
+    // correct CFO -- read in place from the saved REF history
+    const HistorySnapshot<std::complex<float>> ref_snapshot = saved_ref.last(save_ref_len);
+    size_t n = 0;
+    for (const auto &span : ref_snapshot.spans)
     {
-        for (size_t n = 0; n < save_ref_len; ++n)
-            cfo_corrected_ref[n] = saved_ref[n] * std::complex<float>(std::cos(new_cfo * n), -std::sin(new_cfo * n));
-    }
-    else
-    {
-        for (size_t n = 0; n < save_ref_len; ++n)
-            cfo_corrected_ref[n] = saved_ref[n];
+        if (is_correct_cfo)
+        {
+            for (size_t k = 0; k < span.size; ++k, ++n)
+                cfo_corrected_ref[n] = span.data[k] * std::complex<float>(std::cos(new_cfo * n), -std::sin(new_cfo * n));
+        }
+        else
+        {
+            std::copy(span.data, span.data + span.size, cfo_corrected_ref.begin() + n);
+            n += span.size;
+        }
     }
 
     // Calculate cross-corr again
@@ -152,8 +230,8 @@ void CycleStartDetector::update_peaks_info(const float &new_cfo)
     for (size_t n = 0; n < save_ref_len; ++n)
         abs_corr[n] = std::abs(cfo_corr_results[n]);
 
-    int ref_start_index = peak_det_obj_ref.updatePeaksAfterCFO(abs_corr, saved_ref_timer);
-    LOG_INFO_FMT("ref_start_index %1%", ref_start_index);
+    int ref_start_index = peak_det_obj_ref.updatePeaksAfterCFO(abs_corr, saved_ref_timer.last(save_ref_len));
+    LOG_INFO_FMT("ref_start_index %1% (%2% samples sub-sample offset)", ref_start_index, peak_det_obj_ref.ref_start_frac_offset);
     if (ref_start_index + N_zfc * R_zfc > save_ref_len)
         LOG_WARN("detected ref_start_index is incorrect");
 
@@ -198,21 +276,51 @@ void CycleStartDetector::update_peaks_info(const float &new_cfo)
  */
 void CycleStartDetector::produce(const std::vector<std::complex<float>> &samples, const size_t &samples_size, const uhd::time_spec_t &packet_start_time, bool &stop_signal_called)
 {
+    if (not ring_sc16)
+        return push_packet(*synced_buffer, samples.data(), samples_size, packet_start_time, stop_signal_called);
+
+    if (produce_sc16.size() < samples_size)
+        produce_sc16.resize(samples_size);
+    fc32_to_sc16(samples.data(), samples_size, produce_sc16.data());
+    push_packet(*synced_buffer_sc16, produce_sc16.data(), samples_size, packet_start_time, stop_signal_called);
+}
+
+// sc16 packets go to the sc16 ring as they are, the float ring gets them converted
+void CycleStartDetector::produce(const std::vector<sc16_type> &samples, const size_t &samples_size, const uhd::time_spec_t &packet_start_time, bool &stop_signal_called)
+{
+    if (ring_sc16)
+        return push_packet(*synced_buffer_sc16, samples.data(), samples_size, packet_start_time, stop_signal_called);
+
+    if (produce_fc32.size() < samples_size)
+        produce_fc32.resize(samples_size);
+    sc16_to_fc32(samples.data(), samples_size, produce_fc32.data());
+    push_packet(*synced_buffer, produce_fc32.data(), samples_size, packet_start_time, stop_signal_called);
+}
+
+template <typename RING_SAMPLE>
+void CycleStartDetector::push_packet(SyncedBufferManager<RING_SAMPLE, sample_tick> &ring, const RING_SAMPLE *samples, const size_t &samples_size, const uhd::time_spec_t &packet_start_time, bool &stop_signal_called)
+{
+    int64_t packet_arrival_ns = LatencyProbes::now_ns();
+
     // insert first timer
-    uhd::time_spec_t next_time = packet_start_time; // USRP time of first packet
+    sample_tick next_time = sample_clock.to_tick(packet_start_time); // USRP time of first packet
 
     // insert samples into the buffer
     for (size_t i = 0; i < samples_size; ++i)
     {
-        while (!synced_buffer.push(samples[i], next_time))
+        while (!ring.push(samples[i], next_time))
         {
             if (stop_signal_called)
                 break;
             // LOG_DEBUG("Yield Producer");
             std::this_thread::yield();
         }
-        next_time += rx_sample_duration;
+        next_time += sample_clock.ticks_per_sample;
     }
+
+    size_t total_produced = produced_samples.fetch_add(samples_size, std::memory_order_release) + samples_size;
+    if (!packet_arrivals.push({total_produced, packet_arrival_ns}))
+        LATENCY_COUNT("csd.arrival_ring_full");
 }
 
 /**
@@ -235,6 +343,7 @@ void CycleStartDetector::consume(std::atomic<bool> &csd_success_signal, bool &st
     if (peak_det_obj_ref.detection_flag)
     {
         post_peak_det();
+        LATENCY_RECORD_SINCE("csd.peak_confirm_to_post_peak_det", peak_confirm_ns);
 
         // reset corr and peak det objects
         reset();
@@ -243,60 +352,250 @@ void CycleStartDetector::consume(std::atomic<bool> &csd_success_signal, bool &st
     }
     else
     {
-        for (int i = 0; i < corr_seq_len; ++i)
+        // blocks already waiting in the ring are correlated together -- a consumer that fell behind
+        // catches up with one batched FFT instead of one FFT per block
+        size_t backlog = ring_sc16 ? synced_buffer_sc16->size() : synced_buffer->size();
+        size_t num_blocks = 1;
+        while (2 * num_blocks <= max_batch_blocks and 2 * num_blocks * corr_seq_len <= backlog)
+            num_blocks *= 2;
+        last_backlog_samples = backlog;
+        last_batch_blocks = num_blocks;
+        LATENCY_RECORD_VALUE("csd.backlog_samples", backlog);
+        LATENCY_RECORD_VALUE("csd.batch_blocks", num_blocks);
+
+        const size_t num_batch_samples = num_blocks * corr_seq_len;
+        batch_samples.resize(num_batch_samples);
+        batch_timer.resize(num_batch_samples);
+        if (ring_sc16)
         {
-            std::complex<float> sample;
-            while (!synced_buffer.pop(sample, timer[i]))
-            {
-                if (stop_signal_called)
-                    break;
-                // LOG_DEBUG("Yield Consumer");
-                std::this_thread::yield();
-            }
-            // adjust for CFO
-            if (cfo != 0.0)
+            batch_samples_sc16.resize(num_batch_samples);
+            pop_samples(*synced_buffer_sc16, batch_samples_sc16.data(), num_batch_samples, stop_signal_called);
+            sc16_to_fc32(batch_samples_sc16.data(), num_batch_samples, batch_samples.data());
+        }
+        else
+            pop_samples(*synced_buffer, batch_samples.data(), num_batch_samples, stop_signal_called);
+
+        // block powers for the energy gate -- integer multiply-adds on the sc16 ring
+        if (gate_factor > 0.0)
+        {
+            block_powers.resize(num_blocks);
+            for (size_t blk = 0; blk < num_blocks; ++blk)
+                block_powers[blk] = max_window_power(blk);
+        }
+
+        // adjust for CFO
+        if (cfo != 0.0)
+        {
+            for (auto &sample : batch_samples)
             {
                 sample *= std::complex<float>(std::cos(cfo * cfo_counter), -std::sin(cfo * cfo_counter));
                 cfo_counter++;
                 if (cfo_counter == cfo_count_max)
                     cfo_counter = 0;
             }
-            // insert data into deque buffer
-            samples_buffer.pop_front();
-            samples_buffer.push_back(sample);
         }
 
-        std::vector<std::complex<float>> corr_results = fft_cross_correlate(samples_buffer);
-        peak_detector(corr_results, timer);
+        const bool gated = gate_batch(num_blocks);
+        std::vector<std::vector<std::complex<float>>> corr_results;
+        if (not gated)
+        {
+            // correlation window of a block = last N_zfc - 1 samples before it + the block
+            padded_windows.assign(num_blocks * fft_L, std::complex<float>(0.0, 0.0));
+            for (size_t blk = 0; blk < num_blocks; ++blk)
+            {
+                auto window = padded_windows.begin() + blk * fft_L;
+                auto block_begin = batch_samples.begin() + blk * corr_seq_len;
+                if (blk == 0)
+                    std::copy(block_overlap.begin(), block_overlap.end(), window);
+                else
+                    std::copy(block_begin - (N_zfc - 1), block_begin, window);
+                std::copy(block_begin, block_begin + corr_seq_len, window + N_zfc - 1);
+            }
+
+            corr_results = fft_cross_correlate(padded_windows, num_blocks);
+        }
+
+        const size_t num_roots = zfc_roots.size();
+        for (size_t blk = 0; blk < num_blocks; ++blk)
+        {
+            // overlap in front of the next correlation window -- one copy per block
+            auto block_end = batch_samples.begin() + (blk + 1) * corr_seq_len;
+            std::copy(block_end - (N_zfc - 1), block_end, block_overlap.begin());
+            std::copy(batch_timer.begin() + blk * corr_seq_len, batch_timer.begin() + (blk + 1) * corr_seq_len, timer.begin());
+
+            // arrival time of the packet holding the last sample of this block
+            consumed_samples += corr_seq_len;
+            while (pending_arrival.first < consumed_samples and packet_arrivals.pop(pending_arrival))
+                ;
+            // enqueue to correlation results, before the detectors run
+            if (pending_arrival.first >= consumed_samples)
+                LATENCY_RECORD_SINCE("csd.block_enqueue_to_corr", pending_arrival.second);
+
+            size_t num_saved = corr_seq_len;
+            if (gated)
+                skip_block(timer);
+            else
+            {
+                num_saved = peak_detector(corr_results[blk * num_roots], timer);
+                for (size_t k = 1; k < num_roots; ++k)
+                    extra_root_detector(k, corr_results[blk * num_roots + k], timer);
+            }
+            // REF history -- one append per block instead of shifting a deque per sample
+            saved_ref.append(batch_samples.data() + blk * corr_seq_len, num_saved);
+            saved_ref_timer.append(timer.data(), num_saved);
+            if (gate_factor > 0.0 and peak_det_obj_ref.peaks_count == 0)
+                update_gate_floor(block_powers[blk]);
+
+            // the remaining blocks are dropped with the ring by reset() after detection
+            if (peak_det_obj_ref.detection_flag)
+                break;
+        }
 
         std::cout << "\r Num samples without peak = " << num_samples_without_peak << std::flush;
     }
 }
 
-std::vector<std::complex<float>> CycleStartDetector::fft_cross_correlate(const std::deque<std::complex<float>> &samples)
+template <typename RING_SAMPLE>
+void CycleStartDetector::pop_samples(SyncedBufferManager<RING_SAMPLE, sample_tick> &ring, RING_SAMPLE *samples, const size_t &num_samples, bool &stop_signal_called)
+{
+    for (size_t i = 0; i < num_samples; ++i)
+    {
+        while (!ring.pop(samples[i], batch_timer[i]))
+        {
+            if (stop_signal_called)
+                break;
+            // LOG_DEBUG("Yield Consumer");
+            std::this_thread::yield();
+        }
+    }
+}
+
+// a batch is skipped if all its blocks stay near the noise floor and no REF is partially detected
+bool CycleStartDetector::gate_batch(const size_t &num_blocks)
+{
+    if (gate_factor <= 0.0 or gate_floor_power <= 0.0 or peak_det_obj_ref.peaks_count > 0)
+        return false;
+    for (const auto &root_peak_det : extra_root_peak_dets)
+        if (root_peak_det->peaks_count > 0)
+            return false;
+    for (size_t blk = 0; blk < num_blocks; ++blk)
+        if (block_powers[blk] >= gate_factor * gate_floor_power)
+            return false;
+
+    gated_blocks += num_blocks;
+    LATENCY_COUNT("csd.gated_batches");
+    return true;
+}
+
+// bookkeeping of a block without peaks (see peak_detector), without correlating it
+void CycleStartDetector::skip_block(const std::vector<sample_tick> &timer)
+{
+    for (size_t i = 0; i < corr_seq_len; ++i)
+    {
+        peak_det_obj_ref.increase_samples_counter();
+        for (auto &root_peak_det : extra_root_peak_dets)
+            root_peak_det->increase_samples_counter();
+    }
+    num_samples_without_peak += corr_seq_len;
+
+    // the next correlated block does not continue the training cells
+    reset_cfar();
+}
+
+void CycleStartDetector::reset_cfar()
 {
-    std::vector<std::complex<float>> padded_samples, fft_samples, product(fft_L), ifft_result;
-    fftw_wrapper.zeroPad(samples, padded_samples, fft_L);
-    fftw_wrapper.fft(padded_samples, fft_samples);
+    if (cfar)
+        cfar->reset();
+    for (auto &root_cfar : extra_root_cfars)
+        root_cfar->reset();
+}
 
-    for (int i = 0; i < fft_L; ++i)
+/** Gate power of block `blk` of the batch: the largest mean |x|^2 over the N_zfc-sample windows of
+ * its correlation window (the last N_zfc - 1 samples of the previous block followed by the block).
+ *
+ * Every correlation lag of the block has its full ZFC repetition inside one of these windows, so
+ * a repetition is compared at the REF SNR even if only its last samples fall into the block --
+ * the mean over the whole block would dilute it by up to 10*log10(corr-seq-len-mul) dB and gate
+ * blocks whose lags hold REF peaks. Blocks must be passed in order, also the gated ones.
+ */
+float CycleStartDetector::max_window_power(const size_t &blk)
+{
+    // |x|^2 of the last N_zfc - 1 samples of the previous block stay in front
+    std::copy(gate_cells.end() - (N_zfc - 1), gate_cells.end(), gate_cells.begin());
+    float *block_cells = gate_cells.data() + N_zfc - 1;
+    if (ring_sc16)
+        sc16_powers(batch_samples_sc16.data() + blk * corr_seq_len, corr_seq_len, block_cells);
+    else
     {
-        product[i] = fft_samples[i] * zfc_seq_fft_conj[i];
+        const std::complex<float> *block = batch_samples.data() + blk * corr_seq_len;
+        for (size_t i = 0; i < corr_seq_len; ++i)
+            block_cells[i] = std::norm(block[i]);
     }
 
-    fftw_wrapper.ifft(product, ifft_result);
+    // sliding window sums
+    double window_sum = std::accumulate(gate_cells.begin(), gate_cells.begin() + N_zfc, 0.0);
+    double max_sum = window_sum;
+    for (size_t i = N_zfc; i < gate_cells.size(); ++i)
+    {
+        window_sum += gate_cells[i] - gate_cells[i - N_zfc];
+        max_sum = std::max(max_sum, window_sum);
+    }
+    return max_sum / N_zfc;
+}
 
-    std::vector<std::complex<float>> result(ifft_result.begin(), ifft_result.begin() + corr_seq_len);
-    return result;
+// slow average of the gate power of blocks without REF peaks
+void CycleStartDetector::update_gate_floor(const float &block_power)
+{
+    if (gate_floor_power <= 0.0)
+        gate_floor_power = block_power;
+    else
+        gate_floor_power += (block_power - gate_floor_power) / 16;
 }
 
-std::vector<std::complex<float>> CycleStartDetector::fft_post_crosscorr(const std::deque<std::complex<float>> &samples)
+std::vector<std::vector<std::complex<float>>> CycleStartDetector::fft_cross_correlate(const std::vector<std::complex<float>> &padded_windows, const size_t &num_blocks)
+{
+    const size_t num_roots = zfc_roots.size();
+    const size_t num_corrs = num_blocks * num_roots;
+    std::vector<std::complex<float>> fft_samples, product(fft_L * num_corrs), ifft_result;
+    if (num_blocks == 1)
+        fftw_wrapper.fft(padded_windows, fft_samples);
+    else
+        fftw_wrapper.fft_many(padded_windows, fft_samples, num_blocks);
+
+    // the spectrum of a block is shared by all roots
+    for (size_t blk = 0; blk < num_blocks; ++blk)
+    {
+        for (size_t k = 0; k < num_roots; ++k)
+        {
+            auto block_fft = fft_samples.begin() + blk * fft_L;
+            auto root_fft_conj = roots_fft_conj.begin() + k * fft_L;
+            auto out = product.begin() + (blk * num_roots + k) * fft_L;
+            for (size_t i = 0; i < fft_L; ++i)
+            {
+                out[i] = block_fft[i] * root_fft_conj[i];
+            }
+        }
+    }
+
+    if (num_corrs == 1)
+        fftw_wrapper.ifft(product, ifft_result);
+    else
+        fftw_wrapper.ifft_many(product, ifft_result, num_corrs);
+
+    // result [blk * num_roots + k] -- block `blk` correlated with root `k`
+    std::vector<std::vector<std::complex<float>>> results(num_corrs);
+    for (size_t c = 0; c < num_corrs; ++c)
+        results[c].assign(ifft_result.begin() + c * fft_L, ifft_result.begin() + c * fft_L + corr_seq_len);
+    return results;
+}
+
+std::vector<std::complex<float>> CycleStartDetector::fft_post_crosscorr(const std::vector<std::complex<float>> &samples)
 {
     std::vector<std::complex<float>> padded_samples, fft_samples, product(fft_LL), ifft_result;
     fftw_wrapper_LL.zeroPad(samples, padded_samples, fft_LL);
     fftw_wrapper_LL.fft(padded_samples, fft_samples);
 
-    for (int i = 0; i < fft_LL; ++i)
+    for (size_t i = 0; i < fft_LL; ++i)
     {
         product[i] = fft_samples[i] * zfc_seq_fft_conj_LL[i];
     }
@@ -307,14 +606,18 @@ std::vector<std::complex<float>> CycleStartDetector::fft_post_crosscorr(const st
     return result;
 }
 
-void CycleStartDetector::peak_detector(const std::vector<std::complex<float>> &corr_results, const std::vector<uhd::time_spec_t> &timer)
+size_t CycleStartDetector::peak_detector(const std::vector<std::complex<float>> &corr_results, const std::vector<sample_tick> &timer)
 {
+    size_t num_saved = corr_seq_len;
     bool found_peak = false;
     float sum_ampl = 0.0;
     float corr_abs_val = 0.0;
     float curr_pnr = 0.0;
 
-    for (int i = 0; i < corr_seq_len; ++i)
+    if (cfar)
+        cfar->process(corr_results.data(), corr_seq_len);
+
+    for (size_t i = 0; i < corr_seq_len; ++i)
     {
         std::complex<float> corr = corr_results[i];
         corr_abs_val = std::abs(corr) / N_zfc;
@@ -324,7 +627,8 @@ void CycleStartDetector::peak_detector(const std::vector<std::complex<float>> &c
         if (curr_pnr > max_pnr)
             max_pnr = curr_pnr;
 
-        if (curr_pnr >= peak_det_obj_ref.curr_pnr_threshold)
+        // with CFAR, a peak must also stand out of its neighbouring lags
+        if (curr_pnr >= peak_det_obj_ref.curr_pnr_threshold and (not cfar or cfar->is_detection(i)))
         {
             found_peak = true;
             peak_det_obj_ref.process_corr(corr, timer[i]);
@@ -343,33 +647,56 @@ void CycleStartDetector::peak_detector(const std::vector<std::complex<float>> &c
 
         if (peak_det_obj_ref.detection_flag)
         {
+            peak_confirm_ns = LatencyProbes::now_ns();
+
             // add N_zfc more samples to the end
-            size_t M = 0;
-            while ((M + i < corr_seq_len) & (M < N_zfc))
-            {
-                saved_ref.pop_front();
-                saved_ref.push_back(samples_buffer[M + i + N_zfc - 1]);
-                saved_ref_timer.pop_front();
-                saved_ref_timer.push_back(timer[M + i + N_zfc - 1]);
-                M++;
-            }
+            num_saved = std::min<size_t>(i + N_zfc, corr_seq_len);
 
             // break the for loop
             break;
         }
         else // increase conuter
-        {
-            saved_ref.pop_front();
-            saved_ref.push_back(samples_buffer[i + N_zfc - 1]);
-            saved_ref_timer.pop_front();
-            saved_ref_timer.push_back(timer[i + N_zfc - 1]);
             peak_det_obj_ref.increase_samples_counter();
-        }
     }
 
-    // udpate noise level
-    if ((not found_peak) and update_noise_level and (not peak_det_obj_ref.detection_flag))
+    // udpate noise level -- from the CFAR noise estimate if enabled, it follows gain changes
+    if (cfar)
+    {
+        if (not peak_det_obj_ref.detection_flag)
+            peak_det_obj_ref.updateNoiseFromCfar(cfar->noise_power());
+    }
+    else if ((not found_peak) and update_noise_level and (not peak_det_obj_ref.detection_flag))
         peak_det_obj_ref.updateNoiseLevel(sum_ampl / corr_seq_len, corr_seq_len);
+
+    return num_saved;
+}
+
+void CycleStartDetector::extra_root_detector(const size_t &root_index, const std::vector<std::complex<float>> &corr_results, const std::vector<sample_tick> &timer)
+{
+    PeakDetectionClass &root_peak_det = *extra_root_peak_dets[root_index - 1];
+    root_peak_det.noise_ampl = peak_det_obj_ref.noise_ampl; // same receiver noise for all roots
+    CfarDetector *root_cfar = extra_root_cfars.empty() ? nullptr : extra_root_cfars[root_index - 1].get();
+    if (root_cfar)
+        root_cfar->process(corr_results.data(), corr_seq_len);
+
+    for (size_t i = 0; i < corr_seq_len; ++i)
+    {
+        float curr_pnr = std::abs(corr_results[i]) / N_zfc / root_peak_det.noise_ampl;
+        if (curr_pnr >= root_peak_det.curr_pnr_threshold and (not root_cfar or root_cfar->is_detection(i)))
+            root_peak_det.process_corr(corr_results[i], timer[i]);
+
+        if (root_peak_det.detection_flag)
+        {
+            uhd::time_spec_t ref_start_time = root_peak_det.get_ref_start_time();
+            if (extra_root_callback)
+                extra_root_callback(zfc_roots[root_index], ref_start_time);
+            else
+                LOG_INFO_FMT("REF with ZFC root %1% detected at %2% secs.", zfc_roots[root_index], ref_start_time.get_real_secs());
+            root_peak_det.reset();
+        }
+        else
+            root_peak_det.increase_samples_counter();
+    }
 }
 
 float CycleStartDetector::est_e2e_ref_sig_amp()
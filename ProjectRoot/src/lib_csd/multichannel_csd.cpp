@@ -0,0 +1,122 @@
+#include "multichannel_csd.hpp"
+
+RxCombining parse_rx_combining(const std::string &name)
+{
+    if (name == "snr_weighted")
+        return RxCombining::SNR_WEIGHTED;
+    return RxCombining::SELECTION;
+}
+
+float combine_channel_powers(const std::vector<float> &signal_powers, const std::vector<float> &noise_powers, const RxCombining &combining, size_t &strongest)
+{
+    std::vector<float> snrs(signal_powers.size());
+    for (size_t ch = 0; ch < signal_powers.size(); ++ch)
+        snrs[ch] = noise_powers[ch] > 0.0 ? signal_powers[ch] / noise_powers[ch] : signal_powers[ch];
+
+    strongest = std::max_element(snrs.begin(), snrs.end()) - snrs.begin();
+    if (combining == RxCombining::SELECTION)
+        return signal_powers[strongest];
+
+    // weights proportional to the channel SNRs
+    float weighted_sum = 0.0, weight_sum = 0.0;
+    for (size_t ch = 0; ch < signal_powers.size(); ++ch)
+    {
+        weighted_sum += snrs[ch] * signal_powers[ch];
+        weight_sum += snrs[ch];
+    }
+    return weight_sum > 0.0 ? weighted_sum / weight_sum : signal_powers[strongest];
+}
+
+MultiChannelCSD::MultiChannelCSD(std::shared_ptr<const Config> config, size_t &capacity, const uhd::time_spec_t &rx_sample_duration, const double &master_clock_rate, const float &init_noise_ampl, const size_t &num_channels, const RxCombining &combining)
+    : combining(combining),
+      channel_success(new std::atomic<bool>[num_channels])
+{
+    if (num_channels == 0)
+        LOG_ERROR("At least one RX channel is required for cycle start detection.");
+
+    for (size_t ch = 0; ch < num_channels; ++ch)
+    {
+        peak_dets.emplace_back(std::make_unique<PeakDetectionClass>(config, init_noise_ampl));
+        const CycleStartDetector *plan_source = ch == 0 ? nullptr : csds.front().get();
+        csds.emplace_back(std::make_unique<CycleStartDetector>(config, capacity, rx_sample_duration, master_clock_rate, *peak_dets.back(), plan_source));
+        channel_success[ch] = false;
+    }
+
+    // a channel that has not seen the REF by the end of the (saved) REF will not see it in this round
+    grace_samples = config->ref_n_zfc * (config->ref_r_zfc + 2) + config->ref_n_zfc * config->corr_seq_len_mul;
+}
+
+void MultiChannelCSD::produce(const std::vector<std::vector<std::complex<float>>> &samples, const size_t &samples_size, const uhd::time_spec_t &time, bool &stop_signal_called)
+{
+    produce_channels(samples, samples_size, time, stop_signal_called);
+}
+
+void MultiChannelCSD::produce(const std::vector<std::vector<sc16_type>> &samples, const size_t &samples_size, const uhd::time_spec_t &time, bool &stop_signal_called)
+{
+    produce_channels(samples, samples_size, time, stop_signal_called);
+}
+
+template <typename SAMPLE>
+void MultiChannelCSD::produce_channels(const std::vector<std::vector<SAMPLE>> &samples, const size_t &samples_size, const uhd::time_spec_t &time, bool &stop_signal_called)
+{
+    for (size_t ch = 0; ch < csds.size(); ++ch)
+        csds[ch]->produce(samples[ch], samples_size, time, stop_signal_called);
+
+    for (size_t ch = 0; ch < csds.size(); ++ch)
+    {
+        if (channel_success[ch])
+        {
+            samples_since_detection += samples_size;
+            break;
+        }
+    }
+}
+
+void MultiChannelCSD::consume(const size_t &channel, bool &stop_signal_called)
+{
+    csds[channel]->consume(channel_success[channel], stop_signal_called);
+}
+
+bool MultiChannelCSD::detection_complete()
+{
+    std::vector<size_t> detected;
+    for (size_t ch = 0; ch < csds.size(); ++ch)
+        if (channel_success[ch])
+            detected.push_back(ch);
+
+    if (detected.empty())
+        return false;
+    if (detected.size() < csds.size() and samples_since_detection < grace_samples)
+        return false;
+
+    std::vector<float> signal_powers, noise_powers;
+    for (const auto &ch : detected)
+    {
+        signal_powers.push_back(csds[ch]->est_ref_sig_pow);
+        noise_powers.push_back(std::norm(csds[ch]->peak_det_obj_ref.noise_ampl));
+        csds[ch]->est_ref_sig_pow = 0.0;
+    }
+
+    size_t strongest;
+    est_ref_sig_pow = combine_channel_powers(signal_powers, noise_powers, combining, strongest);
+    csd_wait_timer = csds[detected[strongest]]->csd_wait_timer;
+    cfo = csds[detected[strongest]]->cfo;
+
+    if (csds.size() > 1)
+        LOG_DEBUG_FMT("REF detected on %1% of %2% RX channels, strongest channel %3%", detected.size(), csds.size(), detected[strongest]);
+
+    return true;
+}
+
+void MultiChannelCSD::reset_detections()
+{
+    for (size_t ch = 0; ch < csds.size(); ++ch)
+        channel_success[ch] = false;
+    samples_since_detection = 0;
+}
+
+void MultiChannelCSD::set_noise_ampl(const float &noise_ampl)
+{
+    for (auto &csd : csds)
+        csd->peak_det_obj_ref.noise_ampl = noise_ampl;
+}
@@ -1,31 +1,29 @@
 #include "peakdetector.hpp"
 
 PeakDetectionClass::PeakDetectionClass(
-    ConfigParser &parser,
-    const float &init_noise_ampl) : parser(parser),
+    std::shared_ptr<const Config> config,
+    const float &init_noise_ampl) : config(config),
                                     detection_flag(false),
                                     init_noise_ampl(init_noise_ampl)
 {
 
-    ref_seq_len = parser.getValue_int("Ref-N-zfc");
-    total_num_peaks = parser.getValue_int("Ref-R-zfc");
-    pnr_threshold = parser.getValue_float("pnr-threshold");
+    ref_seq_len = config->ref_n_zfc;
+    total_num_peaks = config->ref_r_zfc;
+    pnr_threshold = config->pnr_threshold;
     curr_pnr_threshold = pnr_threshold;
     max_pnr = 0.0;
 
-    if (parser.getValue_str("update-pnr-threshold") == "true")
-        is_update_pnr_threshold = true;
-    else
-        is_update_pnr_threshold = false;
+    is_update_pnr_threshold = config->update_pnr_threshold;
 
-    peak_det_tol = parser.getValue_int("peak-det-tol");
-    max_peak_mul = parser.getValue_float("max-peak-mul");
-    sync_with_peak_from_last = parser.getValue_int("sync-with-peak-from-last");
+    peak_det_tol = config->peak_det_tol;
+    max_peak_mul = config->max_peak_mul;
+    sync_with_peak_from_last = config->sync_with_peak_from_last;
+    sample_clock = SampleClock(config->master_clock_rate, config->rate);
 
     peak_indices = new size_t[total_num_peaks];
     peak_vals = new float[total_num_peaks];
     corr_samples = new std::complex<float>[total_num_peaks];
-    peak_times = new uhd::time_spec_t[total_num_peaks];
+    peak_times = new sample_tick[total_num_peaks];
 
     prev_peak_index = 0;
     peaks_count = 0;
@@ -33,7 +31,7 @@ PeakDetectionClass::PeakDetectionClass(
     noise_ampl = init_noise_ampl;
 
     reset_counter = 0;
-    max_reset_count = parser.getValue_int("max-reset-count");
+    max_reset_count = config->max_reset_count;
 };
 
 std::complex<float> *PeakDetectionClass::get_corr_samples_at_peaks()
@@ -41,7 +39,7 @@ std::complex<float> *PeakDetectionClass::get_corr_samples_at_peaks()
     return corr_samples;
 }
 
-uhd::time_spec_t *PeakDetectionClass::get_peak_times()
+sample_tick *PeakDetectionClass::get_peak_times()
 {
     return peak_times;
 }
@@ -59,8 +57,8 @@ void PeakDetectionClass::print_peaks_data()
                           i + 2,
                           i + 1,
                           peak_indices[i + 1] - peak_indices[i],
-                          (peak_times[i + 1]).get_real_secs(),
-                          (peak_times[i]).get_real_secs(),
+                          sample_clock.to_time(peak_times[i + 1]).get_real_secs(),
+                          sample_clock.to_time(peak_times[i]).get_real_secs(),
                           peak_vals[i + 1] - peak_vals[i]);
     }
 }
@@ -103,6 +101,7 @@ void PeakDetectionClass::reset()
     prev_peak_val = 0;
     curr_pnr_threshold = pnr_threshold;
     detection_flag = false;
+    ref_start_frac_offset = 0.0;
     // noise_ampl = init_noise_ampl;
     noise_counter = 0;
 
@@ -114,7 +113,7 @@ void PeakDetectionClass::reset()
     peak_indices = new size_t[total_num_peaks];
     peak_vals = new float[total_num_peaks];
     corr_samples = new std::complex<float>[total_num_peaks];
-    peak_times = new uhd::time_spec_t[total_num_peaks];
+    peak_times = new sample_tick[total_num_peaks];
 }
 
 void PeakDetectionClass::reset_peaks_counter()
@@ -122,7 +121,7 @@ void PeakDetectionClass::reset_peaks_counter()
     peaks_count = 0; // insertPeaks takes care of other variables
 }
 
-void PeakDetectionClass::insertPeak(const std::complex<float> &corr_sample, float &peak_val, const uhd::time_spec_t &peak_time)
+void PeakDetectionClass::insertPeak(const std::complex<float> &corr_sample, float &peak_val, const sample_tick &peak_time)
 {
     if (peaks_count == 0) // First peak starts with index 0
         samples_from_first_peak = 0;
@@ -190,7 +189,7 @@ void PeakDetectionClass::updatePrevPeak()
         removeLastPeak();
 }
 
-void PeakDetectionClass::process_corr(const std::complex<float> &corr_sample, const uhd::time_spec_t &samp_time)
+void PeakDetectionClass::process_corr(const std::complex<float> &corr_sample, const sample_tick &samp_time)
 {
     const size_t samples_from_last_peak = samples_from_first_peak - prev_peak_index;
 
@@ -276,7 +275,7 @@ float PeakDetectionClass::avg_of_peak_vals()
 
 uhd::time_spec_t PeakDetectionClass::get_ref_start_time()
 {
-    return peak_times[0];
+    return sample_clock.to_time(peak_times[0], ref_start_frac_offset);
 }
 
 float PeakDetectionClass::estimate_phase_drift()
@@ -297,11 +296,12 @@ float PeakDetectionClass::estimate_phase_drift()
     return phase_drift_rate / ref_seq_len; // radians per symbol
 }
 
-int PeakDetectionClass::updatePeaksAfterCFO(const std::vector<float> &abs_corr_vals, const std::deque<uhd::time_spec_t> &new_timer)
+int PeakDetectionClass::updatePeaksAfterCFO(const std::vector<float> &abs_corr_vals, const HistorySnapshot<sample_tick> &new_timer)
 {
     // find index of first possible peak
     int init_fpi = 0, final_fpi = 0;
     float max_peak_val = 0.0;
+    std::vector<float> sum_peak_vals(2 * ref_seq_len, 0.0);
     for (int i = 0; i < 2 * ref_seq_len; ++i)
     {
         float tmp = 0.0;
@@ -312,6 +312,7 @@ int PeakDetectionClass::updatePeaksAfterCFO(const std::vector<float> &abs_corr_v
                 LOG_WARN("PeakDetectionClass::updatePeaksAfterCFO -> Index out of range!");
             tmp += abs_corr_vals[c_ind];
         }
+        sum_peak_vals[i] = tmp;
         if (tmp > max_peak_val)
         {
             max_peak_val = tmp;
@@ -319,12 +320,26 @@ int PeakDetectionClass::updatePeaksAfterCFO(const std::vector<float> &abs_corr_v
         }
     }
 
+    // sub-sample peak position -- parabola through the correlation magnitudes around the peak,
+    // summed over all repetitions of the REF (same as averaging the per-peak estimates, less noisy)
+    ref_start_frac_offset = 0.0;
+    if (final_fpi > init_fpi and final_fpi + 1 < init_fpi + 2 * int(ref_seq_len))
+    {
+        float y_prev = sum_peak_vals[final_fpi - init_fpi - 1];
+        float y_peak = sum_peak_vals[final_fpi - init_fpi];
+        float y_next = sum_peak_vals[final_fpi - init_fpi + 1];
+        float denom = y_prev - 2 * y_peak + y_next;
+        if (denom < 0.0)
+            ref_start_frac_offset = std::min(std::max(0.5f * (y_prev - y_next) / denom, -0.5f), 0.5f);
+    }
+
     for (int i = 0; i < total_num_peaks; ++i)
     {
         peak_vals[i] = abs_corr_vals[final_fpi + (i * ref_seq_len)] / ref_seq_len / noise_ampl;
         if (abs_corr_vals[final_fpi + (i * ref_seq_len)] / ref_seq_len > largest_peak_val)
             largest_peak_val = abs_corr_vals[final_fpi + (i * ref_seq_len)] / ref_seq_len;
-        peak_times[i] = new_timer[final_fpi + (i * ref_seq_len)];
+        // time of the last sample of the matched window, as in process_corr
+        peak_times[i] = new_timer[final_fpi + (i * ref_seq_len)] + sample_clock.samples(ref_seq_len - 1);
         peak_indices[i] = i * ref_seq_len;
     }
 
@@ -347,6 +362,13 @@ void PeakDetectionClass::updateNoiseLevel(const float &avg_ampl, const size_t &n
     }
 }
 
+void PeakDetectionClass::updateNoiseFromCfar(const float &corr_noise_power)
+{
+    // noise of power s^2 correlated with the unit-amplitude ZFC gives |corr|^2 = N s^2 on average
+    if (peaks_count == 0 and corr_noise_power > 0.0)
+        noise_ampl = std::sqrt(corr_noise_power / ref_seq_len);
+}
+
 bool PeakDetectionClass::check_peaks()
 {
     // check if found peaks follow correct gaps
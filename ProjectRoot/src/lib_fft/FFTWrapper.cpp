@@ -2,6 +2,17 @@
 
 FFTWrapper::FFTWrapper() {}
 
+// FFT workspaces from the huge page arena -- pre-faulted and 64-byte aligned (more than FFTW's SIMD needs)
+static fftw_complex *alloc_complex(const size_t &num_vals)
+{
+    return static_cast<fftw_complex *>(HugePageArena::getInstance().allocate(sizeof(fftw_complex) * num_vals));
+}
+
+static void free_complex(fftw_complex *ptr, const size_t &num_vals)
+{
+    HugePageArena::getInstance().deallocate(ptr, sizeof(fftw_complex) * num_vals);
+}
+
 void FFTWrapper::initialize(size_t size, int num_threads)
 {
     if (num_threads <= 0)
@@ -14,19 +25,122 @@ void FFTWrapper::initialize(size_t size, int num_threads)
     fftw_init_threads();
     fftw_plan_with_nthreads(num_threads);
 
-    fft_input_ = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * size_);
-    fft_output_ = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * size_);
+    fft_input_ = alloc_complex(size_);
+    fft_output_ = alloc_complex(size_);
     fft_plan_ = fftw_plan_dft_1d(size_, fft_input_, fft_output_, FFTW_FORWARD, FFTW_ESTIMATE);
     ifft_plan_ = fftw_plan_dft_1d(size_, fft_output_, fft_input_, FFTW_BACKWARD, FFTW_ESTIMATE);
 }
 
+void FFTWrapper::share_plans(const FFTWrapper &owner)
+{
+    size_ = owner.size_;
+    shared_plans_ = true;
+
+    // the arena gives the same alignment as the owner's buffers, so the plans are valid for these
+    fft_input_ = alloc_complex(size_);
+    fft_output_ = alloc_complex(size_);
+    fft_plan_ = owner.fft_plan_;
+    ifft_plan_ = owner.ifft_plan_;
+
+    for (const auto &[howmany, owner_batch] : owner.batch_plans_)
+    {
+        BatchPlans &batch = batch_plans_[howmany];
+        batch.input = alloc_complex(size_ * howmany);
+        batch.output = alloc_complex(size_ * howmany);
+        batch.fft_plan = owner_batch.fft_plan;
+        batch.ifft_plan = owner_batch.ifft_plan;
+    }
+}
+
+void FFTWrapper::initialize_many(const size_t &howmany)
+{
+    if (howmany == 0)
+        LOG_ERROR("Number of batched transforms must be positive.");
+    if (shared_plans_)
+        LOG_ERROR("Batched plans must be initialized on the FFTWrapper owning the plans.");
+    if (batch_plans_.count(howmany) > 0)
+        return;
+
+    BatchPlans &batch = batch_plans_[howmany];
+    int n = int(size_);
+    batch.input = alloc_complex(size_ * howmany);
+    batch.output = alloc_complex(size_ * howmany);
+    batch.fft_plan = fftw_plan_many_dft(1, &n, int(howmany), batch.input, nullptr, 1, n, batch.output, nullptr, 1, n, FFTW_FORWARD, FFTW_ESTIMATE);
+    batch.ifft_plan = fftw_plan_many_dft(1, &n, int(howmany), batch.output, nullptr, 1, n, batch.input, nullptr, 1, n, FFTW_BACKWARD, FFTW_ESTIMATE);
+}
+
+FFTWrapper::BatchPlans &FFTWrapper::get_batch_plans(const size_t &howmany)
+{
+    auto it = batch_plans_.find(howmany);
+    if (it == batch_plans_.end())
+        LOG_ERROR_FMT("Batched FFT of %1% transforms is not initialized.", howmany);
+    return it->second;
+}
+
+void FFTWrapper::fft_many(const std::vector<std::complex<float>> &input,
+                          std::vector<std::complex<float>> &output, const size_t &howmany)
+{
+    const size_t total = size_ * howmany;
+    if (input.size() != total)
+        LOG_ERROR("Input size does not match batched FFT size.");
+
+    BatchPlans &batch = get_batch_plans(howmany);
+    for (size_t i = 0; i < total; ++i)
+    {
+        batch.input[i][0] = input[i].real();
+        batch.input[i][1] = input[i].imag();
+    }
+
+    fftw_execute_dft(batch.fft_plan, batch.input, batch.output);
+
+    output.resize(total);
+    for (size_t i = 0; i < total; ++i)
+        output[i] = std::complex<float>(batch.output[i][0], batch.output[i][1]);
+}
+
+void FFTWrapper::ifft_many(const std::vector<std::complex<float>> &input,
+                           std::vector<std::complex<float>> &output, const size_t &howmany)
+{
+    const size_t total = size_ * howmany;
+    if (input.size() != total)
+        LOG_ERROR("Input size does not match batched FFT size.");
+
+    BatchPlans &batch = get_batch_plans(howmany);
+    for (size_t i = 0; i < total; ++i)
+    {
+        batch.output[i][0] = input[i].real();
+        batch.output[i][1] = input[i].imag();
+    }
+
+    fftw_execute_dft(batch.ifft_plan, batch.output, batch.input);
+
+    float scale_factor = 1.0 / size_;
+    output.resize(total);
+    for (size_t i = 0; i < total; ++i)
+        output[i] = std::complex<float>(batch.input[i][0] * scale_factor, batch.input[i][1] * scale_factor);
+}
+
 FFTWrapper::~FFTWrapper()
 {
-    fftw_destroy_plan(fft_plan_);
-    fftw_destroy_plan(ifft_plan_);
-    fftw_free(fft_input_);
-    fftw_free(fft_output_);
-    fftw_cleanup_threads();
+    if (not shared_plans_)
+    {
+        fftw_destroy_plan(fft_plan_);
+        fftw_destroy_plan(ifft_plan_);
+    }
+    free_complex(fft_input_, size_);
+    free_complex(fft_output_, size_);
+    for (auto &[howmany, batch] : batch_plans_)
+    {
+        if (not shared_plans_)
+        {
+            fftw_destroy_plan(batch.fft_plan);
+            fftw_destroy_plan(batch.ifft_plan);
+        }
+        free_complex(batch.input, size_ * howmany);
+        free_complex(batch.output, size_ * howmany);
+    }
+    if (not shared_plans_)
+        fftw_cleanup_threads();
 }
 
 void FFTWrapper::fft(const std::vector<std::complex<float>> &input,
@@ -39,18 +153,18 @@ void FFTWrapper::fft(const std::vector<std::complex<float>> &input,
     }
 
     // Copy input to fft_input_
-    for (int i = 0; i < size_; ++i)
+    for (size_t i = 0; i < size_; ++i)
     {
         fft_input_[i][0] = input[i].real();
         fft_input_[i][1] = input[i].imag();
     }
 
     // Execute FFT
-    fftw_execute(fft_plan_);
+    fftw_execute_dft(fft_plan_, fft_input_, fft_output_);
 
     // Copy fft_output_ to output
     output.resize(size_);
-    for (int i = 0; i < size_; ++i)
+    for (size_t i = 0; i < size_; ++i)
     {
         output[i] = std::complex<float>(fft_output_[i][0], fft_output_[i][1]);
     }
@@ -66,26 +180,26 @@ void FFTWrapper::ifft(const std::vector<std::complex<float>> &input,
     }
 
     // Copy input to fft_output_
-    for (int i = 0; i < size_; ++i)
+    for (size_t i = 0; i < size_; ++i)
     {
         fft_output_[i][0] = input[i].real();
         fft_output_[i][1] = input[i].imag();
     }
 
     // Execute IFFT
-    fftw_execute(ifft_plan_);
+    fftw_execute_dft(ifft_plan_, fft_output_, fft_input_);
 
     // Scale the output by 1/N (to match the definition of IFFT in FFTW)
     float scale_factor = 1.0 / size_;
     output.resize(size_);
-    for (int i = 0; i < size_; ++i)
+    for (size_t i = 0; i < size_; ++i)
     {
         output[i] = std::complex<float>(fft_input_[i][0] * scale_factor, fft_input_[i][1] * scale_factor);
     }
 }
 
 void FFTWrapper::zeroPad(const std::vector<std::complex<float>> &input,
-                         std::vector<std::complex<float>> &output, int paddedSize)
+                         std::vector<std::complex<float>> &output, size_t paddedSize)
 {
     if (paddedSize < input.size())
     {
@@ -96,18 +210,18 @@ void FFTWrapper::zeroPad(const std::vector<std::complex<float>> &input,
     output.resize(paddedSize);
 
     // Copy input to output and zero-pad the rest
-    for (int i = 0; i < input.size(); ++i)
+    for (size_t i = 0; i < input.size(); ++i)
     {
         output[i] = input[i];
     }
-    for (int i = input.size(); i < paddedSize; ++i)
+    for (size_t i = input.size(); i < paddedSize; ++i)
     {
         output[i] = std::complex<float>(0.0, 0.0);
     }
 }
 
 void FFTWrapper::zeroPad(const std::deque<std::complex<float>> &input,
-                         std::vector<std::complex<float>> &output, int paddedSize)
+                         std::vector<std::complex<float>> &output, size_t paddedSize)
 {
     if (paddedSize < input.size())
     {
@@ -118,11 +232,11 @@ void FFTWrapper::zeroPad(const std::deque<std::complex<float>> &input,
     output.resize(paddedSize);
 
     // Copy input to output and zero-pad the rest
-    for (int i = 0; i < input.size(); ++i)
+    for (size_t i = 0; i < input.size(); ++i)
     {
         output[i] = input[i];
     }
-    for (int i = input.size(); i < paddedSize; ++i)
+    for (size_t i = input.size(); i < paddedSize; ++i)
     {
         output[i] = std::complex<float>(0.0, 0.0);
     }
@@ -1,155 +1,420 @@
 #include "MQTTClient.hpp"
-
-std::mutex MQTTClient::mqtt_mutex;     // Define the static mutex
-std::mutex MQTTClient::callback_mutex; // Define the static mutex
+#include "thread_sched.hpp"
 
 // Initialize the static instance pointer to nullptr
 MQTTClient *MQTTClient::instance = nullptr;
 
-// Define the fixed server address
-const std::string MQTTClient::serverAddress = "tcp://192.168.5.247:1883";
-
-static const int qos_level = 1;
+// Default broker address, overridden by config `mqtt-broker`
+std::string MQTTClient::serverAddress = "tcp://192.168.5.247:1883";
 
 // Public method to get the single instance of the class
 MQTTClient &MQTTClient::getInstance(const std::string &clientId)
 {
     if (!instance)
     {
-        instance = new MQTTClient(clientId);
+        instance = new MQTTClient(clientId, serverAddress);
     }
     return *instance;
 }
 
-// Private constructor with fixed server address
-MQTTClient::MQTTClient(const std::string &clientId)
-    : client(serverAddress, clientId), topics(nullptr)
+void MQTTClient::setBrokerAddress(const std::string &server_uri)
 {
-    connectOptions.set_clean_session(true);
-    connectOptions.set_keep_alive_interval(60);
-    client.set_message_callback([this](mqtt::const_message_ptr msg)
-                                { onMessage(msg->get_topic(), msg->to_string()); });
+    if (instance && server_uri != serverAddress)
+        LOG_WARN_FMT("MQTT client already connected to %1%, broker address %2% is ignored.", serverAddress, server_uri);
+    serverAddress = server_uri;
+}
+
+std::unique_ptr<MQTTClient> MQTTClient::create(const std::string &clientId, const std::string &server_uri)
+{
+    return std::unique_ptr<MQTTClient>(new MQTTClient(clientId, server_uri));
+}
+
+MQTTClient::MQTTClient(const std::string &clientId, const std::string &server_uri)
+    : topics(nullptr), transport(MQTTTransport::create(server_uri, clientId))
+{
+    transport->set_message_handler([this](const std::string &topic, const std::string &payload)
+                                   { onMessage(topic, payload); });
     connect();
 
     // topics parser
     auto homePath = get_home_dir();
     std::string topics_config_file = homePath + "/OTA-C/ProjectRoot/config/mqtt_topics.conf";
     topics = std::make_unique<ConfigParser>(topics_config_file);
+
+    // outbound publish queue
+    senderRunning = true;
+    senderThread = boost::thread(&MQTTClient::senderLoop, this);
+
+    // callback dispatcher pool
+    dispatchRunning = true;
+    for (size_t i = 0; i < dispatch_pool_size; ++i)
+        dispatch_workers.create_thread([this]()
+                                       { dispatchLoop(); });
+}
+
+MQTTClient::~MQTTClient()
+{
+    stopListening();
+
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(outbound_mutex);
+        senderRunning = false;
+    }
+    outbound_cv.notify_all();
+    if (senderThread.joinable())
+        senderThread.join();
+
+    // no more incoming messages once the transport is down
+    transport->disconnect();
+
+    {
+        std::lock_guard<std::mutex> lock(dispatch_mutex);
+        dispatchRunning = false;
+    }
+    dispatch_cv.notify_all();
+    dispatch_workers.join_all();
 }
 
 // Connect to the MQTT broker
 bool MQTTClient::connect()
 {
     std::lock_guard<std::mutex> lock(mqtt_mutex); // Lock the mutex for thread safety
-    try
+    std::string error;
+    if (transport->connect(error))
     {
-        client.connect(connectOptions)->wait();
-        LOG_INFO_FMT("Connected to MQTT broker at  %1%", serverAddress);
+        LOG_INFO_FMT("Connected to MQTT broker at  %1%", transport->server_uri());
         return true;
     }
-    catch (const mqtt::exception &e)
-    {
-        LOG_WARN_FMT("Error connecting to MQTT broker:  %1%", e.what());
-        return false;
-    }
+    LOG_WARN_FMT("Error connecting to MQTT broker:  %1%", error);
+    return false;
 }
 
-// Publish a message to a topic
+/**
+ * @brief Queues a message for publishing and returns immediately.
+ *
+ * A retained message replaces any not yet sent value of the same topic. The
+ * sender thread performs the actual (QoS 1) publish, so protocol threads never
+ * wait on the broker. Delivery failures are counted and reported through the
+ * publish failure callback.
+ *
+ * @return false if the outbound queue is full and the message was dropped.
+ */
 bool MQTTClient::publish(const std::string &topic, const std::string &message, bool retained)
 {
-    std::lock_guard<std::mutex> lock(mqtt_mutex); // Lock the mutex for thread safety
-    try
     {
-        auto token = client.publish(topic, message, qos_level, retained);
-        if (!token->wait_for(std::chrono::seconds(2)))
+        std::lock_guard<std::mutex> lock(outbound_mutex);
+        if (retained)
         {
-            LOG_WARN("Publishing timed out!");
+            auto it = pending_retained.find(topic);
+            if (it != pending_retained.end())
+            {
+                it->second = message;
+                count_coalesced++;
+                return true;
+            }
+        }
+
+        if (outbound_queue.size() >= max_outbound_queue)
+        {
+            count_dropped++;
+            LATENCY_COUNT("mqtt.publish_dropped");
+            LOG_WARN_FMT("Outbound MQTT queue full, dropping message to topic: %1%", topic);
             return false;
         }
-        LOG_INFO_FMT("Message published to topic:  %1%", topic);
-        return true;
+
+        if (retained)
+        {
+            pending_retained[topic] = message;
+            outbound_queue.push_back({topic, std::string(), true, LatencyProbes::now_ns()});
+        }
+        else
+            outbound_queue.push_back({topic, message, false, LatencyProbes::now_ns()});
+        count_queued++;
     }
-    catch (const mqtt::exception &e)
+    outbound_cv.notify_one();
+    return true;
+}
+
+bool MQTTClient::flush(const std::chrono::milliseconds &timeout)
+{
+    std::unique_lock<std::mutex> lock(outbound_mutex);
+    return drained_cv.wait_for(lock, timeout, [this]()
+                               { return outbound_queue.empty() && in_flight == 0; });
+}
+
+MQTTClient::PublishStats MQTTClient::get_publish_stats()
+{
+    std::lock_guard<std::mutex> lock(outbound_mutex);
+    return {count_queued.load(), count_published.load(), count_failed.load(), count_dropped.load(), count_coalesced.load(), outbound_queue.size() + in_flight};
+}
+
+void MQTTClient::setPublishFailureCallback(const std::function<void(const std::string &topic, const std::string &error)> &callback)
+{
+    std::lock_guard<std::mutex> lock(outbound_mutex);
+    publish_failure_callback = callback;
+}
+
+// Sender thread: drains the outbound queue in batches
+void MQTTClient::senderLoop()
+{
+    ThreadScheduling::getInstance().apply_to_current_thread(ThreadRole::IO, "mqtt.sender");
+    while (true)
     {
-        LOG_WARN_FMT("Error publishing message:  %1%", e.what());
-        return false;
+        std::vector<OutboundMessage> batch;
+        {
+            std::unique_lock<std::mutex> lock(outbound_mutex);
+            outbound_cv.wait(lock, [this]()
+                             { return !outbound_queue.empty() || !senderRunning; });
+            if (outbound_queue.empty() && !senderRunning)
+                break;
+
+            while (!outbound_queue.empty() && batch.size() < max_publish_batch)
+            {
+                OutboundMessage msg = std::move(outbound_queue.front());
+                outbound_queue.pop_front();
+                if (msg.retained)
+                {
+                    auto it = pending_retained.find(msg.topic);
+                    msg.payload = std::move(it->second);
+                    pending_retained.erase(it);
+                }
+                batch.emplace_back(std::move(msg));
+            }
+            in_flight = batch.size();
+        }
+
+        deliver(batch);
+
+        {
+            std::lock_guard<std::mutex> lock(outbound_mutex);
+            in_flight = 0;
+            if (outbound_queue.empty())
+                drained_cv.notify_all();
+        }
     }
 }
 
-// Subscribe to a topic
-bool MQTTClient::subscribe(const std::string &topic)
+// Publish a batch and wait for all acknowledgements -- only ever blocks the sender thread
+void MQTTClient::deliver(std::vector<OutboundMessage> &batch)
 {
-    std::lock_guard<std::mutex> lock(mqtt_mutex); // Lock the mutex for thread safety
-    try
+    std::function<void(const std::string &, const std::string &)> on_failure;
     {
-        auto token = client.subscribe(topic, qos_level);
-        if (!token->wait_for(std::chrono::seconds(2)))
+        std::lock_guard<std::mutex> lock(outbound_mutex);
+        on_failure = publish_failure_callback;
+    }
+
+    auto report_failure = [this, &on_failure](const std::string &topic, const std::string &error)
+    {
+        count_failed++;
+        LATENCY_COUNT("mqtt.publish_failed");
+        LOG_WARN_FMT("Error publishing message to topic %1%: %2%", topic, error);
+        if (on_failure)
+            on_failure(topic, error);
+    };
+
+    std::vector<TransportMessage> messages;
+    messages.reserve(batch.size());
+    for (auto &msg : batch)
+    {
+        LATENCY_RECORD_SINCE("mqtt.publish_queue_delay", msg.enqueue_ns);
+        messages.push_back({std::move(msg.topic), std::move(msg.payload), msg.retained});
+    }
+
+    std::vector<std::string> errors;
+    transport->publish_batch(messages, Deadline(std::chrono::seconds(2)), errors);
+
+    for (size_t i = 0; i < messages.size(); ++i)
+    {
+        if (!errors[i].empty())
         {
-            LOG_WARN("Subscription timed out!");
-            return false;
+            report_failure(messages[i].topic, errors[i]);
+            continue;
         }
-        LOG_INFO_FMT("Subscribed to topic:  %1%", topic);
-        return true;
+        count_published++;
+        LOG_DEBUG_FMT("Message published to topic:  %1%", messages[i].topic);
     }
-    catch (const mqtt::exception &e)
+}
+
+// Subscribe to a topic
+bool MQTTClient::subscribe(const std::string &topic)
+{
+    std::lock_guard<std::mutex> lock(mqtt_mutex); // Lock the mutex for thread safety
+    std::string error;
+    if (!transport->subscribe(topic, Deadline(std::chrono::seconds(2)), error))
     {
-        LOG_WARN_FMT("Error subscribing to topic:  %1%", e.what());
+        LOG_WARN_FMT("Error subscribing to topic:  %1%", error);
         return false;
     }
+    LOG_INFO_FMT("Subscribed to topic:  %1%", topic);
+    return true;
 }
 
 void MQTTClient::unsubscribe(const std::string &topic)
 {
-    try
+    std::string error;
+    if (!transport->unsubscribe(topic, error))
     {
-        client.unsubscribe(topic)->wait();
-        callbacks.erase(topic);
-        LOG_INFO_FMT("Unsubscribed from topic: %1%", topic);
+        LOG_WARN_FMT("Error unsubscribing from topic: %1%", error);
+        return;
     }
-    catch (const mqtt::exception &e)
     {
-        LOG_WARN_FMT("Error unsubscribing from topic: %1%", e.what());
+        std::lock_guard<std::mutex> lock(callback_mutex);
+        callbacks.erase(topic);
+        filter_callbacks.erase(topic);
     }
+    LOG_INFO_FMT("Unsubscribed from topic: %1%", topic);
 }
 
 // Set a callback for incoming messages
 void MQTTClient::setCallback(const std::string &topic, const std::function<void(const std::string &)> &callback, bool run_in_thread)
 {
-    std::lock_guard<std::mutex> lock(callback_mutex); // Lock the static mutex for thread safety
-    callbacks[topic] = std::make_pair(callback, run_in_thread);
+    {
+        std::lock_guard<std::mutex> lock(callback_mutex); // Lock the static mutex for thread safety
+        callbacks[topic] = std::make_pair(callback, run_in_thread);
+    }
+
+    // subscribe outside the registry lock, incoming messages must not wait on the broker
     if (!subscribe(topic))
+    {
+        std::lock_guard<std::mutex> lock(callback_mutex);
         callbacks.erase(topic);
+    }
+}
+
+void MQTTClient::setFilterCallback(const std::string &topic_filter, const std::function<void(const std::string &, const std::string &)> &callback, bool run_in_thread)
+{
+    {
+        std::lock_guard<std::mutex> lock(callback_mutex);
+        filter_callbacks[topic_filter] = std::make_pair(callback, run_in_thread);
+    }
+
+    if (!subscribe(topic_filter))
+    {
+        std::lock_guard<std::mutex> lock(callback_mutex);
+        filter_callbacks.erase(topic_filter);
+    }
 }
 
 // Internal callback function that processes incoming messages
 void MQTTClient::onMessage(const std::string &topic, const std::string &payload)
 {
-    std::lock_guard<std::mutex> lock(callback_mutex); // Lock the static mutex for thread safety
-    auto it = callbacks.find(topic);
-    if (it != callbacks.end())
+    std::function<void(const std::string &)> callback;
+    bool run_in_thread;
     {
-        if (!pause_callbacks)
-        { // Check if this callback should run in a separate thread
-            if (it->second.second)
-            {
-                // Run the callback in a separate thread
-                std::thread([callback = it->second.first, payload]()
-                            { callback(payload); })
-                    .detach(); // Detach the thread to let it run independently
-            }
-            else
+        std::lock_guard<std::mutex> lock(callback_mutex); // Lock the static mutex for thread safety
+        auto it = callbacks.find(topic);
+        if (it != callbacks.end())
+        {
+            callback = it->second.first;
+            run_in_thread = it->second.second;
+        }
+        else
+        {
+            for (const auto &item : filter_callbacks)
             {
-                // Run the callback on the main thread (blocking)
-                it->second.first(payload);
+                if (MQTTTransport::topic_matches(item.first, topic))
+                {
+                    auto filter_callback = item.second.first;
+                    callback = [filter_callback, topic](const std::string &msg)
+                    { filter_callback(topic, msg); };
+                    run_in_thread = item.second.second;
+                    break;
+                }
             }
         }
-        else
-            LOG_WARN("Callback are pause for the moment...");
+        if (!callback)
+        {
+            LOG_WARN_FMT("No callback set for topic:  %1%", topic);
+            return;
+        }
+    }
+
+    if (pause_callbacks)
+    {
+        LOG_WARN("Callback are pause for the moment...");
+        return;
     }
+
+    if (run_in_thread)
+        dispatch(topic, callback, payload); // handled by the dispatcher pool
     else
+        callback(payload); // Run the callback on the MQTT client thread (blocking)
+}
+
+// Queue a message on its topic FIFO and schedule the topic if it is idle
+void MQTTClient::dispatch(const std::string &topic, const std::function<void(const std::string &)> &callback, const std::string &payload)
+{
     {
-        LOG_WARN_FMT("No callback set for topic:  %1%", topic);
+        std::lock_guard<std::mutex> lock(dispatch_mutex);
+        TopicQueue &queue = topic_queues[topic];
+        queue.callback = callback;
+        queue.payloads.emplace_back(payload, LatencyProbes::now_ns());
+        count_dispatched++;
+        dispatch_depth++;
+        max_dispatch_depth = std::max(max_dispatch_depth, dispatch_depth);
+        if (queue.scheduled)
+            return;
+        queue.scheduled = true;
+        ready_topics.push_back(topic);
     }
+    dispatch_cv.notify_one();
+}
+
+void MQTTClient::dispatchLoop()
+{
+    while (true)
+    {
+        std::string topic;
+        std::function<void(const std::string &)> callback;
+        std::pair<std::string, int64_t> item;
+        {
+            std::unique_lock<std::mutex> lock(dispatch_mutex);
+            dispatch_cv.wait(lock, [this]()
+                             { return !ready_topics.empty() || !dispatchRunning; });
+            if (!dispatchRunning)
+                break;
+
+            topic = std::move(ready_topics.front());
+            ready_topics.pop_front();
+            TopicQueue &queue = topic_queues[topic];
+            item = std::move(queue.payloads.front());
+            queue.payloads.pop_front();
+            callback = queue.callback;
+            dispatch_depth--;
+            busy_workers++;
+        }
+
+        LATENCY_RECORD_SINCE("mqtt.dispatch_wait", item.second);
+        int64_t start_ns = LatencyProbes::now_ns();
+        try
+        {
+            callback(item.first);
+        }
+        catch (const std::exception &e)
+        {
+            LOG_WARN_FMT("Exception in callback for topic %1%: %2%", topic, e.what());
+        }
+        LATENCY_RECORD_SINCE("mqtt.handler", start_ns);
+
+        {
+            std::lock_guard<std::mutex> lock(dispatch_mutex);
+            busy_workers--;
+            count_handled++;
+            TopicQueue &queue = topic_queues[topic];
+            if (queue.payloads.empty())
+                queue.scheduled = false;
+            else
+                ready_topics.push_back(topic); // next message of this topic, behind other ready topics
+        }
+        dispatch_cv.notify_one();
+    }
+}
+
+MQTTClient::DispatchStats MQTTClient::get_dispatch_stats()
+{
+    std::lock_guard<std::mutex> lock(dispatch_mutex);
+    return {count_dispatched, count_handled, dispatch_depth, max_dispatch_depth, busy_workers};
 }
 
 // Start listening on a separate thread
@@ -162,20 +427,24 @@ void MQTTClient::startListening()
 // Stop listening thread
 void MQTTClient::stopListening()
 {
-    isRunning = false;
+    {
+        std::lock_guard<std::mutex> lock(listen_mutex);
+        isRunning = false;
+    }
+    listen_cv.notify_all();
     if (mqttThread.joinable())
     {
         mqttThread.join();
     }
 }
 
-// Loop to listen for messages
+// Messages arrive through the paho callback; this thread only lives until stopListening
 void MQTTClient::listenLoop()
 {
-    while (isRunning)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
+    ThreadScheduling::getInstance().apply_to_current_thread(ThreadRole::IO, "mqtt.listener");
+    std::unique_lock<std::mutex> lock(listen_mutex);
+    listen_cv.wait(lock, [this]()
+                   { return !isRunning; });
 }
 
 // Function to get the current time as a string
@@ -192,14 +461,127 @@ std::string MQTTClient::getCurrentTimeString() const
 
 std::string MQTTClient::timestamp_float_data(const float &data)
 {
-    std::string text = "{\"value\": \"" + floatToStringWithPrecision(data, 8) + "\", \"time\": \"" + getCurrentTimeString() + "\"}";
-    return text;
+    if (payload_format == PayloadFormat::JSON)
+    {
+        std::string text = "{\"value\": \"" + floatToStringWithPrecision(data, 8) + "\", \"time\": \"" + getCurrentTimeString() + "\"}";
+        return text;
+    }
+    json record;
+    record["value"] = data;
+    return encode_payload(std::move(record));
 }
 
 std::string MQTTClient::timestamp_str_data(const std::string &data)
 {
-    std::string text = "{\"value\": \"" + data + "\", \"time\": \"" + getCurrentTimeString() + "\"}";
-    return text;
+    if (payload_format == PayloadFormat::JSON)
+    {
+        std::string text = "{\"value\": \"" + data + "\", \"time\": \"" + getCurrentTimeString() + "\"}";
+        return text;
+    }
+    json record;
+    record["value"] = data;
+    return encode_payload(std::move(record));
+}
+
+bool MQTTClient::parsePayloadFormat(const std::string &name, PayloadFormat &format)
+{
+    if (name == "json")
+        format = PayloadFormat::JSON;
+    else if (name == "cbor")
+        format = PayloadFormat::CBOR;
+    else
+        return false;
+    return true;
+}
+
+void MQTTClient::setPayloadFormat(const PayloadFormat &format)
+{
+    payload_format = format;
+}
+
+void MQTTClient::setTickSource(const std::function<int64_t()> &source, const double &rate)
+{
+    std::lock_guard<std::mutex> lock(tick_mutex);
+    tick_source = source;
+    tick_rate = rate;
+}
+
+std::string MQTTClient::encode_payload(json data)
+{
+    if (payload_format == PayloadFormat::JSON)
+    {
+        data["time"] = getCurrentTimeString();
+        return data.dump();
+    }
+
+    int64_t ticks;
+    double rate;
+    {
+        std::lock_guard<std::mutex> lock(tick_mutex);
+        ticks = tick_source ? tick_source() : LatencyProbes::now_ns();
+        rate = tick_rate;
+    }
+    data["v"] = payload_schema_version;
+    data["t"] = ticks;
+    data["tr"] = rate;
+
+    std::vector<uint8_t> cbor = json::to_cbor(data);
+    return std::string(cbor.begin(), cbor.end());
+}
+
+bool MQTTClient::decode_payload(const std::string &payload, json &data)
+{
+    try
+    {
+        // a CBOR map starts with major type 5 (0xa0 - 0xbf), never a valid first byte of JSON text
+        uint8_t first_byte = payload.empty() ? 0 : uint8_t(payload[0]);
+        if (first_byte >= 0xa0 && first_byte <= 0xbf)
+            data = json::from_cbor(payload);
+        else
+            data = json::parse(payload);
+        return true;
+    }
+    catch (const json::exception &e)
+    {
+        LOG_WARN_FMT("MQTT >> payload decoding error : %1%", e.what());
+        return false;
+    }
+}
+
+bool MQTTClient::payload_value(const std::string &payload, float &value)
+{
+    json data;
+    if (!decode_payload(payload, data) || !data.is_object() || !data.contains("value"))
+        return false;
+
+    const json &jval = data["value"];
+    if (jval.is_number())
+    {
+        value = jval.get<float>();
+        return true;
+    }
+    if (jval.is_string())
+    {
+        try
+        {
+            value = std::stof(jval.get<std::string>());
+            return true;
+        }
+        catch (const std::exception &e)
+        {
+            LOG_WARN_FMT("MQTT >> value is not a number : %1%", jval.get<std::string>());
+        }
+    }
+    return false;
+}
+
+bool MQTTClient::payload_value(const std::string &payload, std::string &value)
+{
+    json data;
+    if (!decode_payload(payload, data) || !data.is_object() || !data.contains("value") || !data["value"].is_string())
+        return false;
+    value = data["value"].get<std::string>();
+    return true;
 }
 
 /**
@@ -216,30 +598,20 @@ std::string MQTTClient::timestamp_str_data(const std::string &data)
  */
 bool MQTTClient::temporary_listen_for_last_value(std::string &val, const std::string &topic, const float &wait_count, const size_t &wait_time)
 {
-    // create a callback
-    bool got_val;
-    std::function<void(const std::string &)> callback = [&val, &got_val](const std::string &payload)
+    // the callback only publishes the value, this thread waits on it until the deadline
+    auto last_value = std::make_shared<AwaitableValue<std::string>>();
+    std::function<void(const std::string &)> callback = [last_value](const std::string &payload)
     {
-        // Parse the JSON payload
         json jdata;
-        try
-        {
-            jdata = json::parse(payload);
-            val = jdata["value"];
-            got_val = true;
-        }
-        catch (json::exception &e)
-        {
-            LOG_WARN_FMT("JSON parse error : %1%", e.what());
-        }
+        if (!decode_payload(payload, jdata) || !jdata.contains("value"))
+            return;
+        // numeric values of CBOR payloads are returned in text form
+        const json &jval = jdata["value"];
+        last_value->set(jval.is_string() ? jval.get<std::string>() : jval.dump());
     };
     setCallback(topic, callback);
-    size_t timer = 0;
-    while (got_val == false && timer < wait_count)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(wait_time));
-        timer++;
-    }
+    uint64_t seen_version = 0;
+    bool got_val = last_value->wait_next(val, seen_version, Deadline(std::chrono::milliseconds(size_t(wait_count * wait_time))));
     unsubscribe(topic);
     return got_val;
 }
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include "loopback_broker.hpp"
+#include "thread_sched.hpp"
+
+std::shared_ptr<LoopbackBroker> LoopbackBroker::get(const std::string &name)
+{
+    static std::mutex registry_mutex;
+    static std::map<std::string, std::shared_ptr<LoopbackBroker>> brokers;
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto &broker = brokers[name];
+    if (!broker)
+        broker = std::make_shared<LoopbackBroker>();
+    return broker;
+}
+
+void LoopbackBroker::attach(const std::string &client_id, LoopbackTransport *session)
+{
+    std::lock_guard<std::mutex> lock(broker_mutex);
+    auto it = sessions.find(client_id);
+    if (it != sessions.end() && it->second.transport != session)
+    {
+        LOG_WARN_FMT("Loopback broker: client %1% connected twice, taking over session.", client_id);
+        it->second.transport->on_session_taken_over();
+    }
+    sessions[client_id] = Session{session, {}};
+}
+
+void LoopbackBroker::detach(const std::string &client_id, LoopbackTransport *session)
+{
+    std::lock_guard<std::mutex> lock(broker_mutex);
+    auto it = sessions.find(client_id);
+    if (it != sessions.end() && it->second.transport == session)
+        sessions.erase(it);
+}
+
+bool LoopbackBroker::publish(const std::string &topic, const std::string &payload, const bool &retained)
+{
+    if (topic.empty() || topic.find_first_of("+#") != std::string::npos)
+        return false;
+
+    std::lock_guard<std::mutex> lock(broker_mutex);
+    if (retained)
+    {
+        if (payload.empty())
+            retained_messages.erase(topic);
+        else
+            retained_messages[topic] = payload;
+    }
+
+    // overlapping filters of one session deliver the message only once
+    for (auto &item : sessions)
+    {
+        for (const auto &topic_filter : item.second.topic_filters)
+        {
+            if (MQTTTransport::topic_matches(topic_filter, topic))
+            {
+                item.second.transport->enqueue(topic, payload);
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+void LoopbackBroker::subscribe(const std::string &client_id, const std::string &topic_filter)
+{
+    std::lock_guard<std::mutex> lock(broker_mutex);
+    auto it = sessions.find(client_id);
+    if (it == sessions.end())
+        return;
+
+    it->second.topic_filters.insert(topic_filter);
+
+    // retained messages are sent on every (re-)subscription
+    for (const auto &item : retained_messages)
+        if (MQTTTransport::topic_matches(topic_filter, item.first))
+            it->second.transport->enqueue(item.first, item.second);
+}
+
+void LoopbackBroker::unsubscribe(const std::string &client_id, const std::string &topic_filter)
+{
+    std::lock_guard<std::mutex> lock(broker_mutex);
+    auto it = sessions.find(client_id);
+    if (it != sessions.end())
+        it->second.topic_filters.erase(topic_filter);
+}
+
+size_t LoopbackBroker::num_retained()
+{
+    std::lock_guard<std::mutex> lock(broker_mutex);
+    return retained_messages.size();
+}
+
+LoopbackTransport::LoopbackTransport(const std::string &broker_name, const std::string &client_id)
+    : broker_name(broker_name), client_id(client_id), broker(LoopbackBroker::get(broker_name)) {}
+
+LoopbackTransport::~LoopbackTransport()
+{
+    disconnect();
+}
+
+void LoopbackTransport::set_message_handler(const MessageHandler &handler)
+{
+    message_handler = handler;
+}
+
+// the in-process broker is always reachable
+bool LoopbackTransport::connect([[maybe_unused]] std::string &error)
+{
+    if (connected)
+        return true;
+
+    {
+        std::lock_guard<std::mutex> lock(inbound_mutex);
+        if (!deliveryRunning)
+        {
+            deliveryRunning = true;
+            deliveryThread = boost::thread(&LoopbackTransport::deliveryLoop, this);
+        }
+    }
+
+    broker->attach(client_id, this);
+    connected = true;
+    return true;
+}
+
+void LoopbackTransport::disconnect()
+{
+    broker->detach(client_id, this);
+    connected = false;
+
+    {
+        std::lock_guard<std::mutex> lock(inbound_mutex);
+        deliveryRunning = false;
+    }
+    inbound_cv.notify_all();
+    if (deliveryThread.joinable() && deliveryThread.get_id() != boost::this_thread::get_id())
+        deliveryThread.join();
+}
+
+void LoopbackTransport::publish_batch(const std::vector<TransportMessage> &batch, const Deadline &deadline, std::vector<std::string> &errors)
+{
+    // delivery is immediate, the deadline only fails messages that are late already -- as a broker
+    // that stopped acknowledging would
+    errors.assign(batch.size(), std::string());
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        if (!connected)
+            errors[i] = "not connected to loopback broker";
+        else if (deadline.expired())
+            errors[i] = "publishing timed out";
+        else if (!broker->publish(batch[i].topic, batch[i].payload, batch[i].retained))
+            errors[i] = "invalid topic name";
+    }
+}
+
+bool LoopbackTransport::subscribe(const std::string &topic_filter, const Deadline &deadline, std::string &error)
+{
+    if (!connected)
+    {
+        error = "not connected to loopback broker";
+        return false;
+    }
+    if (deadline.expired())
+    {
+        error = "subscription timed out";
+        return false;
+    }
+    broker->subscribe(client_id, topic_filter);
+    return true;
+}
+
+bool LoopbackTransport::unsubscribe(const std::string &topic_filter, std::string &error)
+{
+    if (!connected)
+    {
+        error = "not connected to loopback broker";
+        return false;
+    }
+    broker->unsubscribe(client_id, topic_filter);
+    return true;
+}
+
+void LoopbackTransport::enqueue(const std::string &topic, const std::string &payload)
+{
+    {
+        std::lock_guard<std::mutex> lock(inbound_mutex);
+        inbound_queue.emplace_back(topic, payload);
+    }
+    inbound_cv.notify_one();
+}
+
+void LoopbackTransport::on_session_taken_over()
+{
+    connected = false;
+}
+
+void LoopbackTransport::deliveryLoop()
+{
+    ThreadScheduling::getInstance().apply_to_current_thread(ThreadRole::IO, "mqtt.loopback_delivery");
+    while (true)
+    {
+        std::pair<std::string, std::string> msg;
+        {
+            std::unique_lock<std::mutex> lock(inbound_mutex);
+            inbound_cv.wait(lock, [this]()
+                            { return !inbound_queue.empty() || !deliveryRunning; });
+            if (!deliveryRunning)
+                break;
+            msg = std::move(inbound_queue.front());
+            inbound_queue.pop_front();
+        }
+
+        if (message_handler)
+            message_handler(msg.first, msg.second);
+    }
+}
@@ -0,0 +1,155 @@
+#include "mqtt_transport.hpp"
+#include "loopback_broker.hpp"
+
+static const int qos_level = 1;
+static const std::string loopback_scheme = "loopback://";
+
+std::unique_ptr<MQTTTransport> MQTTTransport::create(const std::string &server_uri, const std::string &client_id)
+{
+    if (server_uri.compare(0, loopback_scheme.size(), loopback_scheme) == 0)
+        return std::make_unique<LoopbackTransport>(server_uri.substr(loopback_scheme.size()), client_id);
+    else
+        return std::make_unique<PahoTransport>(server_uri, client_id);
+}
+
+// MQTT topic filter matching: '+' matches one level, a trailing '#' matches any
+// number of levels (including the parent); wildcards never match '$' topics.
+bool MQTTTransport::topic_matches(const std::string &topic_filter, const std::string &topic)
+{
+    if (!topic.empty() && topic[0] == '$' && !topic_filter.empty() && (topic_filter[0] == '+' || topic_filter[0] == '#'))
+        return false;
+
+    size_t f = 0, t = 0;
+    while (f <= topic_filter.size())
+    {
+        size_t f_end = topic_filter.find('/', f);
+        if (f_end == std::string::npos)
+            f_end = topic_filter.size();
+        std::string level = topic_filter.substr(f, f_end - f);
+
+        if (level == "#")
+            return true;
+
+        if (t > topic.size())
+            return false;
+        size_t t_end = topic.find('/', t);
+        if (t_end == std::string::npos)
+            t_end = topic.size();
+
+        if (level != "+" && level != topic.substr(t, t_end - t))
+            return false;
+
+        f = f_end + 1;
+        t = t_end + 1;
+    }
+    return t > topic.size();
+}
+
+PahoTransport::PahoTransport(const std::string &server_uri, const std::string &client_id)
+    : uri(server_uri), client(server_uri, client_id)
+{
+    connectOptions.set_clean_session(true);
+    connectOptions.set_keep_alive_interval(60);
+}
+
+void PahoTransport::set_message_handler(const MessageHandler &handler)
+{
+    client.set_message_callback([handler](mqtt::const_message_ptr msg)
+                                { handler(msg->get_topic(), msg->to_string()); });
+}
+
+bool PahoTransport::connect(std::string &error)
+{
+    try
+    {
+        client.connect(connectOptions)->wait();
+        return true;
+    }
+    catch (const mqtt::exception &e)
+    {
+        error = e.what();
+        return false;
+    }
+}
+
+void PahoTransport::disconnect()
+{
+    try
+    {
+        if (client.is_connected())
+            client.disconnect()->wait_for(std::chrono::seconds(2));
+    }
+    catch (const mqtt::exception &e)
+    {
+        LOG_WARN_FMT("Error disconnecting from MQTT broker: %1%", e.what());
+    }
+}
+
+void PahoTransport::publish_batch(const std::vector<TransportMessage> &batch, const Deadline &deadline, std::vector<std::string> &errors)
+{
+    errors.assign(batch.size(), std::string());
+
+    // send everything first so the acknowledgements overlap
+    std::vector<mqtt::delivery_token_ptr> tokens(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        try
+        {
+            tokens[i] = client.publish(batch[i].topic, batch[i].payload, qos_level, batch[i].retained);
+        }
+        catch (const mqtt::exception &e)
+        {
+            errors[i] = e.what();
+        }
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        if (!tokens[i])
+            continue;
+        try
+        {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline.time_point() - std::chrono::steady_clock::now());
+            if (!tokens[i]->wait_for(std::max(remaining, std::chrono::milliseconds(0))))
+                errors[i] = "publishing timed out";
+        }
+        catch (const mqtt::exception &e)
+        {
+            errors[i] = e.what();
+        }
+    }
+}
+
+bool PahoTransport::subscribe(const std::string &topic_filter, const Deadline &deadline, std::string &error)
+{
+    try
+    {
+        auto token = client.subscribe(topic_filter, qos_level);
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline.time_point() - std::chrono::steady_clock::now());
+        if (!token->wait_for(std::max(remaining, std::chrono::milliseconds(0))))
+        {
+            error = "subscription timed out";
+            return false;
+        }
+        return true;
+    }
+    catch (const mqtt::exception &e)
+    {
+        error = e.what();
+        return false;
+    }
+}
+
+bool PahoTransport::unsubscribe(const std::string &topic_filter, std::string &error)
+{
+    try
+    {
+        client.unsubscribe(topic_filter)->wait();
+        return true;
+    }
+    catch (const mqtt::exception &e)
+    {
+        error = e.what();
+        return false;
+    }
+}
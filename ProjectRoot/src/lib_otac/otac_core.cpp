@@ -0,0 +1,151 @@
+#include "otac_core.hpp"
+
+OtacWaveforms OtacWaveforms::generate(const size_t &otac_wf_len)
+{
+    OtacWaveforms waveforms;
+    WaveformGenerator wf_gen;
+
+    wf_gen.initialize(wf_gen.UNIT_RAND, 2 * otac_wf_len, 1, 0, 2 * otac_wf_len, 1, 1.0, otac_seed);
+    waveforms.otac = wf_gen.generate_waveform();
+
+    wf_gen.initialize(wf_gen.UNIT_RAND, otac_wf_len, 1, 0, 0, 1, 1.0, fs_seed);
+    waveforms.fs = wf_gen.generate_waveform();
+
+    // OTAC frame = full-scale prefix, zero padding, OTAC segment (see OTAC_class::transmission_otac)
+    waveforms.segment_len = 2 * otac_wf_len;
+    waveforms.segment_offset = waveforms.fs.size() + waveforms.otac.size() - waveforms.segment_len;
+    return waveforms;
+}
+
+bool OtacScaling::pre_process(const float &input, const float &ctol, const float &full_scale, float &sig_scale) const
+{
+    if (input < dmin or input > dmax)
+        return false;
+
+    float sig_input_pow = (input - dmin) / (dmax - dmin);
+    float post_scaling = std::min<float>(full_scale / std::sqrt(ctol / min_e2e_pow), 1.0);
+    sig_scale = sqrt(sig_input_pow) * post_scaling;
+    return true;
+}
+
+bool OtacScaling::post_process(const float &sig_power, const float &noise_power, float &out_val) const
+{
+    out_val = sig_power - noise_power;
+    out_val *= (dmax - dmin) / min_e2e_pow;
+    out_val += dmin * num_leafs;
+
+    return out_val >= dmin * num_leafs and out_val <= dmax * num_leafs;
+}
+
+float OtacScaling::nmse(const float &val1, const float &val2)
+{
+    return sqrt(std::norm((val1 - val2)) / std::norm(val1));
+}
+
+// mean of |x|^2 -- independent partial sums over the interleaved floats let the compiler vectorize
+static float mean_power(const std::complex<float> *samples, const size_t &num_samples)
+{
+    const float *vals = reinterpret_cast<const float *>(samples);
+    const size_t num_vals = 2 * num_samples;
+    float partial[8] = {0.0f};
+    size_t i = 0;
+    for (; i + 8 <= num_vals; i += 8)
+        for (size_t j = 0; j < 8; ++j)
+            partial[j] += vals[i + j] * vals[i + j];
+
+    float total = 0.0f;
+    for (; i < num_vals; ++i)
+        total += vals[i] * vals[i];
+    for (size_t j = 0; j < 8; ++j)
+        total += partial[j];
+    return total / num_samples;
+}
+
+OtacDetector::OtacDetector(const OtacWaveforms &waveforms, const size_t &window_len, const int &num_fft_threads)
+    : max_window_len(window_len),
+      segment_offset(waveforms.segment_offset),
+      segment_len(waveforms.segment_len),
+      frame_len(waveforms.frame_len())
+{
+    size_t fs_len = waveforms.fs.size();
+    while (fft_L < max_window_len + fs_len - 1)
+        fft_L *= 2;
+
+    fft = std::make_unique<FFTWrapper>();
+    fft->initialize(fft_L, num_fft_threads);
+
+    std::vector<std::complex<float>> padded_fs;
+    fft->zeroPad(waveforms.fs, padded_fs, fft_L);
+    fft->fft(padded_fs, fs_fft_conj);
+    for (auto &val : fs_fft_conj)
+        val = std::conj(val);
+
+    fft_in.resize(fft_L);
+    fft_out.resize(fft_L);
+    corr_pow.reserve(max_window_len);
+}
+
+OtacDetector::Detection OtacDetector::detect(const std::vector<std::complex<float>> &signal)
+{
+    Detection result;
+    if (signal.size() < frame_len or signal.size() > max_window_len)
+    {
+        LOG_WARN_FMT("OTAC detector is not set up for a window of %1% samples.", signal.size());
+        return result;
+    }
+
+    // cross-correlation with the full-scale prefix, corr[k] = sum_n signal[k + n] * conj(fs[n])
+    std::copy(signal.begin(), signal.end(), fft_in.begin());
+    std::fill(fft_in.begin() + signal.size(), fft_in.end(), std::complex<float>(0.0, 0.0));
+    fft->fft(fft_in, fft_out);
+    for (size_t i = 0; i < fft_L; ++i)
+        fft_out[i] *= fs_fft_conj[i];
+    fft->ifft(fft_out, fft_in);
+
+    // only lags at which the complete frame lies inside the window
+    size_t num_lags = signal.size() - frame_len + 1;
+    corr_pow.resize(num_lags);
+    for (size_t k = 0; k < num_lags; ++k)
+        corr_pow[k] = std::norm(fft_in[k]);
+
+    size_t peak = std::max_element(corr_pow.begin(), corr_pow.end()) - corr_pow.begin();
+
+    // confidence against the mean correlation power away from the peak
+    double off_peak_sum = 0.0;
+    size_t off_peak_count = 0;
+    for (size_t k = 0; k < num_lags; ++k)
+    {
+        if (k + 1 >= peak and k <= peak + 1)
+            continue;
+        off_peak_sum += corr_pow[k];
+        off_peak_count++;
+    }
+    if (off_peak_count == 0 or off_peak_sum <= 0.0)
+        return result;
+    result.confidence = corr_pow[peak] / float(off_peak_sum / off_peak_count);
+    if (result.confidence < min_confidence)
+        return result;
+
+    // sub-sample frame start from a parabola through the correlation magnitudes around the peak
+    float frac_offset = 0.0;
+    if (peak > 0 and peak + 1 < num_lags)
+    {
+        float y_prev = std::sqrt(corr_pow[peak - 1]);
+        float y_peak = std::sqrt(corr_pow[peak]);
+        float y_next = std::sqrt(corr_pow[peak + 1]);
+        float denom = y_prev - 2 * y_peak + y_next;
+        if (denom < 0.0)
+            frac_offset = 0.5 * (y_prev - y_next) / denom;
+    }
+
+    result.detected = true;
+    result.signal_power = mean_power(signal.data() + peak + segment_offset, segment_len);
+    if (signal.size() > frame_len)
+    {
+        double window_energy = double(mean_power(signal.data(), signal.size())) * signal.size();
+        double frame_energy = double(mean_power(signal.data() + peak, frame_len)) * frame_len;
+        result.noise_power = std::max(window_energy - frame_energy, 0.0) / (signal.size() - frame_len);
+    }
+    result.frame_start = peak + frac_offset;
+    return result;
+}
@@ -7,24 +7,23 @@
 
 OTAC_class::OTAC_class(
     USRP_class &usrp_obj_,
-    ConfigParser &parser_,
+    std::shared_ptr<const Config> config_,
     const std::string &device_id_,
     const std::string &device_type_,
     const float &otac_input_,
     const float &dmin_,
     const float &dmax_,
     const size_t &num_leafs_,
-    bool &signal_stop_called_) : usrp_obj(&usrp_obj_),
-                                 parser(parser_),
-                                 device_id(device_id_),
-                                 device_type(device_type_),
+    bool &signal_stop_called_) : signal_stop_called(signal_stop_called_),
                                  otac_input(otac_input_),
                                  dmin(dmin_),
                                  dmax(dmax_),
                                  num_leafs(num_leafs_),
-                                 signal_stop_called(signal_stop_called_),
+                                 usrp_obj(&usrp_obj_),
+                                 config(config_),
                                  csd_obj(nullptr),
-                                 peak_det_obj(nullptr) {};
+                                 device_id(device_id_),
+                                 device_type(device_type_) {};
 
 OTAC_class::~OTAC_class()
 {
@@ -32,6 +31,12 @@ OTAC_class::~OTAC_class()
         producer_thread.join();
     if (consumer_thread.joinable())
         consumer_thread.join();
+    for (auto &thread : channel_consumer_threads)
+        if (thread.joinable())
+            thread.join();
+    if (ref_scheduler_thread.joinable())
+        ref_scheduler_thread.join();
+    stop_detection_workers();
 }
 
 void OTAC_class::stop()
@@ -42,21 +47,17 @@ void OTAC_class::stop()
     delete this;
 }
 
-void OTAC_class::initialize_peak_det_obj()
+void OTAC_class::initialize_csd_obj()
 {
     float noise_ampl = usrp_obj->init_noise_ampl;
     noise_power = std::norm(noise_ampl);
-    peak_det_obj = std::make_unique<PeakDetectionClass>(parser, noise_ampl);
-}
-
-void OTAC_class::initialize_csd_obj()
-{
-    size_t capacity = std::pow(2.0, parser.getValue_int("capacity-pow"));
-    min_e2e_pow = std::norm(parser.getValue_float("min-e2e-amp"));
-    max_e2e_pow = std::norm(parser.getValue_float("max-e2e-amp"));
-    double rx_sample_duration_float = 1 / parser.getValue_float("rate");
+    rx_combining = parse_rx_combining(config->rx_combining);
+    size_t capacity = std::pow(2.0, config->capacity_pow);
+    min_e2e_pow = std::norm(config->min_e2e_amp);
+    max_e2e_pow = std::norm(config->max_e2e_amp);
+    double rx_sample_duration_float = 1 / config->rate;
     uhd::time_spec_t rx_sample_duration = uhd::time_spec_t(rx_sample_duration_float);
-    csd_obj = std::make_unique<CycleStartDetector>(parser, capacity, rx_sample_duration, *peak_det_obj);
+    csd_obj = std::make_unique<MultiChannelCSD>(config, capacity, rx_sample_duration, usrp_obj->master_clock_rate, noise_ampl, usrp_obj->num_rx_channels(), rx_combining);
 }
 
 void OTAC_class::get_mqtt_topics()
@@ -70,20 +71,23 @@ void OTAC_class::get_mqtt_topics()
 void OTAC_class::generate_waveform()
 {
     WaveformGenerator wf_gen;
-    size_t N_zfc = parser.getValue_int("Ref-N-zfc");
-    size_t q_zfc = parser.getValue_int("Ref-m-zfc");
-    size_t reps_zfc = parser.getValue_int("Ref-R-zfc"); // extra long ref signal for stability
-    size_t wf_pad = size_t(parser.getValue_int("Ref-padding-mul") * N_zfc);
+    size_t N_zfc = config->ref_n_zfc;
+    size_t q_zfc = config->ref_m_zfc;
+    size_t reps_zfc = config->ref_r_zfc; // extra long ref signal for stability
+    size_t wf_pad = size_t(config->ref_padding_mul * N_zfc);
 
     wf_gen.initialize(wf_gen.ZFC, N_zfc, reps_zfc, 0, wf_pad, q_zfc, 1.0, 0);
     ref_waveform = wf_gen.generate_waveform();
 
-    size_t otac_wf_len = parser.getValue_int("test-signal-len");
-    wf_gen.initialize(wf_gen.UNIT_RAND, 2 * otac_wf_len, 1, 0, 2 * otac_wf_len, 1, 1.0, 1);
-    otac_waveform = wf_gen.generate_waveform();
+    otac_waveforms = OtacWaveforms::generate(config->test_signal_len);
+}
 
-    wf_gen.initialize(wf_gen.UNIT_RAND, otac_wf_len, 1, 0, 0, 1, 1.0, 1);
-    fs_waveform = wf_gen.generate_waveform();
+void OTAC_class::initialize_otac_detector()
+{
+    size_t otac_window_len = 10 * config->test_signal_len; // see producer_cent_proto
+    otac_detectors.clear();
+    for (size_t ch = 0; ch < usrp_obj->num_rx_channels(); ++ch)
+        otac_detectors.emplace_back(std::make_unique<OtacDetector>(otac_waveforms, otac_window_len, int(config->num_fft_threads)));
 }
 
 bool OTAC_class::initialize()
@@ -91,9 +95,10 @@ bool OTAC_class::initialize()
     csd_success_flag = false;
     try
     {
-        initialize_peak_det_obj();
         initialize_csd_obj();
         generate_waveform();
+        if (device_type == "cent")
+            initialize_otac_detector();
         get_mqtt_topics();
 
         // MQTTClient &mqttClient = MQTTClient::getInstance(device_id);
@@ -122,21 +127,36 @@ bool OTAC_class::initialize()
 
 void OTAC_class::run_proto()
 {
+    ThreadScheduling &sched = ThreadScheduling::getInstance();
     if (device_type == "leaf")
     {
         producer_thread = boost::thread(&OTAC_class::producer_leaf_proto, this);
-        consumer_thread = boost::thread(&OTAC_class::consumer_leaf_proto, this);
+        consumer_thread = boost::thread(&OTAC_class::consumer_leaf_proto, this, 0);
+        for (size_t ch = 1; ch < csd_obj->num_channels(); ++ch)
+            channel_consumer_threads.emplace_back(&OTAC_class::consumer_leaf_proto, this, ch);
+
+        sched.apply(producer_thread, ThreadRole::RX, "otac.leaf.producer");
+        sched.apply(consumer_thread, ThreadRole::DSP, "otac.leaf.consumer");
+        for (size_t ch = 1; ch <= channel_consumer_threads.size(); ++ch)
+            sched.apply(channel_consumer_threads[ch - 1], ThreadRole::DSP, "otac.leaf.consumer.ch" + std::to_string(ch));
     }
     else if (device_type == "cent")
     {
+        pipeline_stats.start_ns = LatencyProbes::now_ns();
+        start_detection_workers();
+        ref_scheduler_thread = boost::thread(&OTAC_class::ref_scheduler_cent_proto, this);
         producer_thread = boost::thread(&OTAC_class::producer_cent_proto, this);
         consumer_thread = boost::thread(&OTAC_class::consumer_cent_proto, this);
+
+        sched.apply(ref_scheduler_thread, ThreadRole::TX, "otac.cent.ref_scheduler");
+        sched.apply(producer_thread, ThreadRole::RX, "otac.cent.producer");
+        sched.apply(consumer_thread, ThreadRole::DSP, "otac.cent.consumer");
     }
 };
 
 float OTAC_class::compute_nmse(const float &val1, const float &val2)
 {
-    return sqrt(std::norm((val1 - val2)) / std::norm(val1));
+    return OtacScaling::nmse(val1, val2);
 }
 
 bool OTAC_class::check_ctol()
@@ -153,7 +173,7 @@ bool OTAC_class::check_ctol()
         usrp_obj->set_rx_gain(impl_rx_gain);
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
         float noise_power = usrp_obj->set_background_noise_power();
-        csd_obj->peak_det_obj_ref.noise_ampl = std::sqrt(noise_power);
+        csd_obj->set_noise_ampl(std::sqrt(noise_power));
         return false;
     }
     else if (ctol < lower_bound)
@@ -164,7 +184,7 @@ bool OTAC_class::check_ctol()
         usrp_obj->set_rx_gain(impl_rx_gain);
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
         float noise_power = usrp_obj->set_background_noise_power();
-        csd_obj->peak_det_obj_ref.noise_ampl = std::sqrt(noise_power);
+        csd_obj->set_noise_ampl(std::sqrt(noise_power));
         return false;
     }
     else
@@ -173,30 +193,20 @@ bool OTAC_class::check_ctol()
 
 bool OTAC_class::otac_pre_processing(float &sig_scale)
 {
-    if (otac_input < dmin or otac_input > dmax)
+    OtacScaling scaling{dmin, dmax, min_e2e_pow, num_leafs};
+    if (not scaling.pre_process(otac_input, ctol, full_scale, sig_scale))
     {
         LOG_WARN_FMT("OTAC input %1% is outside the allowed bounds (%2%, %3%).", otac_input, dmin, dmax);
         return false;
     }
-
-    float sig_input_pow = (otac_input - dmin) / (dmax - dmin);
-    if (sig_input_pow < 0.0 or sig_input_pow > 1.0)
-    {
-        LOG_WARN_FMT("Pre-processed OTAC signal scale %1% is outside allowed bounds (0.0, 1.0)", sig_input_pow);
-        return false;
-    }
-    float post_scaling = std::min<float>(full_scale / std::sqrt(ctol / min_e2e_pow), 1.0);
-    sig_scale = sqrt(sig_input_pow) * post_scaling;
     return true;
 }
 
 bool OTAC_class::otac_post_processing(const float &sig_power, float &out_scale)
 {
-    float out_val = sig_power - noise_power;
-    out_val *= (dmax - dmin) / min_e2e_pow;
-    out_val += dmin * num_leafs;
-
-    if (out_val < dmin * num_leafs or out_val > dmax * num_leafs)
+    OtacScaling scaling{dmin, dmax, min_e2e_pow, num_leafs};
+    float out_val;
+    if (not scaling.post_process(sig_power, noise_power, out_val))
     {
         LOG_WARN_FMT("Post-processed OTAC output %1% is outside the permissible bounds (%2%, %3%)", out_val, dmin * num_leafs, dmax * num_leafs);
         return false;
@@ -269,80 +279,187 @@ void OTAC_class::producer_leaf_proto()
     otac_routine_ends = true;
 };
 
-void OTAC_class::producer_cent_proto()
+void OTAC_class::ref_scheduler_cent_proto()
 {
-    MQTTClient &mqttClient = MQTTClient::getInstance(device_id);
-
-    // reception/producer params
+    double wait_duration = config->start_tx_wait_microsec / 1e6;
+    double ref_air_time = ref_waveform.size() / usrp_obj->tx_rate;
+    double otac_window_air_time = 10 * config->test_signal_len / usrp_obj->rx_rate; // see producer_cent_proto
+    // next REF must not start before the OTAC window of this round is over and leafs have re-armed CSD
+    otac_round_period = std::max(wait_duration, ref_air_time) + otac_window_air_time + config->otac_round_guard_microsec / 1e6;
+    LOG_INFO_FMT("OTAC round period = %1% millisecs", otac_round_period * 1e3);
+
+    // lead time for the timed REF burst, covers the host -> device latency of the send call
+    const uhd::time_spec_t min_lead(5e-3);
+    uhd::time_spec_t ref_timer = usrp_obj->usrp->get_time_now() + min_lead;
     size_t round = 0;
 
-    size_t N_zfc = parser.getValue_int("Ref-N-zfc");
-    // size_t R_zfc = parser.getValue_int("Ref-R-zfc");
-    size_t ref_pad_len = parser.getValue_int("Ref-padding-mul") * N_zfc;
-    // double first_sample_gap = ref_pad_len / usrp_obj->rx_rate;
-    double wait_duration = parser.getValue_float("start-tx-wait-microsec") / 1e6;
-    size_t otac_wf_len = parser.getValue_int("test-signal-len");
-
     while (not signal_stop_called && round++ < max_total_round)
     {
-        LOG_INFO_FMT("-------------- Round %1% ------------", round);
+        OtacRoundSlot slot;
+        slot.round = round;
+        slot.scheduled_ns = LatencyProbes::now_ns();
+
+        auto usrp_now = usrp_obj->usrp->get_time_now();
+        if (ref_timer < usrp_now + min_lead)
+        {
+            // fell behind the schedule (e.g. TX retries) -- slip instead of sending a late burst
+            LATENCY_COUNT("otac.round_slip");
+            pipeline_stats.slipped++;
+            ref_timer = usrp_now + min_lead;
+        }
+        slot.ref_timer = ref_timer;
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        // timed burst -- the device holds it until `ref_timer`, while the previous window is still captured
+        int64_t tx_start_ns = LatencyProbes::now_ns();
+        bool transmit_success = transmission_ref(1.0, slot.ref_timer);
+        int64_t tx_ns = LatencyProbes::now_ns() - tx_start_ns;
+        LATENCY_RECORD("otac.stage.ref_tx", tx_ns);
+        pipeline_stats.tx_ns += tx_ns;
+        ref_timer += uhd::time_spec_t(otac_round_period);
 
-        // Transmit REF
-        uhd::time_spec_t tx_timer = usrp_obj->usrp->get_time_now() + uhd::time_spec_t(5e-3);
-        bool transmit_success = transmission_ref(1.0, tx_timer);
-        if (transmit_success)
+        if (not transmit_success)
         {
-            uhd::time_spec_t otac_timer = tx_timer + uhd::time_spec_t(wait_duration);
-            bool rx_success = reception_otac(ltoc, otac_timer);
-            if (rx_success)
-            {
-                float txrx_gap = (otac_timer - tx_timer - uhd::time_spec_t(wait_duration)).get_real_secs() * 1e6;
-                txrx_gap -= ((otac_wf_len / usrp_obj->rx_rate) * 1e6);
-                LOG_INFO_FMT("OTAC signal synchronization gap = %1% microsecs", txrx_gap);
-                float exp_wait_time = parser.getValue_float("start-tx-wait-microsec");
-                if (txrx_gap > exp_wait_time + 200)
-                {
-                    LOG_WARN("OTAC signal reception delay is too big -> Reject this data.");
-                    continue;
-                }
-
-                float otac_output;
-                if (not otac_post_processing(ltoc, otac_output))
-                {
-                    LOG_WARN_FMT("OTAC post-processing failed!");
-                    continue;
-                }
-                otac_output_list.emplace_back(otac_output);
-                float nmse_val = compute_nmse(otac_input, otac_output);
-                nmse_list.emplace_back(nmse_val);
-                LOG_INFO_FMT("OTAC output = %1%  -- NMSE = %2%", otac_output, nmse_val);
-            }
-            else
-                LOG_WARN("Reception failed!");
+            LOG_WARN_FMT("REF transmission of round %1% failed!", round);
+            continue;
+        }
+        pipeline_stats.scheduled++;
+
+        // blocks while the capture stage is a full round behind
+        while (not signal_stop_called and not scheduled_rounds.push(slot, Deadline(std::chrono::milliseconds(100))))
+        {
+            if (scheduled_rounds.closed())
+                break;
         }
     }
 
-    otac_routine_ends = true;
+    scheduled_rounds.close();
 }
 
-void OTAC_class::consumer_leaf_proto()
+void OTAC_class::producer_cent_proto()
 {
+    double wait_duration = config->start_tx_wait_microsec / 1e6;
+    size_t req_num_samps = 10 * config->test_signal_len;
+
+    OtacRoundSlot slot;
     while (not signal_stop_called)
     {
-        csd_obj->consume(csd_success_flag, signal_stop_called);
-        if (csd_success_flag)
-            LOG_INFO("***Successful CSD!");
+        if (not scheduled_rounds.pop(slot, Deadline(std::chrono::milliseconds(100))))
+        {
+            if (scheduled_rounds.closed() and scheduled_rounds.size() == 0)
+                break;
+            continue;
+        }
+
+        LOG_INFO_FMT("-------------- Round %1% ------------", slot.round);
+
+        OtacCapture capture;
+        capture.slot = slot;
+        capture.otac_timer = slot.ref_timer + uhd::time_spec_t(wait_duration);
+
+        int64_t rx_start_ns = LatencyProbes::now_ns();
+        capture.channel_samples = usrp_obj->reception_channels(signal_stop_called, req_num_samps, 0.0, capture.otac_timer, true);
+        int64_t rx_ns = LatencyProbes::now_ns() - rx_start_ns;
+        LATENCY_RECORD("otac.stage.rx", rx_ns);
+        pipeline_stats.rx_ns += rx_ns;
+
+        if (capture.channel_samples.empty() or capture.channel_samples.front().size() != req_num_samps)
+        {
+            LOG_WARN_FMT("Reception of round %1% failed!", slot.round);
+            continue;
+        }
+        pipeline_stats.captured++;
+
+        while (not signal_stop_called and not captured_rounds.push(std::move(capture), Deadline(std::chrono::milliseconds(100))))
+        {
+            if (captured_rounds.closed())
+                break;
+        }
     }
+
+    captured_rounds.close();
+}
+
+void OTAC_class::consumer_leaf_proto(const size_t &channel)
+{
+    while (not signal_stop_called)
+        csd_obj->consume(channel, signal_stop_called);
 }
 
 void OTAC_class::consumer_cent_proto()
 {
+    double wait_duration = config->start_tx_wait_microsec / 1e6;
+    size_t otac_wf_len = config->test_signal_len;
+
+    OtacCapture capture;
     while (not signal_stop_called)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (not captured_rounds.pop(capture, Deadline(std::chrono::milliseconds(100))))
+        {
+            if (captured_rounds.closed() and captured_rounds.size() == 0)
+                break;
+            continue;
+        }
+
+        int64_t proc_start_ns = LatencyProbes::now_ns();
+        float confidence = 0.0;
+        uhd::time_spec_t otac_timer = capture.otac_timer;
+        bool rx_success = otac_signal_detection(capture.channel_samples, ltoc, otac_timer, confidence);
+        LATENCY_RECORD_SINCE("otac.detection", proc_start_ns);
+
+        if (rx_success)
+        {
+            LOG_DEBUG_FMT("OTAC frame detected with confidence %1%, signal power %2%", confidence, ltoc);
+            float txrx_gap = (otac_timer - capture.slot.ref_timer - uhd::time_spec_t(wait_duration)).get_real_secs() * 1e6;
+            txrx_gap -= ((otac_wf_len / usrp_obj->rx_rate) * 1e6);
+            LOG_INFO_FMT("OTAC signal synchronization gap = %1% microsecs", txrx_gap);
+            float exp_wait_time = config->start_tx_wait_microsec;
+            float otac_output;
+            if (txrx_gap > exp_wait_time + 200)
+                LOG_WARN("OTAC signal reception delay is too big -> Reject this data.");
+            else if (not otac_post_processing(ltoc, otac_output))
+                LOG_WARN_FMT("OTAC post-processing failed!");
+            else
+            {
+                otac_output_list.emplace_back(otac_output);
+                float nmse_val = compute_nmse(otac_input, otac_output);
+                nmse_list.emplace_back(nmse_val);
+                pipeline_stats.accepted++;
+                LOG_INFO_FMT("OTAC output = %1%  -- NMSE = %2%", otac_output, nmse_val);
+            }
+        }
+        else
+            LOG_WARN_FMT("OTAC frame of round %1% not detected (confidence %2%)", capture.slot.round, confidence);
+
+        int64_t proc_end_ns = LatencyProbes::now_ns();
+        LATENCY_RECORD("otac.stage.proc", proc_end_ns - proc_start_ns);
+        LATENCY_RECORD("otac.round", proc_end_ns - capture.slot.scheduled_ns);
+        pipeline_stats.proc_ns += proc_end_ns - proc_start_ns;
+        pipeline_stats.round_ns += proc_end_ns - capture.slot.scheduled_ns;
+        pipeline_stats.processed++;
     }
+
+    // the capture queue is closed by the capture stage after the scheduler finished -- close both
+    // again in case of an early stop so that no stage stays blocked
+    scheduled_rounds.close();
+    captured_rounds.close();
+
+    report_round_pipeline();
+    otac_routine_ends = true;
+}
+
+void OTAC_class::report_round_pipeline()
+{
+    double elapsed = (LatencyProbes::now_ns() - pipeline_stats.start_ns) / 1e9;
+    size_t processed = pipeline_stats.processed;
+    auto mean_ms = [](const int64_t &total_ns, const size_t &count)
+    { return count > 0 ? total_ns / 1e6 / count : 0.0; };
+
+    LOG_INFO_FMT("OTAC pipeline: %1% rounds scheduled, %2% captured, %3% processed, %4% accepted, %5% slipped in %6% secs -> %7% rounds/sec",
+                 pipeline_stats.scheduled.load(), pipeline_stats.captured.load(), processed, pipeline_stats.accepted.load(), pipeline_stats.slipped.load(),
+                 elapsed, (elapsed > 0.0 ? processed / elapsed : 0.0));
+    LOG_INFO_FMT("OTAC pipeline stage means: REF-TX = %1% ms, OTAC-RX = %2% ms, processing = %3% ms, round latency = %4% ms (period %5% ms)",
+                 mean_ms(pipeline_stats.tx_ns, pipeline_stats.scheduled), mean_ms(pipeline_stats.rx_ns, pipeline_stats.captured),
+                 mean_ms(pipeline_stats.proc_ns, processed), mean_ms(pipeline_stats.round_ns, processed), otac_round_period * 1e3);
 }
 
 bool OTAC_class::transmission_ref(const float &scale, const uhd::time_spec_t &tx_timer)
@@ -370,7 +487,7 @@ bool OTAC_class::transmission_ref(const float &scale, const uhd::time_spec_t &tx
 
 bool OTAC_class::transmission_otac(const float &scale, const uhd::time_spec_t &tx_timer)
 {
-    std::vector<std::complex<float>> tx_waveform = otac_waveform;
+    std::vector<std::complex<float>> tx_waveform = otac_waveforms.otac;
     float my_scale;
     if (scale > 1.0) // if not full_scale = 1.0, implement scaling of signal
         my_scale = 1.0;
@@ -381,7 +498,7 @@ bool OTAC_class::transmission_otac(const float &scale, const uhd::time_spec_t &t
     float current_cfo = csd_obj->cfo;
     correct_cfo(tx_waveform, my_scale, current_cfo, cfo_counter);
 
-    std::vector<std::complex<float>> fs_tx_waveform = fs_waveform;
+    std::vector<std::complex<float>> fs_tx_waveform = otac_waveforms.fs;
     correct_cfo(fs_tx_waveform, 1.0, current_cfo, cfo_counter);
 
     tx_waveform.insert(tx_waveform.begin(), fs_tx_waveform.begin(), fs_tx_waveform.end());
@@ -394,17 +511,28 @@ bool OTAC_class::transmission_otac(const float &scale, const uhd::time_spec_t &t
 
 bool OTAC_class::reception_ref(float &rx_sig_pow, uhd::time_spec_t &tx_timer)
 {
-    auto producer_wrapper = [this](const std::vector<std::complex<float>> &samples, const size_t &sample_size, const uhd::time_spec_t &sample_time)
+    // float or sc16 packets, whichever the RX host format is
+    auto producer_wrapper = [this](const auto &samples, const size_t &sample_size, const uhd::time_spec_t &sample_time)
     {
         csd_obj->produce(samples, sample_size, sample_time, signal_stop_called);
 
+        if (csd_obj->detection_complete())
+        {
+            LOG_INFO("***Successful CSD!");
+            csd_success_flag = true;
+        }
+
         if (csd_success_flag)
             return true;
         else
             return false;
     };
 
-    usrp_obj->reception(signal_stop_called, 0, 0, uhd::time_spec_t(0.0), false, producer_wrapper);
+    if (usrp_obj->rx_sc16)
+        usrp_obj->reception_channels_sc16(signal_stop_called, 0, 0, uhd::time_spec_t(0.0), false, producer_wrapper);
+    else
+        usrp_obj->reception_channels(signal_stop_called, 0, 0, uhd::time_spec_t(0.0), false, producer_wrapper);
+    csd_obj->reset_detections();
 
     if (!csd_success_flag)
     {
@@ -420,18 +548,92 @@ bool OTAC_class::reception_ref(float &rx_sig_pow, uhd::time_spec_t &tx_timer)
     return true;
 }
 
-bool OTAC_class::reception_otac(float &rx_sig_pow, uhd::time_spec_t &tx_timer)
+bool OTAC_class::otac_signal_detection(const std::vector<std::vector<std::complex<float>>> &channel_signals, float &signal_power, uhd::time_spec_t &signal_start_timer, float &confidence)
 {
-    size_t otac_wf_len = parser.getValue_int("test-signal-len");
-    size_t req_num_samps = 10 * otac_wf_len;
-    auto otac_rx_samps = usrp_obj->reception(signal_stop_called, req_num_samps, 0.0, tx_timer, true);
-    if (otac_rx_samps.size() == req_num_samps)
-        return otac_signal_detection(otac_rx_samps, rx_sig_pow, tx_timer);
-    else
+    confidence = 0.0;
+    if (channel_signals.empty() or channel_signals.front().empty())
+    {
+        LOG_WARN("Empty OTAC capture, nothing to detect.");
         return false;
+    }
+    if (otac_detectors.size() < channel_signals.size())
+    {
+        LOG_WARN("OTAC detector is not initialized.");
+        return false;
+    }
+
+    // channels are independent -- the extra channels go to their workers, the first one is detected here
+    std::vector<OtacDetector::Detection> detections(channel_signals.size());
+    std::vector<size_t> dispatched;
+    for (size_t ch = 1; ch < channel_signals.size(); ++ch)
+    {
+        if (ch <= detection_jobs.size() and detection_jobs[ch - 1]->push(&channel_signals[ch], Deadline::never()))
+            dispatched.push_back(ch);
+        else
+            detections[ch] = otac_detectors[ch]->detect(channel_signals[ch]);
+    }
+    detections[0] = otac_detectors[0]->detect(channel_signals[0]);
+    size_t done_channel;
+    for (size_t i = 0; i < dispatched.size(); ++i)
+        detection_done->pop(done_channel, Deadline::never());
+    for (const auto &ch : dispatched)
+        detections[ch] = channel_detections[ch];
+
+    std::vector<float> signal_powers, noise_powers;
+    const OtacDetector::Detection *best = nullptr;
+    for (const auto &detection : detections)
+    {
+        if (not best or detection.confidence > best->confidence)
+            best = &detection;
+        if (not detection.detected)
+            continue;
+        signal_powers.push_back(detection.signal_power);
+        noise_powers.push_back(detection.noise_power);
+    }
+
+    confidence = best->confidence;
+    if (not best->detected)
+        return false;
+
+    size_t strongest;
+    signal_power = combine_channel_powers(signal_powers, noise_powers, rx_combining, strongest);
+    signal_start_timer += uhd::time_spec_t(best->frame_start / usrp_obj->rx_rate);
+    return true;
+}
+void OTAC_class::start_detection_workers()
+{
+    const size_t num_channels = otac_detectors.size();
+    if (num_channels < 2 or not detection_threads.empty())
+        return;
+
+    channel_detections.resize(num_channels);
+    detection_done = std::make_unique<BoundedQueue<size_t>>(num_channels);
+    for (size_t ch = 1; ch < num_channels; ++ch)
+        detection_jobs.emplace_back(std::make_unique<BoundedQueue<const std::vector<std::complex<float>> *>>(1));
+    for (size_t ch = 1; ch < num_channels; ++ch)
+    {
+        detection_threads.emplace_back(&OTAC_class::detection_worker, this, ch);
+        ThreadScheduling::getInstance().apply(detection_threads.back(), ThreadRole::DETECT, "otac.cent.detect.ch" + std::to_string(ch));
+    }
 }
 
-bool OTAC_class::otac_signal_detection(const std::vector<std::complex<float>> &signal, float &signal_power, uhd::time_spec_t &signal_start_timer, const size_t &detection_type_id)
+void OTAC_class::stop_detection_workers()
 {
-    return false;
-}
\ No newline at end of file
+    for (auto &jobs : detection_jobs)
+        jobs->close();
+    for (auto &thread : detection_threads)
+        if (thread.joinable())
+            thread.join();
+    if (detection_done)
+        detection_done->close();
+}
+
+void OTAC_class::detection_worker(const size_t &channel)
+{
+    const std::vector<std::complex<float>> *samples;
+    while (detection_jobs[channel - 1]->pop(samples, Deadline::never()))
+    {
+        channel_detections[channel] = otac_detectors[channel]->detect(*samples);
+        detection_done->push(channel, Deadline::never());
+    }
+}
@@ -0,0 +1,275 @@
+#include "latency_probes.hpp"
+#include "thread_sched.hpp"
+#include "huge_page_alloc.hpp"
+
+// per-thread shard lookup tables, indexed by probe/counter id
+static thread_local std::vector<void *> thread_histogram_shards;
+static thread_local std::vector<void *> thread_counter_shards;
+
+LatencyHistogram::LatencyHistogram() : counts_(new std::atomic<uint64_t>[BUCKET_COUNT]),
+                                       total_(0),
+                                       sum_(0),
+                                       min_(std::numeric_limits<uint64_t>::max()),
+                                       max_(0)
+{
+    for (size_t i = 0; i < BUCKET_COUNT; ++i)
+        counts_[i].store(0, std::memory_order_relaxed);
+}
+
+size_t LatencyHistogram::bucket_index(uint64_t value_ns)
+{
+    const uint64_t max_value = (uint64_t(1) << MAX_VALUE_BITS) - 1;
+    if (value_ns > max_value)
+        value_ns = max_value;
+
+    if (value_ns < SUB_BUCKET_COUNT)
+        return size_t(value_ns);
+
+    // keep SUB_BUCKET_BITS + 1 most significant bits
+    size_t msb = 63 - size_t(__builtin_clzll(value_ns));
+    size_t shift = msb - SUB_BUCKET_BITS;
+    return shift * SUB_BUCKET_COUNT + size_t(value_ns >> shift);
+}
+
+uint64_t LatencyHistogram::bucket_value(const size_t &index)
+{
+    if (index < 2 * SUB_BUCKET_COUNT)
+        return uint64_t(index);
+
+    // representative value is the middle of the bucket
+    size_t shift = index / SUB_BUCKET_COUNT - 1;
+    uint64_t mantissa = index - shift * SUB_BUCKET_COUNT;
+    return (mantissa << shift) + ((uint64_t(1) << shift) >> 1);
+}
+
+void LatencyHistogram::record(const uint64_t &value_ns)
+{
+    counts_[bucket_index(value_ns)].fetch_add(1, std::memory_order_relaxed);
+    total_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value_ns, std::memory_order_relaxed);
+
+    // single writer per shard -- plain load/store is sufficient
+    if (value_ns < min_.load(std::memory_order_relaxed))
+        min_.store(value_ns, std::memory_order_relaxed);
+    if (value_ns > max_.load(std::memory_order_relaxed))
+        max_.store(value_ns, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::merge_into(std::vector<uint64_t> &counts, uint64_t &total, uint64_t &sum, uint64_t &min_val, uint64_t &max_val) const
+{
+    counts.resize(BUCKET_COUNT, 0);
+    for (size_t i = 0; i < BUCKET_COUNT; ++i)
+        counts[i] += counts_[i].load(std::memory_order_relaxed);
+    total += total_.load(std::memory_order_relaxed);
+    sum += sum_.load(std::memory_order_relaxed);
+    min_val = std::min(min_val, min_.load(std::memory_order_relaxed));
+    max_val = std::max(max_val, max_.load(std::memory_order_relaxed));
+}
+
+LatencyProbes &LatencyProbes::getInstance()
+{
+    static LatencyProbes instance;
+    return instance;
+}
+
+LatencyProbes::~LatencyProbes()
+{
+    stop_reporter();
+}
+
+size_t LatencyProbes::register_probe(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto it = std::find(probe_names.begin(), probe_names.end(), name);
+    if (it != probe_names.end())
+        return std::distance(probe_names.begin(), it);
+
+    probe_names.emplace_back(name);
+    return probe_names.size() - 1;
+}
+
+size_t LatencyProbes::register_counter(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto it = std::find(counter_names.begin(), counter_names.end(), name);
+    if (it != counter_names.end())
+        return std::distance(counter_names.begin(), it);
+
+    counter_names.emplace_back(name);
+    return counter_names.size() - 1;
+}
+
+LatencyProbes::HistogramShard *LatencyProbes::create_histogram_shard(const size_t &probe_id)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    histogram_shards.emplace_back(std::make_unique<HistogramShard>());
+    histogram_shards.back()->probe_id = probe_id;
+    return histogram_shards.back().get();
+}
+
+LatencyProbes::CounterShard *LatencyProbes::create_counter_shard(const size_t &counter_id)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    counter_shards.emplace_back(std::make_unique<CounterShard>());
+    counter_shards.back()->counter_id = counter_id;
+    return counter_shards.back().get();
+}
+
+void LatencyProbes::record(const size_t &probe_id, const int64_t &value_ns)
+{
+    if (probe_id >= thread_histogram_shards.size())
+        thread_histogram_shards.resize(probe_id + 1, nullptr);
+
+    auto shard = static_cast<HistogramShard *>(thread_histogram_shards[probe_id]);
+    if (shard == nullptr) // first record of this probe on the current thread
+    {
+        shard = create_histogram_shard(probe_id);
+        thread_histogram_shards[probe_id] = shard;
+    }
+
+    shard->hist.record(value_ns > 0 ? uint64_t(value_ns) : 0);
+}
+
+void LatencyProbes::increment(const size_t &counter_id, const uint64_t &count)
+{
+    if (counter_id >= thread_counter_shards.size())
+        thread_counter_shards.resize(counter_id + 1, nullptr);
+
+    auto shard = static_cast<CounterShard *>(thread_counter_shards[counter_id]);
+    if (shard == nullptr)
+    {
+        shard = create_counter_shard(counter_id);
+        thread_counter_shards[counter_id] = shard;
+    }
+
+    shard->value.fetch_add(count, std::memory_order_relaxed);
+}
+
+json LatencyProbes::snapshot_json()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    json snapshot;
+    snapshot["time"] = currentDateTime();
+
+    json probes = json::object();
+    for (size_t id = 0; id < probe_names.size(); ++id)
+    {
+        std::vector<uint64_t> counts;
+        uint64_t total = 0, sum = 0, min_val = std::numeric_limits<uint64_t>::max(), max_val = 0;
+        for (const auto &shard : histogram_shards)
+        {
+            if (shard->probe_id == id)
+                shard->hist.merge_into(counts, total, sum, min_val, max_val);
+        }
+        if (total == 0)
+            continue;
+
+        // percentiles in microseconds
+        json entry;
+        entry["count"] = total;
+        entry["min_us"] = min_val / 1e3;
+        entry["max_us"] = max_val / 1e3;
+        entry["mean_us"] = double(sum) / total / 1e3;
+        const std::vector<std::pair<std::string, double>> quantiles = {{"p50_us", 0.5}, {"p90_us", 0.9}, {"p99_us", 0.99}, {"p999_us", 0.999}};
+        for (const auto &q : quantiles)
+        {
+            uint64_t rank = uint64_t(std::ceil(q.second * total)), acc = 0;
+            for (size_t i = 0; i < counts.size(); ++i)
+            {
+                acc += counts[i];
+                if (acc >= rank)
+                {
+                    uint64_t val = std::min(std::max(LatencyHistogram::bucket_value(i), min_val), max_val);
+                    entry[q.first] = val / 1e3;
+                    break;
+                }
+            }
+        }
+        probes[probe_names[id]] = entry;
+    }
+    snapshot["probes"] = probes;
+
+    json counters = json::object();
+    for (size_t id = 0; id < counter_names.size(); ++id)
+    {
+        uint64_t total = 0;
+        for (const auto &shard : counter_shards)
+        {
+            if (shard->counter_id == id)
+                total += shard->value.load(std::memory_order_relaxed);
+        }
+        counters[counter_names[id]] = total;
+    }
+    snapshot["counters"] = counters;
+
+    return snapshot;
+}
+
+/**
+ * @brief Starts a background thread publishing periodic probe snapshots.
+ *
+ * Every `period_ms` a snapshot is appended as a single JSON line to `filename`
+ * (skipped if empty) and passed to `publisher` (skipped if not set). Each snapshot also
+ * carries the achieved thread scheduling ("threads") and the huge page arena usage ("memory").
+ *
+ * @param filename  File to append snapshots to.
+ * @param period_ms Reporting period in milliseconds.
+ * @param publisher Callback receiving the serialized snapshot, e.g. an MQTT publish.
+ */
+void LatencyProbes::start_reporter(const std::string &filename, const size_t &period_ms, const std::function<void(const std::string &)> &publisher)
+{
+    if (reporter_running.exchange(true))
+    {
+        LOG_WARN("Latency reporter is already running.");
+        return;
+    }
+    reporter_thread = boost::thread(&LatencyProbes::reporter_loop, this, filename, period_ms, publisher);
+}
+
+void LatencyProbes::stop_reporter()
+{
+    reporter_running = false;
+    if (reporter_thread.joinable())
+    {
+        reporter_thread.interrupt();
+        reporter_thread.join();
+    }
+}
+
+void LatencyProbes::reporter_loop(std::string filename, size_t period_ms, std::function<void(const std::string &)> publisher)
+{
+    ThreadScheduling::getInstance().apply_to_current_thread(ThreadRole::IO, "telemetry.reporter");
+    std::ofstream outfile;
+    while (reporter_running)
+    {
+        try
+        {
+            boost::this_thread::sleep_for(boost::chrono::milliseconds(period_ms));
+        }
+        catch (const boost::thread_interrupted &)
+        {
+            break;
+        }
+
+        // with the achieved thread scheduling and buffer placement, to verify sched-* and huge-pages
+        json report = snapshot_json();
+        report["threads"] = ThreadScheduling::getInstance().report_json();
+        report["memory"] = HugePageArena::getInstance().stats_json();
+        std::string snapshot = report.dump();
+
+        if (filename != "")
+        {
+            if (!outfile.is_open())
+                outfile.open(filename, std::ios::out | std::ios::app);
+            if (outfile.is_open())
+                outfile << snapshot << std::endl;
+        }
+
+        if (publisher)
+            publisher(snapshot);
+    }
+
+    if (outfile.is_open())
+        outfile.close();
+}
@@ -1,7 +1,7 @@
 #include "usrp_class.hpp"
 #include <uhd/cal/database.hpp>
 
-USRP_class::USRP_class(const ConfigParser &parser) : USRP_init(parser), parser(parser) {};
+USRP_class::USRP_class(std::shared_ptr<const Config> config) : USRP_init(config), config(config) {};
 
 float USRP_class::estimate_background_noise_power(const size_t &num_pkts)
 {
@@ -25,10 +25,9 @@ void USRP_class::publish_usrp_data()
     json_data["tx-rate"] = tx_rate;
     json_data["temp"] = current_temperature;
     json_data["noise-level"] = init_noise_ampl;
-    json_data["time"] = currentDateTime();
     MQTTClient &mqttClient = MQTTClient::getInstance(device_id);
     std::string topic_init = mqttClient.topics->getValue_str("init-config") + device_id;
-    mqttClient.publish(topic_init, json_data.dump(4), true);
+    mqttClient.publish(topic_init, mqttClient.encode_payload(std::move(json_data)), true);
 }
 
 void USRP_class::pre_process_tx_symbols(std::vector<sample_type> &tx_samples, const float &scale)
@@ -61,6 +60,12 @@ bool USRP_class::transmission(const std::vector<sample_type> &buff, const uhd::t
     auto usrp_now = get_time_now();
     double time_diff = (tx_time - usrp_now).get_real_secs();
 
+    // remaining lead time before the scheduled tx_time
+    if (time_diff > 0.0)
+        LATENCY_RECORD("tx.lead_time", int64_t(time_diff * 1e9));
+    else
+        LATENCY_COUNT("tx.late_submit");
+
     if (time_diff <= 0.0)
     {
         LOG_DEBUG_FMT("Transmitting %d samples WITHOUT delay.", total_num_samps);
@@ -80,6 +85,7 @@ bool USRP_class::transmission(const std::vector<sample_type> &buff, const uhd::t
     size_t num_acc_samps = 0;
     size_t num_tx_samps_sent_now = 0;
     bool transmit_failure = false;
+    int64_t tx_submit_ns = LatencyProbes::now_ns();
 
     while (num_acc_samps < total_num_samps and not stop_signal_called)
     {
@@ -182,9 +188,13 @@ bool USRP_class::transmission(const std::vector<sample_type> &buff, const uhd::t
         if (not got_async_burst_ack)
         {
             LOG_WARN("ACK FAIL..!");
+            LATENCY_COUNT("tx.burst_ack_fail");
         }
         else
+        {
+            LATENCY_RECORD_SINCE("tx.submit_to_burst_ack", tx_submit_ns);
             success = true;
+        }
     }
     else
     {
@@ -212,6 +222,10 @@ bool USRP_class::single_burst_transmission(const std::vector<sample_type> &buff,
     auto usrp_now = usrp->get_time_now();
     double time_diff = (tx_time - usrp_now).get_real_secs();
     LOG_DEBUG_FMT("TX with delay = %.4f microsecs.", (time_diff * 1e6));
+    if (time_diff > 0.0)
+        LATENCY_RECORD("tx.lead_time", int64_t(time_diff * 1e9));
+    else
+        LATENCY_COUNT("tx.late_submit");
     if (time_diff <= 0.0)
     {
         LOG_DEBUG_FMT("Transmitting %d samples WITHOUT delay.", total_num_samps);
@@ -228,6 +242,7 @@ bool USRP_class::single_burst_transmission(const std::vector<sample_type> &buff,
     double tx_delay, timeout;
 
     timeout = burst_pkt_time + time_diff;
+    int64_t tx_submit_ns = LatencyProbes::now_ns();
     size_t num_tx_samps_sent_now = tx_streamer->send(&buff.front(), buff.size(), md, timeout);
 
     if (num_tx_samps_sent_now < total_num_samps)
@@ -258,9 +273,13 @@ bool USRP_class::single_burst_transmission(const std::vector<sample_type> &buff,
         if (not got_async_burst_ack)
         {
             LOG_WARN("ACK FAIL..!");
+            LATENCY_COUNT("tx.burst_ack_fail");
         }
         else
+        {
+            LATENCY_RECORD_SINCE("tx.submit_to_burst_ack", tx_submit_ns);
             success = true;
+        }
     }
     else
     {
@@ -314,8 +333,71 @@ void USRP_class::continuous_transmission(const std::vector<sample_type> &buff, s
 };
 
 std::vector<sample_type> USRP_class::reception(bool &stop_signal_called, const size_t &req_num_rx_samps, const float &duration, const uhd::time_spec_t &rx_time, bool is_save_to_file, const std::function<bool(const std::vector<sample_type> &, const size_t &, const uhd::time_spec_t &)> &callback)
+{
+    auto first_channel_callback = [&callback](const std::vector<std::vector<sample_type>> &buffs, const size_t &num_samps, const uhd::time_spec_t &time)
+    { return callback(buffs[0], num_samps, time); };
+
+    auto rx_samples = reception_channels(stop_signal_called, req_num_rx_samps, duration, rx_time, is_save_to_file, first_channel_callback);
+    return std::move(rx_samples[0]);
+}
+
+// conversion between the host formats, for callers that use the other one
+static void convert_samples(const sc16_type *in, const size_t &num_samples, sample_type *out) { sc16_to_fc32(in, num_samples, out); }
+static void convert_samples(const sample_type *in, const size_t &num_samples, sc16_type *out) { fc32_to_sc16(in, num_samples, out); }
+
+template <typename IN_SAMPLE, typename OUT_SAMPLE>
+static void convert_channels(const std::vector<std::vector<IN_SAMPLE>> &in, const size_t &num_samples, std::vector<std::vector<OUT_SAMPLE>> &out)
+{
+    out.resize(in.size());
+    for (size_t ch = 0; ch < in.size(); ++ch)
+    {
+        out[ch].resize(in[ch].size());
+        convert_samples(in[ch].data(), std::min(num_samples, in[ch].size()), out[ch].data());
+    }
+}
+
+std::vector<std::vector<sample_type>> USRP_class::reception_channels(bool &stop_signal_called, const size_t &req_num_rx_samps, const float &duration, const uhd::time_spec_t &rx_time, bool is_save_to_file, const rx_channels_callback &callback)
+{
+    if (not rx_sc16)
+        return reception_host<sample_type>(stop_signal_called, req_num_rx_samps, duration, rx_time, is_save_to_file, callback);
+
+    std::vector<std::vector<sample_type>> converted;
+    auto converting_callback = [&](const std::vector<std::vector<sc16_type>> &buffs, const size_t &num_samps, const uhd::time_spec_t &time)
+    {
+        convert_channels(buffs, num_samps, converted);
+        return callback(converted, num_samps, time);
+    };
+    auto rx_samples = reception_host<sc16_type>(stop_signal_called, req_num_rx_samps, duration, rx_time, is_save_to_file, converting_callback);
+
+    std::vector<std::vector<sample_type>> out_samples;
+    convert_channels(rx_samples, std::numeric_limits<size_t>::max(), out_samples);
+    return out_samples;
+}
+
+std::vector<std::vector<sc16_type>> USRP_class::reception_channels_sc16(bool &stop_signal_called, const size_t &req_num_rx_samps, const float &duration, const uhd::time_spec_t &rx_time, bool is_save_to_file, const rx_channels_sc16_callback &callback)
+{
+    if (rx_sc16)
+        return reception_host<sc16_type>(stop_signal_called, req_num_rx_samps, duration, rx_time, is_save_to_file, callback);
+
+    std::vector<std::vector<sc16_type>> converted;
+    auto converting_callback = [&](const std::vector<std::vector<sample_type>> &buffs, const size_t &num_samps, const uhd::time_spec_t &time)
+    {
+        convert_channels(buffs, num_samps, converted);
+        return callback(converted, num_samps, time);
+    };
+    auto rx_samples = reception_host<sample_type>(stop_signal_called, req_num_rx_samps, duration, rx_time, is_save_to_file, converting_callback);
+
+    std::vector<std::vector<sc16_type>> out_samples;
+    convert_channels(rx_samples, std::numeric_limits<size_t>::max(), out_samples);
+    return out_samples;
+}
+
+// reception in the host format of the RX streamer (`HOST_SAMPLE` must match `rx_sc16`)
+template <typename HOST_SAMPLE>
+std::vector<std::vector<HOST_SAMPLE>> USRP_class::reception_host(bool &stop_signal_called, const size_t &req_num_rx_samps, const float &duration, const uhd::time_spec_t &rx_time, bool is_save_to_file, const std::function<bool(const std::vector<std::vector<HOST_SAMPLE>> &, const size_t &, const uhd::time_spec_t &)> &callback)
 {
     std::string filename;
+    const size_t num_channels = num_rx_channels();
 
     if (is_save_to_file)
     {
@@ -323,7 +405,7 @@ std::vector<sample_type> USRP_class::reception(bool &stop_signal_called, const s
         {
             std::string homeDirStr = get_home_dir();
             std::string curr_datetime = currentDateTimeFilename();
-            filename = homeDirStr + "/OTA-C/ProjectRoot/storage/rx_saved_file_" + parser.getValue_str("device-id") + "_" + curr_datetime + ".dat";
+            filename = homeDirStr + "/OTA-C/ProjectRoot/storage/rx_saved_file_" + config->device_id + "_" + curr_datetime + (rx_sc16 ? "_sc16" : "") + ".dat";
         }
     }
 
@@ -363,13 +445,26 @@ std::vector<sample_type> USRP_class::reception(bool &stop_signal_called, const s
     double rx_delay = stream_cmd.stream_now ? 0.0 : (rx_time - usrp->get_time_now()).get_real_secs();
     double timeout = burst_pkt_time + rx_delay;
 
-    std::vector<sample_type> rx_samples;
+    std::vector<std::vector<HOST_SAMPLE>> rx_samples(num_channels);
     bool reception_complete = false;
     size_t retry_rx = 0;
     size_t num_acc_samps = 0;
     bool callback_success = false;
     size_t num_curr_rx_samps;
-    std::vector<sample_type> buff(max_rx_packet_size);
+    std::vector<std::vector<HOST_SAMPLE>> buffs(num_channels, std::vector<HOST_SAMPLE>(max_rx_packet_size));
+    std::vector<HOST_SAMPLE *> buff_ptrs;
+    for (auto &buff : buffs)
+        buff_ptrs.push_back(buff.data());
+
+    // channel 0 is saved to `filename`, further channels to `<filename>_ch<k>.dat`
+    std::vector<std::ofstream> channel_save_streams(num_channels - 1);
+    auto save_channel = [&](const size_t &ch, const HOST_SAMPLE *samples, const size_t &num_samples)
+    {
+        if (ch == 0)
+            save_stream_to_file(filename, rx_save_stream, samples, num_samples);
+        else
+            save_stream_to_file(filename.substr(0, filename.size() - 4) + "_ch" + std::to_string(rx_channels[ch]) + ".dat", channel_save_streams[ch - 1], samples, num_samples);
+    };
     int retry_count = 0;
 
     while (not reception_complete and not stop_signal_called)
@@ -377,7 +472,8 @@ std::vector<sample_type> USRP_class::reception(bool &stop_signal_called, const s
         size_t size_rx = (req_num_rx_samps == 0) ? max_rx_packet_size : std::min(req_num_rx_samps - num_acc_samps, max_rx_packet_size);
 
         uhd::rx_metadata_t md;
-        num_curr_rx_samps = rx_streamer->recv(&buff.front(), size_rx, md, timeout, false);
+        num_curr_rx_samps = rx_streamer->recv(buff_ptrs, size_rx, md, timeout, false);
+        int64_t packet_arrival_ns = LatencyProbes::now_ns();
         timeout = burst_pkt_time; // small timeout for subsequent packets
 
         if (md.error_code == uhd::rx_metadata_t::ERROR_CODE_TIMEOUT)
@@ -388,6 +484,7 @@ std::vector<sample_type> USRP_class::reception(bool &stop_signal_called, const s
         else if (md.error_code == uhd::rx_metadata_t::ERROR_CODE_OVERFLOW)
         {
             LOG_WARN("*** Got an overflow indication.");
+            LATENCY_COUNT("rx.overflow");
         }
         else if (md.error_code == uhd::rx_metadata_t::ERROR_CODE_LATE_COMMAND)
         {
@@ -419,17 +516,19 @@ std::vector<sample_type> USRP_class::reception(bool &stop_signal_called, const s
             retry_count = 0;
 
         // run callback
-        callback_success = callback(buff, num_curr_rx_samps, md.time_spec);
+        callback_success = callback(buffs, num_curr_rx_samps, md.time_spec);
+        LATENCY_RECORD_SINCE("rx.packet_to_produce", packet_arrival_ns);
 
         // process (save, update counters, etc...) received samples and continue
         if (is_save_to_file and (not fixed_reception_condition)) // continuous saving
         {
-            std::vector<sample_type> forward(buff.begin(), buff.begin() + num_curr_rx_samps);
-            save_stream_to_file(filename, rx_save_stream, forward);
+            for (size_t ch = 0; ch < num_channels; ++ch)
+                save_channel(ch, buffs[ch].data(), num_curr_rx_samps);
         }
 
         if (fixed_reception_condition) // fixed number of samples -- save in a separate vector to return
-            rx_samples.insert(rx_samples.end(), buff.begin(), buff.begin() + num_curr_rx_samps);
+            for (size_t ch = 0; ch < num_channels; ++ch)
+                rx_samples[ch].insert(rx_samples[ch].end(), buffs[ch].begin(), buffs[ch].begin() + num_curr_rx_samps);
 
         if (callback_success)
             reception_complete = true;
@@ -456,7 +555,8 @@ std::vector<sample_type> USRP_class::reception(bool &stop_signal_called, const s
         LOG_WARN("Not all packets received!");
 
     if (fixed_reception_condition and is_save_to_file) // save all received samples if a total number of desired rx samples given
-        save_stream_to_file(filename, rx_save_stream, rx_samples);
+        for (size_t ch = 0; ch < num_channels; ++ch)
+            save_channel(ch, rx_samples[ch].data(), rx_samples[ch].size());
 
     if (rx_save_stream.is_open())
         rx_save_stream.close();
@@ -464,16 +564,44 @@ std::vector<sample_type> USRP_class::reception(bool &stop_signal_called, const s
     if (success and fixed_reception_condition)
         return rx_samples;
     else // do not return anything if total num rx samps not given
-        return std::vector<sample_type>{};
+        return std::vector<std::vector<HOST_SAMPLE>>(num_channels);
 };
 
+// one recv call for receivers of a single channel -- the other streamed channels must be received too
+size_t USRP_class::recv_first_channel(sample_type *channel0, const size_t &num_samps, uhd::rx_metadata_t &md, const double &timeout)
+{
+    if (not rx_sc16)
+        return recv_first_channel_host(channel0, num_samps, md, timeout);
+
+    if (rx_scratch_sc16.size() < num_samps)
+        rx_scratch_sc16.resize(num_samps);
+    size_t num_rx_samps = recv_first_channel_host(rx_scratch_sc16.data(), num_samps, md, timeout);
+    sc16_to_fc32(rx_scratch_sc16.data(), num_rx_samps, channel0);
+    return num_rx_samps;
+}
+
+// `channel0` holds `num_samps` samples of the host format
+size_t USRP_class::recv_first_channel_host(void *channel0, const size_t &num_samps, uhd::rx_metadata_t &md, const double &timeout)
+{
+    const size_t num_channels = num_rx_channels();
+    rx_scratch.resize(num_channels - 1);
+    std::vector<void *> buff_ptrs = {channel0};
+    for (auto &scratch : rx_scratch)
+    {
+        if (scratch.size() < num_samps) // large enough for either host format
+            scratch.resize(num_samps);
+        buff_ptrs.push_back(scratch.data());
+    }
+    return rx_streamer->recv(buff_ptrs, num_samps, md, timeout, false);
+}
+
 void USRP_class::receive_save_with_timer(bool &stop_signal_called, const float &duration)
 {
     std::string data_filename, timer_filename;
     std::string homeDirStr = get_home_dir();
     std::string curr_datetime = currentDateTimeFilename();
-    data_filename = homeDirStr + "/OTA-C/ProjectRoot/storage/data_" + parser.getValue_str("device-id") + "_" + curr_datetime + ".dat";
-    timer_filename = homeDirStr + "/OTA-C/ProjectRoot/storage/timer_" + parser.getValue_str("device-id") + "_" + curr_datetime + ".dat";
+    data_filename = homeDirStr + "/OTA-C/ProjectRoot/storage/data_" + config->device_id + "_" + curr_datetime + (rx_sc16 ? "_sc16" : "") + ".dat";
+    timer_filename = homeDirStr + "/OTA-C/ProjectRoot/storage/timer_" + config->device_id + "_" + curr_datetime + ".dat";
 
     bool success = true;
 
@@ -499,13 +627,15 @@ void USRP_class::receive_save_with_timer(bool &stop_signal_called, const float &
     size_t rx_counter = 0;
     size_t num_acc_samps = 0;
     bool callback_success = false;
-    std::vector<sample_type> buff(total_num_samps);
+    // pre-faulted, no page faults while streaming -- samples are kept (and saved) in the host format
+    const size_t sample_bytes = rx_sc16 ? sizeof(sc16_type) : sizeof(sample_type);
+    huge_page_vector<char> buff(total_num_samps * sample_bytes);
 
     while (num_acc_samps < total_num_samps and not stop_signal_called)
     {
 
         uhd::rx_metadata_t md;
-        size_t num_curr_rx_samps = rx_streamer->recv(&buff.front() + num_acc_samps, max_rx_packet_size, md, timeout, false);
+        size_t num_curr_rx_samps = recv_first_channel_host(buff.data() + num_acc_samps * sample_bytes, max_rx_packet_size, md, timeout);
         num_acc_samps += num_curr_rx_samps;
 
         if (md.error_code == uhd::rx_metadata_t::ERROR_CODE_TIMEOUT)
@@ -516,6 +646,7 @@ void USRP_class::receive_save_with_timer(bool &stop_signal_called, const float &
         else if (md.error_code == uhd::rx_metadata_t::ERROR_CODE_OVERFLOW)
         {
             LOG_WARN("*** Got an overflow indication.");
+            LATENCY_COUNT("rx.overflow");
         }
         else if (md.error_code != uhd::rx_metadata_t::ERROR_CODE_NONE)
         {
@@ -544,7 +675,10 @@ void USRP_class::receive_save_with_timer(bool &stop_signal_called, const float &
     std::cout << "Saving file..." << std::endl;
 
     std::ofstream rx_save_datastream, rx_save_timer;
-    save_stream_to_file(data_filename, rx_save_datastream, buff);
+    if (rx_sc16)
+        save_stream_to_file(data_filename, rx_save_datastream, reinterpret_cast<const sc16_type *>(buff.data()), total_num_samps);
+    else
+        save_stream_to_file(data_filename, rx_save_datastream, reinterpret_cast<const sample_type *>(buff.data()), total_num_samps);
 
     rx_save_timer.open(timer_filename, std::ios::out | std::ios::binary | std::ios::app);
     for (size_t i = 0; i < timer_vec.size(); ++i)
@@ -582,7 +716,7 @@ void USRP_class::receive_fixed_num_samps(bool &stop_signal_called, const size_t
     {
         uhd::rx_metadata_t md;
         size_t packet_size = std::min(num_rx_samples - num_acc_samps, max_rx_packet_size);
-        size_t num_curr_rx_samps = rx_streamer->recv(&out_samples.front() + num_acc_samps, packet_size, md, timeout, false);
+        size_t num_curr_rx_samps = recv_first_channel(&out_samples.front() + num_acc_samps, packet_size, md, timeout);
         num_acc_samps += num_curr_rx_samps;
 
         if (md.error_code == uhd::rx_metadata_t::ERROR_CODE_TIMEOUT)
@@ -593,6 +727,7 @@ void USRP_class::receive_fixed_num_samps(bool &stop_signal_called, const size_t
         else if (md.error_code == uhd::rx_metadata_t::ERROR_CODE_OVERFLOW)
         {
             LOG_WARN("*** Got an overflow indication.");
+            LATENCY_COUNT("rx.overflow");
         }
         else if (md.error_code != uhd::rx_metadata_t::ERROR_CODE_NONE)
         {
@@ -636,7 +771,8 @@ void USRP_class::receive_continuously_with_callback(bool &stop_signal_called, co
     while (not stop_signal_called and not callback_success)
     {
         uhd::rx_metadata_t md;
-        size_t num_curr_rx_samps = rx_streamer->recv(&buff.front(), packet_size, md, timeout, false);
+        size_t num_curr_rx_samps = recv_first_channel(&buff.front(), packet_size, md, timeout);
+        int64_t packet_arrival_ns = LatencyProbes::now_ns();
 
         if (md.error_code == uhd::rx_metadata_t::ERROR_CODE_TIMEOUT)
         {
@@ -646,6 +782,7 @@ void USRP_class::receive_continuously_with_callback(bool &stop_signal_called, co
         else if (md.error_code == uhd::rx_metadata_t::ERROR_CODE_OVERFLOW)
         {
             LOG_WARN("*** Got an overflow indication.");
+            LATENCY_COUNT("rx.overflow");
         }
         else if (md.error_code != uhd::rx_metadata_t::ERROR_CODE_NONE)
         {
@@ -663,6 +800,7 @@ void USRP_class::receive_continuously_with_callback(bool &stop_signal_called, co
         auto packet_timer = md.time_spec;
 
         callback_success = callback(buff, num_curr_rx_samps, md.time_spec);
+        LATENCY_RECORD_SINCE("rx.packet_to_produce", packet_arrival_ns);
 
         std::cout << "\rNum of packets received so far = " << rx_counter;
         std::cout.flush();
@@ -682,8 +820,8 @@ bool USRP_class::cycleStartDetector(bool &stop_signal_called, uhd::time_spec_t &
 {
     size_t max_num_samples = size_t(max_duration * rx_rate);
     size_t num_samples_processed = 0;
-    size_t N_zfc = parser.getValue_int("Ref-N-zfc");
-    size_t reps_zfc = parser.getValue_int("Ref-R-zfc");
+    size_t N_zfc = config->ref_n_zfc;
+    size_t reps_zfc = config->ref_r_zfc;
     size_t ex_save_mul = 1; // additional set of samples captured after successful detection
 
     size_t capacity = N_zfc * (reps_zfc + ex_save_mul);
@@ -811,7 +949,7 @@ void USRP_class::lowpassFiltering(const std::vector<sample_type> &rx_samples, st
 {
     size_t rx_stream_size = rx_samples.size();
     // Downsampling filter
-    size_t decimation_factor = parser.getValue_int("sampling-factor");
+    size_t decimation_factor = config->sampling_factor;
     if (decimation_factor != 10)
     {
         LOG_ERROR("ERROR: Only support low-pass filtering with decimation factor = 10.");
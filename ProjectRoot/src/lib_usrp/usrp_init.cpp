@@ -1,7 +1,7 @@
 #include "usrp_init.hpp"
 #include <uhd/cal/database.hpp>
 
-USRP_init::USRP_init(const ConfigParser &parser) : parser(parser) {};
+USRP_init::USRP_init(std::shared_ptr<const Config> config) : config(config) {};
 
 uhd::sensor_value_t USRP_init::get_sensor_fn_rx(const std::string &sensor_name, const size_t &channel)
 {
@@ -91,8 +91,9 @@ bool USRP_init::check_locked_sensor_tx(float setup_time)
 
 void USRP_init::initialize(bool perform_rxtx_tests)
 {
-    device_id = parser.getValue_str("device-id");
-    external_ref = parser.getValue_str("external-clock-ref") == "true";
+    device_id = config->device_id;
+    external_ref = config->external_clock_ref;
+    rx_channels = config->rx_channel_list();
 
     if (!check_and_create_usrp_device())
     {
@@ -146,8 +147,8 @@ void USRP_init::print_usrp_device_info()
 
 std::pair<float, float> USRP_init::query_calibration_data()
 {
-    float rx_pow_ref_input = parser.getValue_float("rx-pow-ref");
-    float tx_pow_ref_input = parser.getValue_float("tx-pow-ref");
+    float rx_pow_ref_input = config->rx_pow_ref;
+    float tx_pow_ref_input = config->tx_pow_ref;
 
     // Query RX calibration data
     auto rx_info = usrp->get_usrp_rx_info();
@@ -210,13 +211,14 @@ void USRP_init::set_antenna()
 {
     // LOG_DEBUG("Setting Tx/Rx antenna.");
     usrp->set_tx_antenna("TX/RX");
-    usrp->set_rx_antenna("TX/RX");
+    for (const auto &channel : rx_channels)
+        usrp->set_rx_antenna("TX/RX", channel);
     // LOG_DEBUG_FMT("Actual Tx/Rx antenna: %1%, %2%.", usrp->get_tx_antenna(), usrp->get_rx_antenna());
 }
 
 void USRP_init::set_master_clock_rate()
 {
-    float master_clock_rate_input = parser.getValue_float("master-clock-rate");
+    float master_clock_rate_input = config->master_clock_rate;
     // LOG_DEBUG_FMT("Setting master clock rate at : %1% ...", master_clock_rate_input);
     usrp->set_master_clock_rate(master_clock_rate_input);
     master_clock_rate = usrp->get_master_clock_rate();
@@ -225,7 +227,7 @@ void USRP_init::set_master_clock_rate()
 
 void USRP_init::set_sample_rate()
 {
-    float rate = parser.getValue_float("rate");
+    float rate = config->rate;
     if (rate <= 0.0)
     {
         throw std::invalid_argument("Specify a valid sampling rate!");
@@ -233,25 +235,27 @@ void USRP_init::set_sample_rate()
 
     // LOG_DEBUG_FMT("Setting Tx/Rx Rate: %1% Msps.", (rate / 1e6));
     usrp->set_tx_rate(rate);
-    usrp->set_rx_rate(rate, 0); // Assuming channel 0
+    for (const auto &channel : rx_channels)
+        usrp->set_rx_rate(rate, channel);
     tx_rate = usrp->get_tx_rate(0);
-    rx_rate = usrp->get_rx_rate(0);
+    rx_rate = usrp->get_rx_rate(rx_channels[0]);
     // LOG_DEBUG_FMT("Actual Tx Sampling Rate :  %1%", (tx_rate / 1e6));
     // LOG_DEBUG_FMT("Actual Rx Sampling Rate : %1%", (rx_rate / 1e6));
 }
 
 void USRP_init::set_center_frequency()
 {
-    float freq = parser.getValue_float("freq");
-    float lo_offset = parser.getValue_float("lo-offset");
+    float freq = config->freq;
+    float lo_offset = config->lo_offset;
 
     // LOG_DEBUG_FMT("Setting TX/RX Freq: %1% MHz...", (freq / 1e6));
     // LOG_DEBUG_FMT("Setting TX/RX LO Offset: %1% MHz...", (lo_offset / 1e6));
 
     uhd::tune_request_t tune_request(freq, lo_offset);
-    usrp->set_rx_freq(tune_request, 0); // Assuming channel 0
+    for (const auto &channel : rx_channels)
+        usrp->set_rx_freq(tune_request, channel);
     usrp->set_tx_freq(tune_request, 0);
-    carrier_freq = usrp->get_rx_freq(0);
+    carrier_freq = usrp->get_rx_freq(rx_channels[0]);
     // LOG_DEBUG_FMT("Actual Rx Freq: %1% MHz...", (usrp->get_rx_freq(0) / 1e6));
     // LOG_DEBUG_FMT("Actual Tx Freq: %1% MHz...", (usrp->get_tx_freq(0) / 1e6));
 }
@@ -269,21 +273,25 @@ void USRP_init::set_initial_gains()
     float rx_gain_input = get_gain("rx", use_calib_gains);
 
     // LOG_DEBUG_FMT("Setting RX Gain: %1% dB...", rx_gain_input);
-    usrp->set_rx_gain(rx_gain_input, 0); // Assuming channel 0
-    rx_gain = usrp->get_rx_gain(0);
+    for (const auto &channel : rx_channels)
+        usrp->set_rx_gain(rx_gain_input, channel);
+    rx_gain = usrp->get_rx_gain(rx_channels[0]);
     // LOG_DEBUG_FMT("Actual Rx Gain: %1% dB...", rx_gain);
 };
 
 float USRP_init::get_gain(const std::string &trans_type, const bool &get_calib_gains)
 {
     std::string config_type;
+    float config_gain = 0.0;
     if (trans_type == "tx")
     {
         config_type = "tx-gain";
+        config_gain = config->tx_gain;
     }
     else if (trans_type == "rx")
     {
         config_type = "rx-gain";
+        config_gain = config->rx_gain;
     }
     else
         LOG_WARN_FMT("Incorrect `trans_type´ = %1%. Allowed values are \"tx\" or \"rx\".", trans_type);
@@ -304,16 +312,16 @@ float USRP_init::get_gain(const std::string &trans_type, const bool &get_calib_g
     }
     else
     {
-        if (parser.getValue_str("gain-mgmt") == "gain")
+        if (config->gain_mgmt == "gain")
         {
-            gain_val = parser.getValue_float(config_type);
+            gain_val = config_gain;
         }
-        else if (parser.getValue_str("gain-mgmt") == "power")
+        else if (config->gain_mgmt == "power")
         {
             auto retval = query_calibration_data();
 
             if (retval.second == -100.0)
-                gain_val = parser.getValue_float(config_type);
+                gain_val = config_gain;
             else
                 gain_val = retval.second;
         }
@@ -332,6 +340,13 @@ void USRP_init::set_tx_gain(const float &_tx_gain, const int &channel)
 void USRP_init::set_rx_gain(const float &_rx_gain, const int &channel)
 {
     // LOG_DEBUG_FMT("Setting RX Gain: %1% dB...", _rx_gain);
+    if (channel < 0) // all streamed channels
+    {
+        for (const auto &rx_channel : rx_channels)
+            usrp->set_rx_gain(_rx_gain, rx_channel);
+        rx_gain = usrp->get_rx_gain(rx_channels[0]);
+        return;
+    }
     usrp->set_rx_gain(_rx_gain, channel);
     rx_gain = usrp->get_rx_gain(channel);
     // LOG_DEBUG_FMT("Actual RX Gain: %1% dB...", rx_gain);
@@ -339,16 +354,17 @@ void USRP_init::set_rx_gain(const float &_rx_gain, const int &channel)
 
 void USRP_init::set_bandwidth()
 {
-    float rx_bw_input = parser.getValue_float("rx-bw");
+    float rx_bw_input = config->rx_bw;
     if (rx_bw_input >= 0.0)
     {
         LOG_DEBUG_FMT("Setting RX Bandwidth: %1% MHz...", (rx_bw_input / 1e6));
-        usrp->set_rx_bandwidth(rx_bw_input, 0); // Assuming channel 0
-        rx_bw = usrp->get_rx_bandwidth(0);
+        for (const auto &channel : rx_channels)
+            usrp->set_rx_bandwidth(rx_bw_input, channel);
+        rx_bw = usrp->get_rx_bandwidth(rx_channels[0]);
         LOG_DEBUG_FMT("Actual Rx Bandwidth: %1% MHz...", (rx_bw / 1e6));
     }
 
-    float tx_bw_input = parser.getValue_float("tx-bw");
+    float tx_bw_input = config->tx_bw;
     if (tx_bw_input >= 0.0)
     {
         LOG_DEBUG_FMT("Setting TX Bandwidth: %1% MHz...", (tx_bw_input / 1e6));
@@ -414,13 +430,23 @@ float USRP_init::get_device_temperature()
 
 void USRP_init::setup_streamers()
 {
-    std::string cpu_format = parser.getValue_str("cpu-format");
-    std::string otw_format = parser.getValue_str("otw-format");
-    uhd::stream_args_t stream_args(cpu_format, otw_format);
-    std::vector<size_t> channel_nums = {0}; // Assuming channel 0
-    stream_args.channels = channel_nums;
-    rx_streamer = usrp->get_rx_stream(stream_args);
-    tx_streamer = usrp->get_tx_stream(stream_args);
+    std::string cpu_format = config->cpu_format;
+    std::string otw_format = config->otw_format;
+    rx_sc16 = is_sc16_format(cpu_format);
+    uhd::stream_args_t rx_stream_args(cpu_format, otw_format);
+    rx_stream_args.channels = rx_channels;
+    rx_streamer = usrp->get_rx_stream(rx_stream_args);
+
+    // all protocols transmit a single waveform -- TX stays on channel 0
+    // TX waveforms are generated in float, so TX keeps the fc32 host format
+    uhd::stream_args_t tx_stream_args("fc32", otw_format);
+    tx_stream_args.channels = {0};
+    tx_streamer = usrp->get_tx_stream(tx_stream_args);
+
+    if (rx_channels.size() > 1)
+        LOG_INFO_FMT("Streaming %1% RX channels, combining: %2%", rx_channels.size(), config->rx_combining);
+    if (rx_sc16)
+        LOG_INFO("RX host format sc16 -- samples are converted to float only for the DSP that needs it.");
 
     max_rx_packet_size = rx_streamer->get_max_num_samps();
     max_tx_packet_size = tx_streamer->get_max_num_samps();
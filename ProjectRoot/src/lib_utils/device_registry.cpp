@@ -0,0 +1,289 @@
+#include "device_registry.hpp"
+#include "utility.hpp"
+#include "thread_sched.hpp"
+
+static bool same_mtime(const struct timespec &a, const struct timespec &b)
+{
+    return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+DeviceRegistry &DeviceRegistry::getInstance()
+{
+    static DeviceRegistry instance;
+    return instance;
+}
+
+DeviceRegistry::DeviceRegistry()
+{
+    devices_json_file = get_home_dir() + "/OTA-C/ProjectRoot/config/devices.json";
+    lock_file = devices_json_file + ".lock";
+    loaded_mtime = {0, 0};
+
+    if (!refresh())
+        LOG_WARN_FMT("Failed to load %1%, device registry starts empty.", devices_json_file);
+
+    writer_thread = boost::thread(&DeviceRegistry::writer_loop, this);
+}
+
+// runs during static destruction, possibly after the Logger -- pending writes are persisted by an
+// explicit flush() (flushDeviceConfig) at the end of the main programs, not here
+DeviceRegistry::~DeviceRegistry()
+{
+    writer_running = false;
+    writer_cv.notify_all();
+    if (writer_thread.joinable())
+        writer_thread.join();
+}
+
+int DeviceRegistry::open_lock_file()
+{
+    int fd = open(lock_file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0664);
+    if (fd < 0)
+        LOG_WARN_FMT("Unable to open lock file %1%.", lock_file);
+    return fd;
+}
+
+bool DeviceRegistry::get_mtime(struct timespec &mtime)
+{
+    struct stat st;
+    if (stat(devices_json_file.c_str(), &st) != 0)
+        return false;
+    mtime = st.st_mtim;
+    return true;
+}
+
+bool DeviceRegistry::load_from_disk()
+{
+    json disk_data;
+    try
+    {
+        std::ifstream inFile(devices_json_file);
+        disk_data = json::parse(inFile);
+    }
+    catch (json::exception &e)
+    {
+        LOG_WARN_FMT("JSON error: %1%", e.what());
+        return false;
+    }
+
+    // values not yet persisted by this process take precedence
+    for (const auto &item : pending_writes)
+    {
+        const auto &device_id = item.first.first;
+        const auto &config_type = item.first.second;
+        if (disk_data.contains(device_id) && disk_data[device_id].contains("config"))
+            disk_data[device_id]["config"][config_type] = item.second;
+    }
+
+    devices_json_data = std::move(disk_data);
+    get_mtime(loaded_mtime);
+    is_loaded = true;
+    return true;
+}
+
+bool DeviceRegistry::refresh()
+{
+    struct timespec mtime;
+    if (!get_mtime(mtime))
+        return is_loaded;
+
+    {
+        std::lock_guard<std::mutex> lock(data_mutex);
+        if (is_loaded && same_mtime(mtime, loaded_mtime))
+            return true;
+    }
+
+    // lock order: file lock before data_mutex (same as persist_pending)
+    int fd = open_lock_file();
+    if (fd < 0)
+        return is_loaded;
+    flock(fd, LOCK_SH);
+
+    bool success;
+    {
+        std::lock_guard<std::mutex> lock(data_mutex);
+        success = load_from_disk();
+    }
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    return success;
+}
+
+bool DeviceRegistry::read(const std::string &device_id, const std::string &config_type, json &config_val)
+{
+    if (!refresh())
+    {
+        LOG_WARN("Failed to read config file.");
+        return false;
+    }
+
+    // find only -- operator[] would insert null entries for missing devices and keys
+    std::lock_guard<std::mutex> lock(data_mutex);
+    auto device_it = devices_json_data.find(device_id);
+    if (device_it == devices_json_data.end())
+    {
+        LOG_WARN_FMT("Device ID %1% not found in devices.json", device_id);
+        return false;
+    }
+
+    auto config_it = device_it->find("config");
+    if (config_it == device_it->end() or not config_it->contains(config_type))
+    {
+        LOG_WARN_FMT("Config type %2% for device ID %1% not found in devices.json", device_id, config_type);
+        return false;
+    }
+
+    config_val = config_it->at(config_type);
+    return true;
+}
+
+bool DeviceRegistry::write(const std::string &device_id, const std::string &config_type, const json &config_val)
+{
+    {
+        std::lock_guard<std::mutex> lock(data_mutex);
+        if (not is_loaded)
+        {
+            LOG_WARN("Failed to read config file.");
+            return false;
+        }
+
+        auto device_it = devices_json_data.find(device_id);
+        if (device_it == devices_json_data.end())
+        {
+            LOG_WARN_FMT("Device ID %1% not found in devices.json", device_id);
+            return false;
+        }
+
+        auto config_it = device_it->find("config");
+        if (config_it == device_it->end() or not config_it->contains(config_type))
+        {
+            LOG_WARN_FMT("Config type %2% for device ID %1% not found in devices.json", device_id, config_type);
+            return false;
+        }
+
+        (*config_it)[config_type] = config_val;
+        pending_writes[{device_id, config_type}] = config_val;
+    }
+
+    writer_cv.notify_one();
+    return true;
+}
+
+bool DeviceRegistry::list_devices(const std::string &device_type, std::vector<std::string> &device_ids)
+{
+    if (!refresh())
+        return false;
+
+    std::lock_guard<std::mutex> lock(data_mutex);
+    for (const auto &item : devices_json_data.items())
+    {
+        const json &dev_conf = item.value();
+        if (dev_conf.contains("type") && dev_conf["type"] == device_type)
+            device_ids.emplace_back(item.key());
+    }
+    return true;
+}
+
+bool DeviceRegistry::persist_pending()
+{
+    std::lock_guard<std::mutex> persist_lock(persist_mutex);
+
+    {
+        std::lock_guard<std::mutex> lock(data_mutex);
+        if (pending_writes.empty())
+            return true;
+    }
+
+    int fd = open_lock_file();
+    if (fd < 0)
+        return false;
+    flock(fd, LOCK_EX);
+
+    json snapshot;
+    std::map<std::pair<std::string, std::string>, json> written;
+    {
+        std::lock_guard<std::mutex> lock(data_mutex);
+
+        // merge with changes made by other processes since our last load
+        struct timespec mtime;
+        if (get_mtime(mtime) && !same_mtime(mtime, loaded_mtime))
+            load_from_disk();
+
+        snapshot = devices_json_data;
+        written = pending_writes;
+    }
+
+    // write to a temporary file and atomically replace devices.json
+    std::string tmp_file = devices_json_file + ".tmp." + std::to_string(getpid());
+    bool success = false;
+    {
+        std::ofstream outFile(tmp_file, std::ios::out | std::ios::trunc);
+        if (outFile.is_open())
+        {
+            outFile << snapshot.dump(4);
+            outFile.close();
+            success = outFile.good();
+        }
+    }
+    if (success)
+    {
+        int tmp_fd = open(tmp_file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (tmp_fd >= 0)
+        {
+            fsync(tmp_fd);
+            close(tmp_fd);
+        }
+        success = std::rename(tmp_file.c_str(), devices_json_file.c_str()) == 0;
+    }
+
+    if (success)
+    {
+        std::lock_guard<std::mutex> lock(data_mutex);
+        get_mtime(loaded_mtime);
+
+        // drop entries that were not overwritten while persisting
+        for (const auto &item : written)
+        {
+            auto it = pending_writes.find(item.first);
+            if (it != pending_writes.end() && it->second == item.second)
+                pending_writes.erase(it);
+        }
+        LOG_DEBUG("Config written to devices.json file.");
+    }
+    else
+    {
+        std::remove(tmp_file.c_str());
+        LOG_WARN("Writing config to devices.json file failed!");
+    }
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    return success;
+}
+
+bool DeviceRegistry::flush()
+{
+    return persist_pending();
+}
+
+void DeviceRegistry::writer_loop()
+{
+    ThreadScheduling::getInstance().apply_to_current_thread(ThreadRole::IO, "device_registry.writer");
+    while (writer_running)
+    {
+        {
+            std::unique_lock<std::mutex> lock(data_mutex);
+            writer_cv.wait(lock, [this]()
+                           { return !pending_writes.empty() || !writer_running; });
+        }
+        if (!writer_running)
+            break;
+
+        // let bursts of updates (e.g. CFO after every detection) coalesce into one write
+        std::this_thread::sleep_for(std::chrono::milliseconds(COALESCE_DELAY_MS));
+
+        if (!persist_pending())
+            std::this_thread::sleep_for(std::chrono::milliseconds(5 * COALESCE_DELAY_MS));
+    }
+}
@@ -0,0 +1,57 @@
+#include "event_sync.hpp"
+
+Deadline::Deadline(const std::chrono::steady_clock::duration &timeout) : tp(std::chrono::steady_clock::now() + timeout) {}
+
+Deadline Deadline::never()
+{
+    return Deadline(std::chrono::steady_clock::time_point::max());
+}
+
+bool Deadline::expired() const
+{
+    return std::chrono::steady_clock::now() >= tp;
+}
+
+void FlagSet::set(const uint32_t &flags)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bits.fetch_or(flags);
+    }
+    cv.notify_all();
+}
+
+void FlagSet::clear(const uint32_t &flags)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    bits.fetch_and(~flags);
+}
+
+bool FlagSet::test(const uint32_t &flags) const
+{
+    return (bits.load() & flags) != 0;
+}
+
+bool FlagSet::consume(const uint32_t &flags)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return (bits.fetch_and(~flags) & flags) != 0;
+}
+
+uint32_t FlagSet::wait_any(const uint32_t &flags, const Deadline &deadline)
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    uint64_t interrupts_seen = interrupt_count;
+    cv.wait_until(lock, deadline.time_point(), [this, &flags, &interrupts_seen]()
+                  { return (bits.load() & flags) != 0 || interrupt_count != interrupts_seen; });
+    return bits.load() & flags;
+}
+
+void FlagSet::interrupt()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        interrupt_count++;
+    }
+    cv.notify_all();
+}
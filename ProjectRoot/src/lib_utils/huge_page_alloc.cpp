@@ -0,0 +1,167 @@
+#include "huge_page_alloc.hpp"
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+HugePageArena &HugePageArena::getInstance()
+{
+    static HugePageArena instance;
+    return instance;
+}
+
+// huge pages from the pool, else a normal mapping advised for transparent huge pages -- bound to
+// the NUMA node and pre-faulted
+void *HugePageArena::map_pages(const size_t &length, bool &from_pool)
+{
+    void *ptr = MAP_FAILED;
+    from_pool = false;
+
+    // reserved huge pages -- not populated here, the NUMA policy has to be set first
+    if (huge_pages_enabled)
+    {
+        ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        from_pool = ptr != MAP_FAILED;
+        if (not from_pool and not hugetlb_warned.exchange(true))
+            LOG_DEBUG_FMT("No reserved huge pages for %1% bytes (vm.nr_hugepages) -- using transparent huge pages.", length);
+    }
+
+    // fallback -- normal mapping, transparent huge pages if the kernel allows them
+    if (not from_pool)
+    {
+        ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED)
+            throw std::bad_alloc();
+        if (huge_pages_enabled)
+            madvise(ptr, length, MADV_HUGEPAGE);
+    }
+
+    // pages on the node of the streaming threads, whichever thread faults them in
+    int node = numa_node;
+    if (node >= 0)
+    {
+        unsigned long node_mask[16] = {0};
+        if (size_t(node) < 8 * sizeof(node_mask))
+        {
+            node_mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+            if (syscall(SYS_mbind, ptr, length, MPOL_PREFERRED, node_mask, 8 * sizeof(node_mask), 0) != 0)
+                LOG_DEBUG_FMT("mbind to NUMA node %1% failed: %2%", node, std::strerror(errno));
+        }
+    }
+
+    // pre-fault -- one write per small page (a huge page is faulted by its first write)
+    volatile char *pages = static_cast<char *>(ptr);
+    for (size_t offset = 0; offset < length; offset += 4096)
+        pages[offset] = 0;
+
+    (from_pool ? hugetlb_bytes : mapped_bytes) += length;
+    return ptr;
+}
+
+void *HugePageArena::allocate_small(const size_t &size_class)
+{
+    std::lock_guard<std::mutex> lock(slab_mutex);
+    small_bytes += size_class;
+
+    auto it = free_small_blocks.find(size_class);
+    if (it != free_small_blocks.end() and not it->second.empty())
+    {
+        void *ptr = it->second.back();
+        it->second.pop_back();
+        return ptr;
+    }
+
+    // the rest of the last slab is left unused
+    if (slab_used + size_class > huge_page_size)
+    {
+        bool from_pool;
+        slabs.push_back(static_cast<char *>(map_pages(huge_page_size, from_pool)));
+        slab_used = 0;
+    }
+    void *ptr = slabs.back() + slab_used;
+    slab_used += size_class;
+    return ptr;
+}
+
+bool HugePageArena::in_slab(const void *ptr) const
+{
+    const char *addr = static_cast<const char *>(ptr);
+    for (const auto &slab : slabs)
+        if (addr >= slab and addr < slab + huge_page_size)
+            return true;
+    return false;
+}
+
+void *HugePageArena::allocate(const size_t &bytes)
+{
+    if (bytes == 0)
+        return nullptr;
+
+    if (bytes < huge_page_size)
+    {
+        if (huge_pages_enabled)
+            return allocate_small(small_size(bytes));
+
+        size_t rounded = aligned_size(bytes);
+        void *ptr = std::aligned_alloc(alignment, rounded);
+        if (ptr == nullptr)
+            throw std::bad_alloc();
+        std::memset(ptr, 0, rounded); // pre-fault
+        small_bytes += rounded;
+        return ptr;
+    }
+
+    bool from_pool;
+    void *ptr = map_pages(mapped_size(bytes), from_pool);
+    std::lock_guard<std::mutex> lock(mapping_mutex);
+    is_hugetlb[ptr] = from_pool;
+    return ptr;
+}
+
+void HugePageArena::deallocate(void *ptr, const size_t &bytes)
+{
+    if (ptr == nullptr)
+        return;
+
+    if (bytes < huge_page_size)
+    {
+        std::lock_guard<std::mutex> lock(slab_mutex);
+        if (in_slab(ptr))
+        {
+            small_bytes -= small_size(bytes);
+            free_small_blocks[small_size(bytes)].push_back(ptr);
+        }
+        else
+        {
+            small_bytes -= aligned_size(bytes);
+            std::free(ptr);
+        }
+        return;
+    }
+
+    size_t length = mapped_size(bytes);
+    bool from_pool = false;
+    {
+        std::lock_guard<std::mutex> lock(mapping_mutex);
+        auto it = is_hugetlb.find(ptr);
+        if (it != is_hugetlb.end())
+        {
+            from_pool = it->second;
+            is_hugetlb.erase(it);
+        }
+    }
+    munmap(ptr, length);
+    (from_pool ? hugetlb_bytes : mapped_bytes) -= length;
+}
+
+json HugePageArena::stats_json() const
+{
+    json stats;
+    stats["hugetlb_bytes"] = hugetlb_bytes.load();
+    stats["mapped_bytes"] = mapped_bytes.load();
+    stats["small_bytes"] = small_bytes.load();
+    stats["numa_node"] = numa_node.load();
+    return stats;
+}
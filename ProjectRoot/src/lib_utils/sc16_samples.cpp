@@ -0,0 +1,31 @@
+#include "sc16_samples.hpp"
+
+void sc16_to_fc32(const sc16_type *in, const size_t &num_samples, sample_type *out)
+{
+    const int16_t *in_vals = reinterpret_cast<const int16_t *>(in);
+    float *out_vals = reinterpret_cast<float *>(out);
+    const float scale = 1.0 / sc16_full_scale;
+    for (size_t i = 0; i < 2 * num_samples; ++i)
+        out_vals[i] = in_vals[i] * scale;
+}
+
+void fc32_to_sc16(const sample_type *in, const size_t &num_samples, sc16_type *out)
+{
+    const float *in_vals = reinterpret_cast<const float *>(in);
+    int16_t *out_vals = reinterpret_cast<int16_t *>(out);
+    for (size_t i = 0; i < 2 * num_samples; ++i)
+    {
+        float val = std::min(std::max(in_vals[i] * sc16_full_scale, -sc16_full_scale), sc16_full_scale);
+        out_vals[i] = int16_t(std::nearbyint(val));
+    }
+}
+
+void sc16_powers(const sc16_type *in, const size_t &num_samples, float *out)
+{
+    // int16 products widened to 32 bits -- the compiler turns the loop into widening
+    // multiply-adds (pmaddwd / vmlal), one float conversion per sample
+    const int16_t *vals = reinterpret_cast<const int16_t *>(in);
+    const float scale = 1.0 / (double(sc16_full_scale) * sc16_full_scale);
+    for (size_t i = 0; i < num_samples; ++i)
+        out[i] = scale * float(int32_t(vals[2 * i]) * vals[2 * i] + int32_t(vals[2 * i + 1]) * vals[2 * i + 1]);
+}
@@ -0,0 +1,228 @@
+#include "thread_sched.hpp"
+#include <filesystem>
+
+bool ThreadRoleSched::parse(const std::string &spec, ThreadRoleSched &role_sched, std::string &error)
+{
+    role_sched = ThreadRoleSched();
+    std::string trimmed = boost::trim_copy(spec);
+    if (trimmed.empty() or trimmed == "none")
+        return true;
+
+    std::string cpus_str = trimmed, priority_str;
+    size_t at_pos = trimmed.find('@');
+    if (at_pos != std::string::npos)
+    {
+        cpus_str = trimmed.substr(0, at_pos);
+        priority_str = trimmed.substr(at_pos + 1);
+    }
+
+    try
+    {
+        std::vector<std::string> items;
+        boost::split(items, cpus_str, boost::is_any_of(","));
+        for (const auto &item : items)
+        {
+            std::string cpu_item = boost::trim_copy(item);
+            if (cpu_item.empty())
+                continue;
+            size_t dash_pos = cpu_item.find('-');
+            int first = boost::lexical_cast<int>(cpu_item.substr(0, dash_pos));
+            int last = dash_pos == std::string::npos ? first : boost::lexical_cast<int>(cpu_item.substr(dash_pos + 1));
+            if (first < 0 or last < first or last >= CPU_SETSIZE)
+            {
+                error = "invalid CPU range '" + cpu_item + "'";
+                return false;
+            }
+            for (int cpu = first; cpu <= last; ++cpu)
+                role_sched.cpus.push_back(cpu);
+        }
+
+        if (at_pos != std::string::npos)
+        {
+            role_sched.fifo_priority = boost::lexical_cast<int>(boost::trim_copy(priority_str));
+            if (role_sched.fifo_priority < 1 or role_sched.fifo_priority > 99)
+            {
+                error = "SCHED_FIFO priority must be in [1, 99]";
+                return false;
+            }
+        }
+    }
+    catch (const boost::bad_lexical_cast &)
+    {
+        error = "expected \"<cpus>[@<priority>]\", got '" + spec + "'";
+        return false;
+    }
+    return true;
+}
+
+ThreadScheduling &ThreadScheduling::getInstance()
+{
+    static ThreadScheduling instance;
+    return instance;
+}
+
+std::string ThreadScheduling::role_name(const ThreadRole &role)
+{
+    switch (role)
+    {
+    case ThreadRole::RX:
+        return "rx";
+    case ThreadRole::DSP:
+        return "dsp";
+    case ThreadRole::DETECT:
+        return "detect";
+    case ThreadRole::TX:
+        return "tx";
+    case ThreadRole::CONTROL:
+        return "control";
+    case ThreadRole::IO:
+        return "io";
+    }
+    return "unknown";
+}
+
+void ThreadScheduling::configure(std::shared_ptr<const Config> config)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const std::vector<std::pair<ThreadRole, std::string>> role_specs = {
+        {ThreadRole::RX, config->sched_rx},
+        {ThreadRole::DSP, config->sched_dsp},
+        {ThreadRole::DETECT, config->sched_detect},
+        {ThreadRole::TX, config->sched_tx},
+        {ThreadRole::CONTROL, config->sched_control},
+        {ThreadRole::IO, config->sched_io}};
+
+    roles.clear();
+    for (const auto &[role, spec] : role_specs)
+    {
+        ThreadRoleSched role_sched;
+        std::string error;
+        if (not ThreadRoleSched::parse(spec, role_sched, error))
+            LOG_WARN_FMT("Thread scheduling of role '%1%' ignored: %2%", role_name(role), error);
+        else if (not role_sched.is_default())
+            roles[role] = role_sched;
+    }
+
+    if (config->sched_mlockall and not memory_locked)
+    {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+        {
+            memory_locked = true;
+            LOG_INFO("Process memory locked in RAM (mlockall).");
+        }
+        else
+            LOG_WARN_FMT("mlockall failed: %1% -- check 'ulimit -l' / memlock in limits.conf.", std::strerror(errno));
+    }
+
+    configured = true;
+}
+
+bool ThreadScheduling::apply(boost::thread &thread, const ThreadRole &role, const std::string &thread_name)
+{
+    if (not thread.joinable())
+        return false;
+    return apply_native(thread.native_handle(), role, thread_name);
+}
+
+bool ThreadScheduling::apply_to_current_thread(const ThreadRole &role, const std::string &thread_name)
+{
+    return apply_native(pthread_self(), role, thread_name);
+}
+
+bool ThreadScheduling::apply_native(const pthread_t &handle, const ThreadRole &role, const std::string &thread_name)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = roles.find(role);
+    if (not configured or it == roles.end())
+        return true; // default scheduling requested
+
+    const ThreadRoleSched &role_sched = it->second;
+    bool success = true;
+
+    if (not role_sched.cpus.empty())
+    {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        for (const auto &cpu : role_sched.cpus)
+            CPU_SET(cpu, &cpu_set);
+        int err = pthread_setaffinity_np(handle, sizeof(cpu_set_t), &cpu_set);
+        if (err != 0)
+        {
+            LOG_WARN_FMT("Thread '%1%': setting CPU affinity failed: %2%", thread_name, std::strerror(err));
+            success = false;
+        }
+    }
+
+    if (role_sched.fifo_priority > 0)
+    {
+        sched_param param{};
+        param.sched_priority = role_sched.fifo_priority;
+        int err = pthread_setschedparam(handle, SCHED_FIFO, &param);
+        if (err != 0)
+        {
+            LOG_WARN_FMT("Thread '%1%': SCHED_FIFO priority %2% failed: %3% -- needs CAP_SYS_NICE or rtprio in limits.conf.", thread_name, role_sched.fifo_priority, std::strerror(err));
+            success = false;
+        }
+    }
+
+    // read back what the thread actually got
+    int policy = SCHED_OTHER;
+    sched_param param{};
+    pthread_getschedparam(handle, &policy, &param);
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    std::vector<int> cpus;
+    if (pthread_getaffinity_np(handle, sizeof(cpu_set_t), &cpu_set) == 0)
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &cpu_set))
+                cpus.push_back(cpu);
+
+    std::string policy_name = policy == SCHED_FIFO ? "SCHED_FIFO" : (policy == SCHED_RR ? "SCHED_RR" : "SCHED_OTHER");
+    std::string cpus_str;
+    for (const auto &cpu : cpus)
+        cpus_str += (cpus_str.empty() ? "" : ",") + std::to_string(cpu);
+    LOG_INFO_FMT("Thread '%1%' (%2%): %3% priority %4%, CPUs %5%", thread_name, role_name(role), policy_name, param.sched_priority, cpus_str);
+
+    applied.push_back({{"thread", thread_name},
+                       {"role", role_name(role)},
+                       {"policy", policy_name},
+                       {"priority", param.sched_priority},
+                       {"cpus", cpus},
+                       {"as_requested", success}});
+    return success;
+}
+
+json ThreadScheduling::report_json()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    json report;
+    report["mlockall"] = memory_locked;
+    report["threads"] = applied;
+    return report;
+}
+
+int ThreadScheduling::numa_node(const ThreadRole &role)
+{
+    int cpu;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = roles.find(role);
+        if (it == roles.end() or it->second.cpus.empty())
+            return -1;
+        cpu = it->second.cpus.front();
+    }
+
+    // sysfs lists the node of a CPU as a "node<N>" entry of its directory
+    std::error_code error;
+    std::filesystem::directory_iterator cpu_dir("/sys/devices/system/cpu/cpu" + std::to_string(cpu), error);
+    if (error)
+        return -1;
+    for (const auto &entry : cpu_dir)
+    {
+        std::string name = entry.path().filename().string();
+        if (name.size() > 4 and name.compare(0, 4, "node") == 0 and std::all_of(name.begin() + 4, name.end(), ::isdigit))
+            return std::stoi(name.substr(4));
+    }
+    return -1;
+}
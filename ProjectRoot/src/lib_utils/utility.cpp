@@ -1,6 +1,6 @@
 #include "utility.hpp"
-
-std::mutex fileMutex;
+#include "device_registry.hpp"
+#include "window_power.hpp"
 
 std::string currentDateTime()
 {
@@ -88,6 +88,39 @@ void save_stream_to_file(const std::string &filename, std::ofstream &outfile, st
     }
 }
 
+void save_stream_to_file(const std::string &filename, std::ofstream &outfile, const sample_type *stream, const size_t &num_samples)
+{
+    // Open the file in append mode (if not already open)
+    if (!outfile.is_open())
+    {
+        outfile.open(filename, std::ios::out | std::ios::binary | std::ios::app);
+        if (!outfile.is_open())
+        {
+            LOG_WARN("Error: Could not open file for writing.");
+            return;
+        }
+    }
+
+    // complex<float> is stored as interleaved real and imag floats, same layout as the file
+    outfile.write(reinterpret_cast<const char *>(stream), num_samples * sizeof(sample_type));
+}
+
+void save_stream_to_file(const std::string &filename, std::ofstream &outfile, const sc16_type *stream, const size_t &num_samples)
+{
+    if (!outfile.is_open())
+    {
+        outfile.open(filename, std::ios::out | std::ios::binary | std::ios::app);
+        if (!outfile.is_open())
+        {
+            LOG_WARN("Error: Could not open file for writing.");
+            return;
+        }
+    }
+
+    // interleaved int16 real and imag values (scale 32767 = 1.0)
+    outfile.write(reinterpret_cast<const char *>(stream), num_samples * sizeof(sc16_type));
+}
+
 void save_timer_to_file(const std::string &filename, std::ofstream &outfile, std::vector<double> stream)
 {
     // Open the file in append mode (if not already open)
@@ -445,136 +478,33 @@ float fromDecibel(float dB, bool isPower)
     }
 }
 
-// read/write devices.json file
-bool devices_json_read_write(json &config_data, const bool &is_read)
-{
-    std::lock_guard<std::mutex> lock(fileMutex);
-    std::string homeDir = get_home_dir();
-    std::string devices_json_file = homeDir + "/OTA-C/ProjectRoot/config/devices.json";
-
-    if (is_read)
-    {
-        try
-        {
-            std::ifstream inFile(devices_json_file);
-            config_data = json::parse(inFile);
-            return true;
-        }
-        catch (json::exception &e)
-        {
-            LOG_WARN_FMT("JSON error: %1%", e.what());
-            return false;
-        }
-    }
-    else
-    {
-        std::ofstream outFile(devices_json_file);
-        if (outFile.is_open())
-        {
-            outFile << config_data.dump(4);
-            outFile.close();
-            LOG_DEBUG("Config written to devices.json file.");
-            return true;
-        }
-        LOG_WARN("Writing config to devices.json file failed!");
-        return false;
-    }
-}
-
-// Save config value in devices.json file
+// Save config value in devices.json file -- served by DeviceRegistry, persisted in the background
 bool saveDeviceConfig(const std::string &device_id, const std::string &config_type, const float &config_val)
 {
-    json devices_json_data;
-    bool read_success = devices_json_read_write(devices_json_data, true);
-    if (not read_success)
-    {
-        LOG_WARN("Failed to read config file.");
-        return false;
-    }
-
-    if (not devices_json_data.contains(device_id))
-    {
-        LOG_WARN_FMT("Device ID %1% not found in devices.json", device_id);
-        return false;
-    }
-
-    json config_data = devices_json_data[device_id]["config"];
-    if (not config_data.contains(config_type))
-    {
-        LOG_WARN_FMT("Config type %2% for device ID %1% not found in devices.json", device_id, config_type);
-        return false;
-    }
-
-    // insert new data
-    config_data[config_type] = config_val;
-    devices_json_data[device_id]["config"] = config_data;
-    bool write_success = devices_json_read_write(devices_json_data, false);
-    if (write_success)
-        return true;
-    else
-        return false;
+    return DeviceRegistry::getInstance().write(device_id, config_type, json(config_val));
 }
 
 bool saveDeviceConfig(const std::string &device_id, const std::string &config_type, const json &config_val)
 {
-    json devices_json_data;
-    bool read_success = devices_json_read_write(devices_json_data, true);
-    if (not read_success)
-    {
-        LOG_WARN("Failed to read config file.");
-        return false;
-    }
-
-    if (not devices_json_data.contains(device_id))
-    {
-        LOG_WARN_FMT("Device ID %1% not found in devices.json", device_id);
-        return false;
-    }
-
-    json config_data = devices_json_data[device_id]["config"];
-    if (not config_data.contains(config_type))
-    {
-        LOG_WARN_FMT("Config type %2% for device ID %1% not found in devices.json", device_id, config_type);
-        return false;
-    }
+    return DeviceRegistry::getInstance().write(device_id, config_type, config_val);
+}
 
-    // insert new data
-    config_data[config_type] = config_val;
-    devices_json_data[device_id]["config"] = config_data;
-    bool write_success = devices_json_read_write(devices_json_data, false);
-    if (write_success)
-        return true;
-    else
-        return false;
+// Persist pending devices.json updates -- called by the main programs before they exit
+bool flushDeviceConfig()
+{
+    return DeviceRegistry::getInstance().flush();
 }
 
 // Read data from devices.json file
 bool readDeviceConfig(const std::string &device_id, const std::string &config_type, float &config_val)
 {
-    json devices_json_data;
-    bool read_success = devices_json_read_write(devices_json_data, true);
-    if (not read_success)
-    {
-        LOG_WARN("Failed to read config file.");
-        return false;
-    }
-
-    if (not devices_json_data.contains(device_id))
-    {
-        LOG_WARN_FMT("Device ID %1% not found in devices.json", device_id);
-        return false;
-    }
-
-    json config_data = devices_json_data[device_id]["config"];
-    if (not config_data.contains(config_type))
-    {
-        LOG_WARN_FMT("Config type %2% for device ID %1% not found in devices.json", device_id, config_type);
+    json config_data;
+    if (not DeviceRegistry::getInstance().read(device_id, config_type, config_data))
         return false;
-    }
 
     try
     {
-        config_val = config_data[config_type].get<float>();
+        config_val = config_data.get<float>();
         return true;
     }
     catch (json::exception &e)
@@ -586,59 +516,22 @@ bool readDeviceConfig(const std::string &device_id, const std::string &config_ty
 
 bool readDeviceConfig(const std::string &device_id, const std::string &config_type, json &config_val)
 {
-    json devices_json_data;
-    bool read_success = devices_json_read_write(devices_json_data, true);
-    if (not read_success)
-    {
-        LOG_WARN("Failed to read config file.");
-        return false;
-    }
-
-    if (not devices_json_data.contains(device_id))
-    {
-        LOG_WARN_FMT("Device ID %1% not found in devices.json", device_id);
-        return false;
-    }
-
-    json config_data = devices_json_data[device_id]["config"];
-    if (not config_data.contains(config_type))
-    {
-        LOG_WARN_FMT("Config type %2% for device ID %1% not found in devices.json", device_id, config_type);
-        return false;
-    }
-
-    try
-    {
-        config_val = config_data[config_type];
-        return true;
-    }
-    catch (json::exception &e)
-    {
-        LOG_WARN_FMT("JSON error %1%", e.what());
-        return false;
-    }
+    return DeviceRegistry::getInstance().read(device_id, config_type, config_val);
 }
 
 bool listActiveDevices(std::vector<std::string> &device_ids)
 {
-    json devices_json_data;
-    bool read_success = devices_json_read_write(devices_json_data, true);
-    if (not read_success)
+    std::vector<std::string> leaf_ids;
+    if (not DeviceRegistry::getInstance().list_devices("leaf", leaf_ids))
     {
-        LOG_WARN("Saving config data failed! Failed to read config file.");
+        LOG_WARN("Failed to read config file.");
         return false;
     }
 
-    for (const auto &item : devices_json_data.items())
+    for (const auto &device_id : leaf_ids)
     {
-        std::string device_id = item.key();
         if (device_id.compare(0, 2, "32") == 0)
-        {
-            json dev_conf = item.value();
-            std::string dev_type = dev_conf["type"].get<std::string>();
-            if ((dev_type == "leaf"))
-                device_ids.emplace_back(device_id);
-        }
+            device_ids.emplace_back(device_id);
     }
     return true;
 }
@@ -670,28 +563,29 @@ void correct_cfo(std::vector<sample_type> &signal, size_t &counter, const float
     }
 }
 
-void windowing_func(const std::vector<float> &signal, const size_t &otac_len, const float &threshold, std::vector<float> out_signal, float &max_signal_power, size_t &max_index)
+void windowing_func(const std::vector<float> &signal, const size_t &otac_len, const float &threshold, std::vector<float> &out_signal, float &max_signal_power, size_t &max_index)
 {
     size_t signal_len = signal.size();
-    out_signal.resize(signal_len - otac_len);
-    float temp_val = 0.0, win_pow = 0.0;
-    bool threshold_crossed = false;
-    for (size_t i = 0; i < signal_len - otac_len; ++i)
+    if (signal_len < otac_len)
     {
-        if (i == 0)
-        {
-            for (size_t j = 0; j < otac_len; ++j)
-            {
-                temp_val += signal[j];
-            }
-        }
-        else
+        out_signal.clear();
+        return;
+    }
+    out_signal.resize(signal_len - otac_len + 1);
+    // double accumulator -- a float running sum drifts over long captures
+    double temp_val = 0.0;
+    for (size_t j = 0; j < otac_len; ++j)
+        temp_val += signal[j];
+
+    for (size_t i = 0; i < out_signal.size(); ++i)
+    {
+        if (i > 0)
         {
             temp_val -= signal[i - 1];
             temp_val += signal[i + otac_len - 1];
         }
 
-        win_pow = temp_val / otac_len;
+        float win_pow = float(temp_val / otac_len);
         out_signal[i] = win_pow;
 
         if (win_pow > max_signal_power)
@@ -704,34 +598,29 @@ void windowing_func(const std::vector<float> &signal, const size_t &otac_len, co
 
 bool otac_wfs_proc(const std::vector<sample_type> &signal, const size_t &otac_len, const float &threshold, float &fs_signal_power, float &otac_signal_power, size_t &num_samples_till_fs)
 {
-    size_t signal_len = signal.size();
-    std::vector<float> norm_samples(signal_len);
-    std::transform(signal.begin(), signal.end(), norm_samples.begin(), [](const sample_type &c)
-                   { return std::norm(c); });
+    // reused across calls, the engine only grows them
+    thread_local std::vector<double> prefix;
+    thread_local std::vector<float> window_avg_sig;
 
-    // Find Full-scale signal - first occurance of signal with mean-norm above threshold
-    float max_fs = 0.0;
-    size_t max_index = 0;
-    std::vector<float> window_avg_sig;
-    windowing_func(norm_samples, otac_len, threshold, window_avg_sig, max_fs, max_index);
+    // Find Full-scale signal - strongest window with mean-norm above threshold, OTAC signal follows it
+    WindowPowerEngine engine(otac_len);
+    auto frame = engine.process_frame(signal, threshold, prefix, window_avg_sig);
 
-    if (max_fs > threshold)
+    if (frame.fs_found)
     {
         // calculate the power of follow-up otac signal
-        if (max_index > signal_len - 5 * otac_len)
+        if (frame.fs_index + 5 * otac_len > signal.size() or not frame.otac_found)
         {
             LOG_WARN("OTAC signal is not captured correctly.");
         }
         else
         {
-            auto max_it = std::max_element(window_avg_sig.begin() + max_index + otac_len, window_avg_sig.end());
-            float max_otac = *max_it;
-            LOG_DEBUG_FMT("Distance of maximum OTAC signal (%1%) from end of FullScale signal (%2%) = %3%", max_fs, max_otac, std::distance(window_avg_sig.begin() + max_index + otac_len, max_it));
-            otac_signal_power = max_otac;
+            LOG_DEBUG_FMT("Distance of maximum OTAC signal (%1%) from end of FullScale signal (%2%) = %3%", frame.otac_power, frame.fs_power, frame.otac_index - frame.fs_index - otac_len);
+            otac_signal_power = frame.otac_power;
         }
 
-        fs_signal_power = max_fs;
-        num_samples_till_fs = max_index;
+        fs_signal_power = frame.fs_power;
+        num_samples_till_fs = frame.fs_index;
         return true;
     }
     else
@@ -740,38 +629,14 @@ bool otac_wfs_proc(const std::vector<sample_type> &signal, const size_t &otac_le
 
 bool otac_wofs_proc(const std::vector<sample_type> &signal, const size_t &otac_len, const float &threshold, float &signal_power, size_t &num_samples_till_otac)
 {
-    size_t signal_len = signal.size();
-    std::vector<float> norm_samples(signal_len);
-    std::transform(signal.begin(), signal.end(), norm_samples.begin(), [](const sample_type &c)
-                   { return std::norm(c); });
-    // compute signal power over window
-    float max_val = 0.0, temp_val = 0.0, win_pow = 0.0;
-    size_t max_index = 0;
-    for (size_t i = 0; i < signal_len - otac_len; ++i)
-    {
-        if (i == 0)
-        {
-            for (size_t j = 0; j < otac_len; ++j)
-            {
-                temp_val += norm_samples[j];
-            }
-        }
-        else
-        {
-            temp_val -= norm_samples[i - 1];
-            temp_val += norm_samples[i + otac_len - 1];
-        }
+    thread_local std::vector<double> prefix;
 
-        win_pow = temp_val / otac_len;
-        if (win_pow > max_val)
-        {
-            max_val = win_pow;
-            max_index = i;
-        }
-    }
+    // compute signal power over window
+    WindowPowerEngine engine(otac_len);
+    auto result = engine.process(signal, threshold, prefix);
 
-    num_samples_till_otac = max_index;
-    signal_power = max_val;
+    num_samples_till_otac = result.max_index;
+    signal_power = std::max(result.max_power, 0.0f);
     return true;
 }
 
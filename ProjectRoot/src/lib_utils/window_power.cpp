@@ -0,0 +1,105 @@
+#include "window_power.hpp"
+
+WindowPowerEngine::WindowPowerEngine(const size_t &window_len) : win_len(window_len)
+{
+    if (win_len == 0)
+        LOG_ERROR("Window length must be positive.");
+}
+
+WindowPowerEngine::Result WindowPowerEngine::process(const std::vector<sample_type> &signal, const float &threshold, std::vector<double> &prefix, std::vector<float> *window_power) const
+{
+    return process(signal.data(), signal.size(), threshold, prefix, window_power);
+}
+
+WindowPowerEngine::Result WindowPowerEngine::process(const sample_type *signal, const size_t &signal_len, const float &threshold, std::vector<double> &prefix, std::vector<float> *window_power) const
+{
+    Result result;
+    prefix.resize(signal_len + 1);
+    prefix[0] = 0.0;
+    if (signal_len < win_len)
+        return result;
+
+    result.num_windows = signal_len - win_len + 1;
+    if (window_power)
+        window_power->resize(result.num_windows);
+
+    const float *vals = reinterpret_cast<const float *>(signal);
+    const double inv_len = 1.0 / win_len;
+    float norms[block_size];
+    double acc = 0.0;
+    bool above = false;
+    result.max_power = -1.0;
+
+    for (size_t base = 0; base < signal_len; base += block_size)
+    {
+        size_t count = std::min(block_size, signal_len - base);
+
+        // |x|^2 for a block of interleaved re/im values -- no dependencies, vectorized by the compiler
+        const float *block_vals = vals + 2 * base;
+        for (size_t j = 0; j < count; ++j)
+            norms[j] = block_vals[2 * j] * block_vals[2 * j] + block_vals[2 * j + 1] * block_vals[2 * j + 1];
+
+        for (size_t j = 0; j < count; ++j)
+        {
+            size_t end = base + j + 1;
+            acc += norms[j];
+            prefix[end] = acc;
+            if (end < win_len)
+                continue;
+
+            // window [end - win_len, end) is complete
+            size_t i = end - win_len;
+            float pow = float((prefix[end] - prefix[i]) * inv_len);
+            if (window_power)
+                (*window_power)[i] = pow;
+            if (pow > result.max_power)
+            {
+                result.max_power = pow;
+                result.max_index = i;
+            }
+            if (pow > threshold)
+            {
+                if (not above)
+                {
+                    result.num_crossings++;
+                    if (result.first_crossing == npos)
+                        result.first_crossing = i;
+                }
+                above = true;
+            }
+            else
+                above = false;
+        }
+    }
+
+    return result;
+}
+
+WindowPowerEngine::FrameResult WindowPowerEngine::process_frame(const std::vector<sample_type> &signal, const float &threshold, std::vector<double> &prefix, std::vector<float> &window_power) const
+{
+    FrameResult frame;
+    Result result = process(signal, threshold, prefix, &window_power);
+    if (result.num_windows == 0 or result.max_power <= threshold)
+        return frame;
+
+    frame.fs_found = true;
+    frame.fs_power = result.max_power;
+    frame.fs_index = result.max_index;
+
+    size_t otac_search_start = result.max_index + win_len;
+    if (otac_search_start < result.num_windows)
+    {
+        auto max_it = std::max_element(window_power.begin() + otac_search_start, window_power.begin() + result.num_windows);
+        frame.otac_found = true;
+        frame.otac_power = *max_it;
+        frame.otac_index = std::distance(window_power.begin(), max_it);
+    }
+    return frame;
+}
+
+float WindowPowerEngine::segment_power(const std::vector<double> &prefix, const size_t &start, const size_t &len)
+{
+    if (len == 0 or start + len >= prefix.size())
+        return 0.0;
+    return float((prefix[start + len] - prefix[start]) / len);
+}